@@ -0,0 +1,186 @@
+//AssetLoader.cpp
+
+#include "AssetLoader.hpp"
+
+//constructor
+AssetLoader::AssetLoader(int threadCount) : results(256){
+	this->stopping = false;
+	this->pendingCount = 0;
+	
+	//start worker threads
+	for(int i = 0; i < threadCount; i++){
+		this->workers.push_back(std::thread(&AssetLoader::workerLoop, this));
+	};
+};
+
+//destructor
+AssetLoader::~AssetLoader(){
+	//wake workers and wait for them to finish their current request
+	{
+		std::lock_guard<std::mutex> lock(this->requestMutex);
+		this->stopping = true;
+	};
+	this->requestCondition.notify_all();
+	
+	for(int i = 0; i < this->workers.size(); i++){
+		this->workers[i].join();
+	};
+	
+	//discard unpublished results
+	Result result;
+	while(this->results.pop(&result)){
+		this->discardResult(result);
+	};
+	
+	//discard requests that were never started
+	for(int i = 0; i < this->requests.size(); i++){
+		delete this->requests[i].promise;
+		delete this->requests[i].texturePromise;
+	};
+};
+
+//request mesh
+std::future<bool> AssetLoader::requestMesh(std::string filePath, Mesh * mesh, std::string textureFilePath, Bitmap * texture, Vec4f placeholderMin, Vec4f placeholderMax, MeshProcessFunction process, std::future<bool> * textureLoaded){
+	//show placeholder until the mesh is published
+	Mesh::createBoxMesh(mesh, placeholderMin, placeholderMax);
+	
+	//create request
+	Request request;
+	request.filePath = filePath;
+	request.textureFilePath = textureFilePath;
+	request.mesh = mesh;
+	request.texture = texture;
+	request.process = process;
+	request.promise = new std::promise<bool>();
+	request.texturePromise = textureLoaded != nullptr ? new std::promise<bool>() : nullptr;
+	
+	std::future<bool> future = request.promise->get_future();
+	
+	if(textureLoaded != nullptr){
+		*textureLoaded = request.texturePromise->get_future();
+	};
+	
+	//queue request
+	{
+		std::lock_guard<std::mutex> lock(this->requestMutex);
+		this->requests.push_back(request);
+	};
+	this->requestCondition.notify_one();
+	
+	this->pendingCount++;
+	
+	return future;
+};
+
+//publish loaded assets
+int AssetLoader::publishLoadedAssets(){
+	int count = 0;
+	Result result;
+	
+	while(this->results.pop(&result)){
+		if(result.success){
+			//swap loaded data into the requested mesh and bitmap (the old data is freed with the loaded objects)
+			std::swap(*result.mesh, *result.loadedMesh);
+			
+			if(result.textureSuccess){
+				std::swap(*result.texture, *result.loadedTexture);
+			};
+		};
+		
+		delete result.loadedMesh;
+		delete[] result.loadedTexture->pixels;
+		delete result.loadedTexture;
+		
+		result.promise->set_value(result.success);
+		delete result.promise;
+		
+		if(result.texturePromise != nullptr){
+			result.texturePromise->set_value(result.textureSuccess);
+			delete result.texturePromise;
+		};
+		
+		this->pendingCount--;
+		count++;
+	};
+	
+	return count;
+};
+
+//get pending count
+int AssetLoader::getPendingCount(){
+	return this->pendingCount;
+};
+
+//worker loop
+void AssetLoader::workerLoop(){
+	while(true){
+		//wait for a request
+		Request request;
+		{
+			std::unique_lock<std::mutex> lock(this->requestMutex);
+			this->requestCondition.wait(lock, [this](){
+				return this->stopping || this->requests.size() > 0;
+			});
+			
+			if(this->stopping){
+				return;
+			};
+			
+			request = this->requests.front();
+			this->requests.pop_front();
+		};
+		
+		//load into separate objects, so the render thread can keep drawing the requested mesh
+		Result result;
+		result.mesh = request.mesh;
+		result.texture = request.texture;
+		result.loadedMesh = new Mesh();
+		result.loadedTexture = new Bitmap();
+		result.promise = request.promise;
+		result.texturePromise = request.texturePromise;
+		
+		result.success = Mesh::loadMeshFromObjFile(request.filePath, result.loadedMesh, "", nullptr);
+		result.textureSuccess = false;
+		
+		if(result.success && request.texture != nullptr){
+			result.textureSuccess = Bitmap::loadBitmapFromFile(request.textureFilePath.c_str(), result.loadedTexture);
+			
+			//triangles refer to the requested bitmap, which will hold the loaded texture once published
+			//if the texture failed to load, the mesh is kept and drawn untextured
+			if(result.textureSuccess){
+				for(int i = 0; i < result.loadedMesh->triangles.size(); i++){
+					result.loadedMesh->triangles[i].texture = request.texture;
+				};
+			};
+		};
+		
+		//run processing function (without a texture if it did not load)
+		if(result.success && request.process != nullptr){
+			request.process(result.loadedMesh, result.textureSuccess ? result.loadedTexture : nullptr);
+		};
+		
+		//publish result to the render thread (waiting if the queue is full)
+		while(!this->results.push(result)){
+			//nothing will publish the result once the loader is being destroyed
+			{
+				std::lock_guard<std::mutex> lock(this->requestMutex);
+				
+				if(this->stopping){
+					this->discardResult(result);
+					return;
+				};
+			};
+			
+			std::this_thread::yield();
+		};
+	};
+};
+
+//discard result
+void AssetLoader::discardResult(Result result){
+	delete result.loadedMesh;
+	delete[] result.loadedTexture->pixels;
+	delete result.loadedTexture;
+	delete result.promise;
+	delete result.texturePromise;
+};
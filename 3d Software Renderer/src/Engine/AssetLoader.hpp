@@ -0,0 +1,97 @@
+//AssetLoader.hpp
+
+#ifndef ASSET_LOADER_HPP
+#define ASSET_LOADER_HPP
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <functional>
+#include "Mesh.hpp"
+#include "Bitmap.hpp"
+#include "LockFreeQueue.hpp"
+
+/*
+	Notes about asynchronous asset loading:
+	Loading a large .obj file takes long enough to delay the first frame (and to cause a hitch if done mid-game), so meshes and textures
+	are loaded on background threads:
+		1. requestMesh fills the mesh with a bounding box placeholder, queues the request and returns a future immediately
+		2. a worker thread reads and decodes the files into a separate mesh and bitmap, then runs the optional processing function
+		   (e.g. optimisation or quantization) on them
+		3. the worker pushes the result onto a lock-free queue
+		4. the render thread calls publishLoadedAssets once per frame, which swaps loaded data into the requested mesh and bitmap
+		   and completes the futures
+	A texture that fails to load does not fail the mesh: the mesh is published untextured, and the failure is reported through its own
+	future (if one was asked for).
+	The mesh and bitmap passed to requestMesh are only ever modified by the render thread (in step 4), so they can be drawn safely while
+	loading is in progress.
+*/
+
+//mesh processing function (run on the worker thread after loading)
+typedef std::function<void(Mesh *, Bitmap *)> MeshProcessFunction;
+
+//declare class
+class AssetLoader {
+	public:
+		//constructor
+		AssetLoader(int threadCount);
+		
+		//destructor
+		~AssetLoader();
+		
+		//request mesh
+		//mesh and texture must stay alive until the request has been published
+		//the returned future tells whether the mesh loaded, and textureLoaded (if given) is set to a future telling whether the texture did
+		std::future<bool> requestMesh(std::string filePath, Mesh * mesh, std::string textureFilePath, Bitmap * texture, Vec4f placeholderMin, Vec4f placeholderMax, MeshProcessFunction process = nullptr, std::future<bool> * textureLoaded = nullptr);
+		
+		//publish loaded assets (call once per frame on the render thread), returns number of assets published
+		int publishLoadedAssets();
+		
+		//get number of requests that have not been published yet
+		int getPendingCount();
+	
+	private:
+		//request
+		struct Request {
+			std::string filePath;
+			std::string textureFilePath;
+			Mesh * mesh;
+			Bitmap * texture;
+			MeshProcessFunction process;
+			std::promise<bool> * promise;
+			std::promise<bool> * texturePromise; //nullptr if the texture's result was not asked for
+		};
+		
+		//result
+		struct Result {
+			Mesh * mesh;
+			Bitmap * texture;
+			Mesh * loadedMesh;
+			Bitmap * loadedTexture;
+			bool success;
+			bool textureSuccess;
+			std::promise<bool> * promise;
+			std::promise<bool> * texturePromise;
+		};
+		
+		//worker thread function
+		void workerLoop();
+		
+		//free a result that will not be published
+		void discardResult(Result result);
+		
+		//data members
+		std::vector<std::thread> workers;
+		std::deque<Request> requests;
+		std::mutex requestMutex;
+		std::condition_variable requestCondition;
+		LockFreeQueue<Result> results;
+		bool stopping;
+		int pendingCount;
+};
+
+#endif
@@ -4,47 +4,166 @@
 #define BITMAP_HPP
 
 #include "Pixel.hpp"
-#include <fstream>
+#include "MappedFile.hpp"
+#include "PNGDecoder.hpp"
+#include <string.h>
+#include <vector>
+
+/*
+	Notes about bitmap layout:
+	Pixels are stored as one Pixel (blue, green, red) per texel, with no padding between rows, and the bottom row first - so a texture
+	coordinate of (0, 0) is the bottom-left of the image, matching .obj texture coordinates. infoHeader.biWidth and infoHeader.biHeight
+	always hold the (positive) dimensions, whichever format the image was loaded from.
+	
+	Notes about the .bmp file format:
+	A BITMAPFILEHEADER (14 bytes, starting with "BM" and giving the offset of the pixel data) is followed by a BITMAPINFOHEADER.
+	Each row of pixels is padded to a multiple of 4 bytes. If biHeight is positive, the rows are stored bottom-up, otherwise top-down.
+*/
 
 class Bitmap {
 	public:
 		BITMAPFILEHEADER fileHeader;
 		BITMAPINFOHEADER infoHeader;
-		Pixel * pixels;
+		Pixel * pixels = nullptr;
 		
-		static void loadBitmapFromBMPFile(const char * filePath, Bitmap * bitmap){
-			//open file
-			std::ifstream file;
-			file.open(filePath);
-			
-			if(file.is_open()){
-				//read file header
-				file.read((char*) &bitmap->fileHeader, sizeof(BITMAPFILEHEADER));
-				file.read((char*) &bitmap->infoHeader, sizeof(BITMAPINFOHEADER));
-				
-				//allocate pixel buffer
-				bitmap->pixels = new Pixel[bitmap->infoHeader.biWidth * bitmap->infoHeader.biHeight];
-				
-				Pixel newPixel;
+		//load bitmap from file
+		//the format is detected from the start of the file, so .bmp and .png files can be used interchangeably
+		static bool loadBitmapFromFile(const char * filePath, Bitmap * bitmap){
+			MappedFile file(filePath);
+			
+			if(!file.isOpen()){
+				return false;
+			};
+			
+			if(file.getSize() >= 2 && file.getData()[0] == 'B' && file.getData()[1] == 'M'){
+				return Bitmap::loadBitmapFromBMPData(file.getData(), file.getSize(), bitmap);
+			};
+			
+			return Bitmap::loadBitmapFromPNGData(file.getData(), file.getSize(), bitmap);
+		};
+		
+		static bool loadBitmapFromBMPFile(const char * filePath, Bitmap * bitmap){
+			MappedFile file(filePath);
+			
+			if(!file.isOpen()){
+				return false;
+			};
+			
+			return Bitmap::loadBitmapFromBMPData(file.getData(), file.getSize(), bitmap);
+		};
+		
+		static bool loadBitmapFromPNGFile(const char * filePath, Bitmap * bitmap){
+			MappedFile file(filePath);
+			
+			if(!file.isOpen()){
+				return false;
+			};
+			
+			return Bitmap::loadBitmapFromPNGData(file.getData(), file.getSize(), bitmap);
+		};
+		
+		//load bitmap from .bmp data in memory
+		static bool loadBitmapFromBMPData(const uint8_t * data, size_t size, Bitmap * bitmap){
+			//read headers
+			if(size < sizeof(BITMAPFILEHEADER) + sizeof(BITMAPINFOHEADER)){
+				return false;
+			};
+			
+			BITMAPFILEHEADER fileHeader;
+			BITMAPINFOHEADER infoHeader;
+			memcpy(&fileHeader, data, sizeof(BITMAPFILEHEADER));
+			memcpy(&infoHeader, data + sizeof(BITMAPFILEHEADER), sizeof(BITMAPINFOHEADER));
+			
+			//only uncompressed 24-bit and 32-bit images are supported (32-bit bitfield images are assumed to use the standard BGRA masks)
+			int bytesPerPixel = infoHeader.biBitCount / 8;
+			
+			if(fileHeader.bfType != 0x4D42 || (infoHeader.biBitCount != 24 && infoHeader.biBitCount != 32) || (infoHeader.biCompression != BI_RGB && !(infoHeader.biCompression == BI_BITFIELDS && infoHeader.biBitCount == 32))){
+				return false;
+			};
+			
+			int width = infoHeader.biWidth;
+			int height = infoHeader.biHeight < 0 ? -infoHeader.biHeight : infoHeader.biHeight;
+			bool topDown = infoHeader.biHeight < 0;
+			
+			//each row is padded to a multiple of 4 bytes
+			size_t stride = ((size_t) width * bytesPerPixel + 3) & ~(size_t) 3;
+			
+			if(width <= 0 || height <= 0 || fileHeader.bfOffBits > size || stride * height > size - fileHeader.bfOffBits){
+				return false;
+			};
+			
+			//allocate pixel buffer
+			Bitmap::allocatePixels(bitmap, width, height);
+			bitmap->fileHeader = fileHeader;
+			
+			//convert rows
+			const uint8_t * pixelData = data + fileHeader.bfOffBits;
+			
+			for(int i = 0; i < height; i++){
+				//rows are stored bottom row first, so top-down images are flipped
+				const uint8_t * row = pixelData + stride * (topDown ? height - 1 - i : i);
+				Pixel * destination = bitmap->pixels + (size_t) width * i;
 				
-				//iterate through rows
-				for(int i = 0; i < bitmap->infoHeader.biHeight; i++){
-					for(int j = 0; j < bitmap->infoHeader.biWidth; j++){
-						//read pixel
-						int index = bitmap->infoHeader.biWidth * i + j;
-						file.read((char*) &bitmap->pixels[index], sizeof(Pixel));
-						//file >> bitmap->pixels[index].red;
-						//file >> bitmap->pixels[index].green;
-						//file >> bitmap->pixels[index].blue;
-						//std::cout << "r: " << (int) bitmap->pixels[index].red << ", g: " << (int) bitmap->pixels[index].green << ", b: " << (int) bitmap->pixels[index].blue << std::endl;
+				if(bytesPerPixel == 3){
+					//24-bit rows are already in the same layout as Pixel
+					memcpy(destination, row, (size_t) width * sizeof(Pixel));
+				} else {
+					for(int j = 0; j < width; j++){
+						destination[j].blue = row[j * 4];
+						destination[j].green = row[j * 4 + 1];
+						destination[j].red = row[j * 4 + 2];
 					};
-					
-					//read buffer pad at the end of the scanline
-					int leftOverBytes = (bitmap->infoHeader.biWidth * sizeof(Pixel)) % 4;
-					file.ignore(leftOverBytes);
 				};
 			};
+			
+			return true;
+		};
+		
+		//load bitmap from .png data in memory
+		static bool loadBitmapFromPNGData(const uint8_t * data, size_t size, Bitmap * bitmap){
+			int width;
+			int height;
+			std::vector<uint8_t> rgba;
+			
+			if(!PNGDecoder::decode(data, size, &width, &height, &rgba)){
+				return false;
+			};
+			
+			//allocate pixel buffer
+			Bitmap::allocatePixels(bitmap, width, height);
+			
+			//convert rows (png images are stored top row first, so rows are flipped)
+			for(int i = 0; i < height; i++){
+				const uint8_t * row = rgba.data() + (size_t) width * 4 * (height - 1 - i);
+				Pixel * destination = bitmap->pixels + (size_t) width * i;
+				
+				for(int j = 0; j < width; j++){
+					destination[j].red = row[j * 4];
+					destination[j].green = row[j * 4 + 1];
+					destination[j].blue = row[j * 4 + 2];
+				};
+			};
+			
+			return true;
+		};
+	
+	private:
+		//allocate pixel buffer and fill out headers to describe it
+		static void allocatePixels(Bitmap * bitmap, int width, int height){
+			//free previous image
+			delete[] bitmap->pixels;
+			bitmap->pixels = new Pixel[(size_t) width * height];
+			
+			memset(&bitmap->fileHeader, 0, sizeof(BITMAPFILEHEADER));
+			memset(&bitmap->infoHeader, 0, sizeof(BITMAPINFOHEADER));
+			bitmap->fileHeader.bfType = 0x4D42;
+			bitmap->infoHeader.biSize = sizeof(BITMAPINFOHEADER);
+			bitmap->infoHeader.biWidth = width;
+			bitmap->infoHeader.biHeight = height;
+			bitmap->infoHeader.biPlanes = 1;
+			bitmap->infoHeader.biBitCount = sizeof(Pixel) * 8;
+			bitmap->infoHeader.biCompression = BI_RGB;
 		};
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -5,60 +5,197 @@
 //constructor
 Camera::Camera(){
 	this->position = Vec4f(0.0f, 0.0f, 0.0f, 1.0f);
-	this->rotation = Vec4f(0.0f, 0.0f, 0.0f, 0.0f);
+	this->orientation = Quaternion();
+	this->tanHalfFov = 1;
+	this->aspectRatio = 1;
+	this->nearDistance = 1;
+	this->farDistance = 0;
+	this->version = 0;
+	this->cacheDirty = true;
 };
 
 Camera::Camera(double px, double py, double pz, double rx, double ry, double rz){
 	this->position = Vec4f(px, py, pz, 1.0f);
-	this->rotation = Vec4f(rx, ry, rz, 0.0f);
+	this->orientation = Camera::createOrientation(Vec4f(rx, ry, rz, 0.0f));
+	this->tanHalfFov = 1;
+	this->aspectRatio = 1;
+	this->nearDistance = 1;
+	this->farDistance = 0;
+	this->version = 0;
+	this->cacheDirty = true;
 };
 
 Camera::Camera(Vec4f position, Vec4f rotation){
 	this->position = position;
-	this->rotation = rotation;
+	this->orientation = Camera::createOrientation(rotation);
+	this->tanHalfFov = 1;
+	this->aspectRatio = 1;
+	this->nearDistance = 1;
+	this->farDistance = 0;
+	this->version = 0;
+	this->cacheDirty = true;
 };
 
 //get camera transformation matrix
 Mat4x4f Camera::getCameraTransformationMatrix(){
-	//translate then rotate around y axis, then x axis, then z axis	
-	//Z(X(Y(TV))
-	//note that operations are applied in reverse, because we move the world relative to the camera, rather than the other way around
-	return Math::matrixProduct(Math::matrixProduct(Math::rotationAroundZAxis(-this->rotation.z), Math::matrixProduct(Math::rotationAroundXAxis(-this->rotation.x), Math::rotationAroundYAxis(-this->rotation.y))), Math::translationMatrix(Math::scalarProduct(-1.0f, this->position)));
+	this->updateCache();
+	return this->transformationMatrix;
+};
+	
+//get projection matrix
+Mat4x4f Camera::getProjectionMatrix(){
+	this->updateCache();
+	return this->projectionMatrix;
+};
+
+//get view-projection matrix
+Mat4x4f Camera::getViewProjectionMatrix(){
+	this->updateCache();
+	return this->viewProjectionMatrix;
+};
+
+//get view frustum
+Frustum Camera::getViewFrustum(){
+	this->updateCache();
+	return this->viewFrustum;
+};
+
+//get frustum
+Frustum Camera::getFrustum(){
+	this->updateCache();
+	return this->frustum;
 };
 
 //get direction vector
 Vec4f Camera::getDirectionVector(){
-	Mat4x4f rotationMatrix = Math::rotationMatrix(Math::scalarProduct(1, this->rotation));
-	Vec4f dir(0.0f, 0.0f, 1.0f, 0.0f);
-	return Math::matrixProduct(rotationMatrix, dir);
+	return Math::quaternionRotate(this->orientation, Vec4f(0.0f, 0.0f, 1.0f, 0.0f));
+};
+
+//get right vector
+Vec4f Camera::getRightVector(){
+	return Math::quaternionRotate(this->orientation, Vec4f(1.0f, 0.0f, 0.0f, 0.0f));
 };
 	
+//get position
+Vec4f Camera::getPosition(){
+	return this->position;
+};
+
+//get orientation
+Quaternion Camera::getOrientation(){
+	return this->orientation;
+};
+
+//get version
+int Camera::getVersion(){
+	return this->version;
+};
+
+//set position
+void Camera::setPosition(Vec4f position){
+	this->position = position;
+	this->markChanged();
+};
+
+//set orientation
+void Camera::setOrientation(Quaternion orientation){
+	this->orientation = Math::normalise(orientation);
+	this->markChanged();
+};
+
+//set projection
+void Camera::setProjection(double tanHalfFov, double aspectRatio, double nearDistance, double farDistance){
+	if(tanHalfFov == this->tanHalfFov && aspectRatio == this->aspectRatio && nearDistance == this->nearDistance && farDistance == this->farDistance){
+		return;
+	};
+	
+	this->tanHalfFov = tanHalfFov;
+	this->aspectRatio = aspectRatio;
+	this->nearDistance = nearDistance;
+	this->farDistance = farDistance;
+	this->markChanged();
+};
+
 //point at vertex
+//the pitch is the angle above the horizontal plane (x and z), and positive yaw turns towards -x
 void Camera::pointAtVertex(Vec4f point){
 	Vec4f direction = point - this->position;
-	this->rotation.x = atan2(direction.y, sqrt(direction.x * direction.x + direction.y * direction.y));
-	this->rotation.y = atan2(direction.x, direction.z);
-	this->rotation.z = 0;
+	double pitch = atan2(direction.y, sqrt(direction.x * direction.x + direction.z * direction.z));
+	double yaw = atan2(-direction.x, direction.z);
+	
+	this->orientation = Camera::createOrientation(Vec4f(pitch, yaw, 0.0f, 0.0f));
+	this->markChanged();
 };
 
 //move
 void Camera::move(Vec4f translation){
 	this->position += translation;
+	this->markChanged();
 };
 	
 //rotate
+//yaw turns around the world's y axis, and pitch and roll around the camera's own x and z axes
 void Camera::rotate(Vec4f angle){
-	this->rotation += angle;
+	Quaternion yaw = Math::quaternionFromAxisAngle(Vec4f(0.0f, 1.0f, 0.0f, 0.0f), -angle.y);
+	Quaternion pitch = Math::quaternionFromAxisAngle(Vec4f(1.0f, 0.0f, 0.0f, 0.0f), -angle.x);
+	Quaternion roll = Math::quaternionFromAxisAngle(Vec4f(0.0f, 0.0f, 1.0f, 0.0f), angle.z);
+	
+	this->orientation = Math::normalise(Math::quaternionProduct(Math::quaternionProduct(yaw, this->orientation), Math::quaternionProduct(pitch, roll)));
+	this->markChanged();
 };
 
 //move forward
 void Camera::moveForward(double distance){
 	this->position += Math::scalarProduct(distance, this->getDirectionVector());
+	this->markChanged();
 };
 
 //move right
 void Camera::moveRight(double distance){
-	//get right vector using up vector and right vector
-	Vec4f worldUp(0.0f, 1.0f, 0.0f, 0.0f);
-	this->position += Math::scalarProduct(distance, Math::crossProduct(worldUp, this->getDirectionVector()));
-};
\ No newline at end of file
+	this->position += Math::scalarProduct(distance, this->getRightVector());
+	this->markChanged();
+};
+
+//mark changed
+void Camera::markChanged(){
+	this->cacheDirty = true;
+	this->version++;
+};
+
+//update cache
+void Camera::updateCache(){
+	if(!this->cacheDirty){
+		return;
+	};
+	
+	//the view transform undoes the camera's translation, then its rotation (the inverse of a rotation matrix is its transpose)
+	Mat4x4f rotation = Math::matrixTranspose(Math::quaternionToMatrix(this->orientation));
+	this->transformationMatrix = Math::matrixProduct(rotation, Math::translationMatrix(-this->position.x, -this->position.y, -this->position.z));
+	
+	//projection (w is set to z, and z to 1, so dividing by w gives 1 / z)
+	this->projectionMatrix = Math::identityMatrix();
+	this->projectionMatrix.data[0][0] = 1 / this->tanHalfFov;
+	this->projectionMatrix.data[1][1] = this->aspectRatio / this->tanHalfFov;
+	this->projectionMatrix.data[2][2] = 0;
+	this->projectionMatrix.data[2][3] = 1;
+	this->projectionMatrix.data[3][2] = 1;
+	this->projectionMatrix.data[3][3] = 0;
+	
+	this->viewProjectionMatrix = Math::matrixProduct(this->projectionMatrix, this->transformationMatrix);
+	
+	//frustum
+	this->viewFrustum = Frustum::createViewFrustum(this->tanHalfFov, this->aspectRatio, this->nearDistance, this->farDistance);
+	this->frustum = Frustum::transformFrustum(this->viewFrustum, this->transformationMatrix);
+	
+	this->cacheDirty = false;
+};
+
+//create orientation
+//this is the same rotation as the rotation matrices Y(y), X(x) and Z(z), the inverse of the view rotation Z(-z) X(-x) Y(-y) (see notes on the camera)
+Quaternion Camera::createOrientation(Vec4f rotation){
+	Quaternion yaw = Math::quaternionFromAxisAngle(Vec4f(0.0f, 1.0f, 0.0f, 0.0f), -rotation.y);
+	Quaternion pitch = Math::quaternionFromAxisAngle(Vec4f(1.0f, 0.0f, 0.0f, 0.0f), -rotation.x);
+	Quaternion roll = Math::quaternionFromAxisAngle(Vec4f(0.0f, 0.0f, 1.0f, 0.0f), rotation.z);
+	
+	return Math::quaternionProduct(yaw, Math::quaternionProduct(pitch, roll));
+};
@@ -4,6 +4,21 @@
 #define CAMERA_HPP
 
 #include "Mathematics.hpp"
+#include "Frustum.hpp"
+
+/*
+	Notes about the camera:
+	The camera's orientation is a unit quaternion, which rotates camera space (looking along +z, with +y up) into world space. Turning
+	the camera multiplies it by small rotations, which cannot lock up like Euler angles can and do not need trig functions to find the
+	camera's direction.
+	
+	Rotations are given as Euler angles (x pitches, y yaws, z rolls). Yaw turns around the world's y axis, so the horizon stays level,
+	and pitch and roll turn around the camera's own axes. Without roll, this is the same as adding the angles up.
+	
+	Everything the renderer derives from the camera (the view, projection and view-projection matrices, and the frustum in view and world
+	space) is cached, and only recalculated after the camera has moved, turned or had its projection changed. Each change increments the
+	camera's version, so other code can keep its own camera-derived data and compare versions to tell when to recalculate it.
+*/
 
 //create camera class
 class Camera {
@@ -14,12 +29,44 @@ class Camera {
 		Camera(double px, double py, double pz, double rx, double ry, double rz);
 		Camera(Vec4f position, Vec4f rotation);
 		
-		//get camera transformation matrix
+		//get camera transformation matrix (world space to view space)
 		Mat4x4f getCameraTransformationMatrix();
 		
+		//get projection matrix
+		//maps view space to (x / (z * tanHalfFov), y * aspectRatio / (z * tanHalfFov), 1 / z) after dividing by w, which is what the renderer draws
+		Mat4x4f getProjectionMatrix();
+		
+		//get view-projection matrix (world space to projection)
+		Mat4x4f getViewProjectionMatrix();
+		
+		//get frustum in view space and world space
+		Frustum getViewFrustum();
+		Frustum getFrustum();
+		
 		//get direction vector
 		Vec4f getDirectionVector();
 		
+		//get right vector
+		Vec4f getRightVector();
+		
+		//get position
+		Vec4f getPosition();
+		
+		//get orientation
+		Quaternion getOrientation();
+		
+		//get version (changes whenever the camera or its projection changes)
+		int getVersion();
+		
+		//set position
+		void setPosition(Vec4f position);
+		
+		//set orientation
+		void setOrientation(Quaternion orientation);
+		
+		//set projection (only changes the version if one of the values has changed, a far distance of 0 means there is no far plane)
+		void setProjection(double tanHalfFov, double aspectRatio, double nearDistance, double farDistance);
+		
 		//point at vertex
 		void pointAtVertex(Vec4f point);
 		
@@ -33,14 +80,35 @@ class Camera {
 		void moveForward(double distance);
 		
 		//move right
-		void Camera::moveRight(double distance);
+		void moveRight(double distance);
 		
 	//private
 	private:
+		//mark cached data out of date
+		void markChanged();
+		
+		//recalculate cached data
+		void updateCache();
+		
+		//create orientation from Euler angles
+		static Quaternion createOrientation(Vec4f rotation);
+		
 		//private data members
 		Vec4f position;
-		Vec4f rotation;
+		Quaternion orientation;
+		double tanHalfFov;
+		double aspectRatio;
+		double nearDistance;
+		double farDistance;
+		int version;
 		
+		//cached data
+		bool cacheDirty;
+		Mat4x4f transformationMatrix;
+		Mat4x4f projectionMatrix;
+		Mat4x4f viewProjectionMatrix;
+		Frustum viewFrustum;
+		Frustum frustum;
 };
 
-#endif
\ No newline at end of file
+#endif
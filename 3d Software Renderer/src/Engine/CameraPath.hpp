@@ -0,0 +1,140 @@
+//CameraPath.hpp
+
+#ifndef CAMERA_PATH_HPP
+#define CAMERA_PATH_HPP
+
+#include <vector>
+#include "Mathematics.hpp"
+#include "Camera.hpp"
+
+/*
+	Notes about camera paths:
+	A camera path is a list of keyframes (a time, position and orientation), recorded from a camera or added by hand, which can be
+	replayed by moving a camera to the path's position at any time between the keyframes.
+	
+	Positions are interpolated with a Catmull-Rom spline, which passes through every keyframe and has no sudden change of direction at
+	them (the tangent at a keyframe is found from the keyframes either side). Orientations are interpolated with slerp, which turns at a
+	constant speed along the shortest arc; interpolating Euler angles instead makes the camera wobble, and can turn the long way round.
+	
+	Keyframes must be added in order of time. Times before the first keyframe or after the last are clamped to it.
+*/
+
+//declare class
+class CameraPath {
+	public:
+		//constructor
+		CameraPath(){
+		};
+		
+		//add keyframe
+		void addKeyframe(double time, Vec4f position, Quaternion orientation){
+			Keyframe keyframe;
+			keyframe.time = time;
+			keyframe.position = position;
+			keyframe.orientation = orientation;
+			this->keyframes.push_back(keyframe);
+		};
+		
+		//add keyframe from camera (for recording a path)
+		void addKeyframe(double time, Camera * camera){
+			this->addKeyframe(time, camera->getPosition(), camera->getOrientation());
+		};
+		
+		//clear keyframes
+		void clear(){
+			this->keyframes.clear();
+		};
+		
+		//get keyframe count
+		int getKeyframeCount(){
+			return this->keyframes.size();
+		};
+		
+		//get duration (time of the last keyframe)
+		double getDuration(){
+			if(this->keyframes.size() == 0){
+				return 0;
+			};
+			
+			return this->keyframes.back().time;
+		};
+		
+		//apply path to camera at a time
+		void apply(double time, Camera * camera){
+			if(this->keyframes.size() == 0){
+				return;
+			};
+			
+			//clamp to the ends of the path
+			if(time <= this->keyframes.front().time || this->keyframes.size() == 1){
+				camera->setPosition(this->keyframes.front().position);
+				camera->setOrientation(this->keyframes.front().orientation);
+				return;
+			};
+			
+			if(time >= this->keyframes.back().time){
+				camera->setPosition(this->keyframes.back().position);
+				camera->setOrientation(this->keyframes.back().orientation);
+				return;
+			};
+			
+			//find the keyframes either side of the time
+			int i = 0;
+			while(this->keyframes[i + 1].time <= time){
+				i++;
+			};
+			
+			Keyframe & a = this->keyframes[i];
+			Keyframe & b = this->keyframes[i + 1];
+			double duration = b.time - a.time;
+			double t = (time - a.time) / duration;
+			
+			//find tangents (scaled to this segment's duration, so keyframes that are not evenly spaced do not overshoot)
+			Vec4f tangentA = this->getTangent(i, duration);
+			Vec4f tangentB = this->getTangent(i + 1, duration);
+			
+			//cubic Hermite basis functions
+			double t2 = t * t;
+			double t3 = t2 * t;
+			double h00 = 2 * t3 - 3 * t2 + 1;
+			double h10 = t3 - 2 * t2 + t;
+			double h01 = -2 * t3 + 3 * t2;
+			double h11 = t3 - t2;
+			
+			Vec4f position(
+				h00 * a.position.x + h10 * tangentA.x + h01 * b.position.x + h11 * tangentB.x,
+				h00 * a.position.y + h10 * tangentA.y + h01 * b.position.y + h11 * tangentB.y,
+				h00 * a.position.z + h10 * tangentA.z + h01 * b.position.z + h11 * tangentB.z,
+				1.0f
+			);
+			
+			camera->setPosition(position);
+			camera->setOrientation(Math::slerp(a.orientation, b.orientation, t));
+		};
+	
+	private:
+		//keyframe
+		struct Keyframe {
+			double time;
+			Vec4f position;
+			Quaternion orientation;
+		};
+		
+		//get tangent at a keyframe, scaled to a segment's duration
+		//the tangent is the velocity between the keyframes either side (or the keyframe and its one neighbour, at the ends)
+		Vec4f getTangent(int index, double duration){
+			int previous = index > 0 ? index - 1 : index;
+			int next = index < this->keyframes.size() - 1 ? index + 1 : index;
+			
+			Keyframe & a = this->keyframes[previous];
+			Keyframe & b = this->keyframes[next];
+			double scale = duration / (b.time - a.time);
+			
+			return Vec4f((b.position.x - a.position.x) * scale, (b.position.y - a.position.y) * scale, (b.position.z - a.position.z) * scale, 0.0f);
+		};
+		
+		//data members
+		std::vector<Keyframe> keyframes;
+};
+
+#endif
@@ -0,0 +1,408 @@
+//CellGraph.cpp
+
+#include "CellGraph.hpp"
+
+//constructor
+CellGraph::CellGraph(){
+	this->usePotentiallyVisibleSets = false;
+	this->potentiallyVisibleSetsBuilt = false;
+	this->visitedCellCount = 0;
+};
+
+//add cell
+int CellGraph::addCell(Vec4f min, Vec4f max){
+	Cell cell;
+	cell.min = min;
+	cell.max = max;
+	cell.outsideVisible = false;
+	
+	this->cells.push_back(cell);
+	this->potentiallyVisibleSetsBuilt = false;
+	return this->cells.size() - 1;
+};
+
+//add portal
+int CellGraph::addPortal(int cellA, int cellB, std::vector<Vec4f> vertices){
+	Portal portal;
+	portal.cells[0] = cellA;
+	portal.cells[1] = cellB;
+	portal.vertices = vertices;
+	
+	//find the plane of the polygon (Newell's method, which works for any winding and is not thrown by nearly collinear vertices)
+	Vec4f normal(0.0f, 0.0f, 0.0f, 0.0f);
+	Vec4f centre(0.0f, 0.0f, 0.0f, 1.0f);
+	
+	for(int i = 0; i < vertices.size(); i++){
+		Vec4f & current = vertices[i];
+		Vec4f & next = vertices[(i + 1) % vertices.size()];
+		
+		normal.x += (current.y - next.y) * (current.z + next.z);
+		normal.y += (current.z - next.z) * (current.x + next.x);
+		normal.z += (current.x - next.x) * (current.y + next.y);
+		
+		centre.x += current.x / vertices.size();
+		centre.y += current.y / vertices.size();
+		centre.z += current.z / vertices.size();
+	};
+	
+	double length = Math::magnitude(normal);
+	portal.plane.normal = Vec4f(normal.x / length, normal.y / length, normal.z / length, 0.0f);
+	portal.plane.distance = -Math::dotProduct(portal.plane.normal, centre);
+	
+	//point the normal into cell B (away from the centre of cell A, or towards the centre of cell B if A is the outside)
+	int facingCell = cellA != CELL_OUTSIDE ? cellA : cellB;
+	Cell & cell = this->cells[facingCell];
+	Vec4f cellCentre((cell.min.x + cell.max.x) / 2, (cell.min.y + cell.max.y) / 2, (cell.min.z + cell.max.z) / 2, 1.0f);
+	bool cellInFront = Math::dotProduct(portal.plane.normal, cellCentre) + portal.plane.distance > 0;
+	
+	if(cellInFront == (facingCell == cellA)){
+		portal.plane.normal = Vec4f(-portal.plane.normal.x, -portal.plane.normal.y, -portal.plane.normal.z, 0.0f);
+		portal.plane.distance = -portal.plane.distance;
+	};
+	
+	this->portals.push_back(portal);
+	
+	//link cells to portal
+	int portalIndex = this->portals.size() - 1;
+	
+	if(cellA != CELL_OUTSIDE){
+		this->cells[cellA].portals.push_back(portalIndex);
+	};
+	
+	if(cellB != CELL_OUTSIDE){
+		this->cells[cellB].portals.push_back(portalIndex);
+	};
+	
+	this->potentiallyVisibleSetsBuilt = false;
+	return portalIndex;
+};
+
+//add model
+void CellGraph::addModel(int cell, Model * model){
+	this->cells[cell].models.push_back(model);
+};
+
+//clear
+void CellGraph::clear(){
+	this->cells.clear();
+	this->portals.clear();
+	this->potentiallyVisibleSetsBuilt = false;
+};
+
+//build potentially visible sets
+void CellGraph::buildPotentiallyVisibleSets(){
+	std::vector<int> chain;
+	std::vector<bool> visible;
+	
+	for(int i = 0; i < this->cells.size(); i++){
+		Cell & cell = this->cells[i];
+		
+		//walk every portal chain from the cell
+		visible.assign(this->cells.size(), false);
+		visible[i] = true;
+		cell.outsideVisible = false;
+		
+		chain.clear();
+		this->findVisibleCells(i, i, &chain, &visible, &cell.outsideVisible);
+		
+		//store the cells that were reached (not including the cell itself)
+		cell.visibleCells.clear();
+		
+		for(int j = 0; j < this->cells.size(); j++){
+			if(visible[j] && j != i){
+				cell.visibleCells.push_back(j);
+			};
+		};
+	};
+	
+	this->potentiallyVisibleSetsBuilt = true;
+};
+
+//find cell
+int CellGraph::findCell(Vec4f position){
+	for(int i = 0; i < this->cells.size(); i++){
+		Cell & cell = this->cells[i];
+		
+		if(position.x >= cell.min.x && position.x <= cell.max.x && position.y >= cell.min.y && position.y <= cell.max.y && position.z >= cell.min.z && position.z <= cell.max.z){
+			return i;
+		};
+	};
+	
+	return CELL_OUTSIDE;
+};
+
+//query frustum
+bool CellGraph::queryFrustum(Vec4f cameraPosition, Frustum * frustum, std::vector<Model *> * visibleModels, std::vector<Frustum> * outsideFrustums){
+	this->visitedCellCount = 0;
+	this->addedModels.clear();
+	
+	int cellIndex = this->findCell(cameraPosition);
+	
+	if(cellIndex == CELL_OUTSIDE){
+		return false;
+	};
+	
+	//use the potentially visible set if it has been built, otherwise walk the portals
+	if(this->usePotentiallyVisibleSets && this->potentiallyVisibleSetsBuilt){
+		Cell & cell = this->cells[cellIndex];
+		
+		this->addVisibleModels(&cell, frustum, visibleModels);
+		
+		for(int i = 0; i < cell.visibleCells.size(); i++){
+			this->addVisibleModels(&this->cells[cell.visibleCells[i]], frustum, visibleModels);
+		};
+		
+		if(cell.outsideVisible){
+			outsideFrustums->push_back(*frustum);
+		};
+		
+		this->visitedCellCount = 1 + cell.visibleCells.size();
+		return true;
+	};
+	
+	this->visitCell(cellIndex, -1, cameraPosition, frustum, 0, visibleModels, outsideFrustums);
+	return true;
+};
+
+//get cell count
+int CellGraph::getCellCount(){
+	return this->cells.size();
+};
+
+//get visited cell count
+int CellGraph::getVisitedCellCount(){
+	return this->visitedCellCount;
+};
+
+//get use potentially visible sets
+bool CellGraph::getUsePotentiallyVisibleSets(){
+	return this->usePotentiallyVisibleSets;
+};
+
+//set use potentially visible sets
+void CellGraph::setUsePotentiallyVisibleSets(bool usePotentiallyVisibleSets){
+	this->usePotentiallyVisibleSets = usePotentiallyVisibleSets;
+};
+
+//visit cell
+void CellGraph::visitCell(int cellIndex, int fromPortal, Vec4f cameraPosition, Frustum * frustum, int depth, std::vector<Model *> * visibleModels, std::vector<Frustum> * outsideFrustums){
+	Cell & cell = this->cells[cellIndex];
+	this->visitedCellCount++;
+	
+	this->addVisibleModels(&cell, frustum, visibleModels);
+	
+	if(depth == CELL_MAX_PORTAL_DEPTH){
+		return;
+	};
+	
+	//look through each portal, except the one the cell was entered through
+	for(int i = 0; i < cell.portals.size(); i++){
+		int portalIndex = cell.portals[i];
+		
+		if(portalIndex == fromPortal){
+			continue;
+		};
+		
+		Portal & portal = this->portals[portalIndex];
+		int otherCell = portal.cells[0] == cellIndex ? portal.cells[1] : portal.cells[0];
+		
+		//the camera must be on this cell's side of the portal to see through it
+		//the camera's own cell may overlap the cell on the other side, so a camera in (or past) one of its portals sees through it unchanged
+		double side = Math::dotProduct(portal.plane.normal, cameraPosition) + portal.plane.distance;
+		if(portal.cells[0] != cellIndex){
+			side = -side;
+		};
+		
+		Frustum narrowedFrustum;
+		
+		if(side > -CELL_PORTAL_EPSILON){
+			if(depth > 0){
+				continue;
+			};
+			
+			narrowedFrustum = *frustum;
+		} else if(!this->narrowFrustum(&portal, cameraPosition, frustum, &narrowedFrustum)){
+			continue;
+		};
+		
+		if(otherCell == CELL_OUTSIDE){
+			outsideFrustums->push_back(narrowedFrustum);
+		} else {
+			this->visitCell(otherCell, portalIndex, cameraPosition, &narrowedFrustum, depth + 1, visibleModels, outsideFrustums);
+		};
+	};
+};
+
+//add visible models
+void CellGraph::addVisibleModels(Cell * cell, Frustum * frustum, std::vector<Model *> * visibleModels){
+	for(int i = 0; i < cell->models.size(); i++){
+		Model * model = cell->models[i];
+		
+		//a model may be in more than one cell, or seen through more than one portal
+		if(this->addedModels.count(model) > 0){
+			continue;
+		};
+		
+		Bounds bounds = Mesh::transformBounds(model->mesh->bounds, model->getTransformationMatrix());
+		
+		if(frustum->intersectsBox(bounds.min, bounds.max)){
+			visibleModels->push_back(model);
+			this->addedModels.insert(model);
+		};
+	};
+};
+
+//narrow frustum
+/*
+	The portal is first clipped to the frustum, leaving the part of it that can be seen. Every plane is moved to pass through the camera
+	before clipping (which does not change the side planes, as they already do): the near plane would otherwise remove a portal that is
+	closer to the camera than the near plane, even though what is behind it can be seen. The far plane is the exception, as the camera
+	is inside it: it is kept where it is, so portals beyond it are not seen. The narrowed frustum is then made of the planes through the
+	camera and each edge of what is left, and the portal's own plane, so nothing on the camera's side of the portal is inside it, and
+	the far plane, so what is beyond it is still culled in the cells behind the portal.
+*/
+bool CellGraph::narrowFrustum(Portal * portal, Vec4f cameraPosition, Frustum * frustum, Frustum * narrowedFrustum){
+	std::vector<Vec4f> polygon = portal->vertices;
+	
+	for(int i = 0; i < frustum->planeCount && polygon.size() >= 3; i++){
+		Vec4f & normal = frustum->planes[i].normal;
+		CellGraph::clipPolygon(&polygon, normal, i == frustum->farPlane ? frustum->planes[i].distance : -Math::dotProduct(normal, cameraPosition));
+	};
+	
+	if(polygon.size() < 3){
+		return false;
+	};
+	
+	//the inside of the portal plane is the side away from the camera
+	narrowedFrustum->planeCount = 0;
+	narrowedFrustum->farPlane = -1;
+	
+	if(Math::dotProduct(portal->plane.normal, cameraPosition) + portal->plane.distance < 0){
+		narrowedFrustum->addPlane(portal->plane.normal, portal->plane.distance);
+	} else {
+		narrowedFrustum->addPlane(Vec4f(-portal->plane.normal.x, -portal->plane.normal.y, -portal->plane.normal.z, 0.0f), -portal->plane.distance);
+	};
+	
+	//find a point inside the polygon, to point the edge planes inwards
+	Vec4f centre(0.0f, 0.0f, 0.0f, 1.0f);
+	
+	for(int i = 0; i < polygon.size(); i++){
+		centre.x += polygon[i].x / polygon.size();
+		centre.y += polygon[i].y / polygon.size();
+		centre.z += polygon[i].z / polygon.size();
+	};
+	
+	//add a plane through the camera and each edge (if there are too many edges, the frustum is left larger than the portal)
+	for(int i = 0; i < polygon.size(); i++){
+		Vec4f a = polygon[i] - cameraPosition;
+		Vec4f b = polygon[(i + 1) % polygon.size()] - cameraPosition;
+		Vec4f normal = Math::crossProduct(a, b);
+		double distance = -Math::dotProduct(normal, cameraPosition);
+		
+		if(Math::dotProduct(normal, centre) + distance < 0){
+			normal = Vec4f(-normal.x, -normal.y, -normal.z, 0.0f);
+			distance = -distance;
+		};
+		
+		narrowedFrustum->addPlane(normal, distance);
+	};
+	
+	//keep the far plane (if the frustum is full, it is left without one, which is larger than asked for)
+	if(frustum->farPlane >= 0 && narrowedFrustum->addPlane(frustum->planes[frustum->farPlane].normal, frustum->planes[frustum->farPlane].distance)){
+		narrowedFrustum->farPlane = narrowedFrustum->planeCount - 1;
+	};
+	
+	return true;
+};
+
+//find visible cells
+//chain holds the portals passed through to reach the cell (the first from the source cell)
+void CellGraph::findVisibleCells(int sourceCell, int cellIndex, std::vector<int> * chain, std::vector<bool> * visible, bool * outsideVisible){
+	if(chain->size() == CELL_MAX_PORTAL_DEPTH){
+		return;
+	};
+	
+	Cell & cell = this->cells[cellIndex];
+	
+	for(int i = 0; i < cell.portals.size(); i++){
+		int portalIndex = cell.portals[i];
+		Portal & portal = this->portals[portalIndex];
+		
+		//skip portals already in the chain (including the one the cell was entered through)
+		if(std::find(chain->begin(), chain->end(), portalIndex) != chain->end()){
+			continue;
+		};
+		
+		//the portal must have some part in front of every portal before it (facing along the chain)
+		bool inFront = true;
+		int chainCell = sourceCell;
+		
+		for(int j = 0; j < chain->size() && inFront; j++){
+			Portal & chainPortal = this->portals[(*chain)[j]];
+			Plane plane = chainPortal.plane;
+			
+			if(chainPortal.cells[0] != chainCell){
+				plane.normal = Vec4f(-plane.normal.x, -plane.normal.y, -plane.normal.z, 0.0f);
+				plane.distance = -plane.distance;
+			};
+			
+			inFront = CellGraph::isPortalInFront(&portal, &plane);
+			chainCell = chainPortal.cells[0] == chainCell ? chainPortal.cells[1] : chainPortal.cells[0];
+		};
+		
+		if(!inFront){
+			continue;
+		};
+		
+		//mark the cell on the other side, and carry on through it
+		int otherCell = portal.cells[0] == cellIndex ? portal.cells[1] : portal.cells[0];
+		
+		if(otherCell == CELL_OUTSIDE){
+			*outsideVisible = true;
+			continue;
+		};
+		
+		(*visible)[otherCell] = true;
+		
+		chain->push_back(portalIndex);
+		this->findVisibleCells(sourceCell, otherCell, chain, visible, outsideVisible);
+		chain->pop_back();
+	};
+};
+
+//clip polygon
+//keeps the part of the polygon where n.p + d >= 0 (Sutherland-Hodgman, for a single plane)
+void CellGraph::clipPolygon(std::vector<Vec4f> * polygon, Vec4f normal, double distance){
+	std::vector<Vec4f> clipped;
+	
+	for(int i = 0; i < polygon->size(); i++){
+		Vec4f & current = (*polygon)[i];
+		Vec4f & next = (*polygon)[(i + 1) % polygon->size()];
+		
+		double currentDistance = Math::dotProduct(normal, current) + distance;
+		double nextDistance = Math::dotProduct(normal, next) + distance;
+		
+		if(currentDistance >= 0){
+			clipped.push_back(current);
+		};
+		
+		//add the point where the edge crosses the plane
+		if((currentDistance >= 0) != (nextDistance >= 0)){
+			double t = currentDistance / (currentDistance - nextDistance);
+			clipped.push_back(Vec4f(current.x + (next.x - current.x) * t, current.y + (next.y - current.y) * t, current.z + (next.z - current.z) * t, 1.0f));
+		};
+	};
+	
+	*polygon = clipped;
+};
+
+//check if portal is in front of plane
+bool CellGraph::isPortalInFront(Portal * portal, Plane * plane){
+	for(int i = 0; i < portal->vertices.size(); i++){
+		if(Math::dotProduct(plane->normal, portal->vertices[i]) + plane->distance > CELL_PORTAL_EPSILON){
+			return true;
+		};
+	};
+	
+	return false;
+};
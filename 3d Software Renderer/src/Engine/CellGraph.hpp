@@ -0,0 +1,126 @@
+//CellGraph.hpp
+
+#ifndef CELL_GRAPH_HPP
+#define CELL_GRAPH_HPP
+
+#include <vector>
+#include <unordered_set>
+#include <algorithm>
+#include "Model.hpp"
+#include "Frustum.hpp"
+
+/*
+	Notes about cells and portals:
+	Indoors, most of what is in front of the camera is hidden behind walls, which frustum culling cannot know about. A building can be
+	split into cells (rooms, corridors) joined by portals (doorways, windows), where a portal is a flat convex polygon. Anything seen in
+	another cell must be seen through the portals between the two, so starting from the camera's cell:
+		- the models in the cell are tested against the frustum
+		- for each portal of the cell that is in the frustum, the frustum is narrowed to the planes through the camera and the edges of
+		  the part of the portal that can be seen, and the cell on the other side is visited with the narrowed frustum
+	Only cells that can be seen through a chain of portals are visited, so the cost depends on what is visible rather than on the size
+	of the building. A portal can lead outside (CELL_OUTSIDE), in which case the scene is queried with the narrowed frustum.
+	
+	The potentially visible set (PVS) of a cell is every cell that could be seen from anywhere in it, which can be found once after the
+	cells are built. With it, the cells to draw are found without walking the portals at all (though they are only tested against the
+	view frustum, not a narrowed one, so more is drawn). A cell can see through a chain of portals only if each portal has some part in
+	front of every portal before it in the chain, and the PVS keeps every cell reached by such a chain, so it is conservative.
+	
+	Cells are boxes, which only need to enclose the space inside a room (they may overlap, and the first one containing the camera is
+	used). A camera that is not in any cell is outside, and the scene is queried as normal.
+*/
+
+//cell index of the outside
+#define CELL_OUTSIDE -1
+
+//maximum number of portals in a chain (stops the walk in graphs where the frustum does not shrink, e.g. two portals in the same plane)
+#define CELL_MAX_PORTAL_DEPTH 16
+
+//a camera closer than this to a portal's plane is treated as standing in the portal, and sees through it without narrowing the frustum
+#define CELL_PORTAL_EPSILON 0.001
+
+//declare class
+class CellGraph {
+	public:
+		//constructor
+		CellGraph();
+		
+		//add cell (the box encloses the space inside the cell, in world space), returns the cell index
+		int addCell(Vec4f min, Vec4f max);
+		
+		//add portal between two cells (cellB may be CELL_OUTSIDE), returns the portal index
+		//vertices are a convex polygon in world space, in either winding order
+		int addPortal(int cellA, int cellB, std::vector<Vec4f> vertices);
+		
+		//add model to cell (a model in more than one cell can be added to each)
+		//the model must be added to the scene as well, so it is drawn when the camera is outside
+		void addModel(int cell, Model * model);
+		
+		//clear cells and portals
+		void clear();
+		
+		//build potentially visible sets (call after the cells and portals have been added)
+		void buildPotentiallyVisibleSets();
+		
+		//find cell containing position, returns CELL_OUTSIDE if there is none
+		int findCell(Vec4f position);
+		
+		//query frustum (frustum must be in world space)
+		//adds the models that may be visible to the list, and the frustums through portals to the outside to outsideFrustums
+		//returns false if the camera is not in a cell, in which case nothing is added
+		bool queryFrustum(Vec4f cameraPosition, Frustum * frustum, std::vector<Model *> * visibleModels, std::vector<Frustum> * outsideFrustums);
+		
+		//getters
+		int getCellCount();
+		int getVisitedCellCount(); //cells visited by the last query
+		bool getUsePotentiallyVisibleSets();
+		
+		//setters
+		void setUsePotentiallyVisibleSets(bool usePotentiallyVisibleSets);
+	
+	private:
+		//cell
+		struct Cell {
+			Vec4f min;
+			Vec4f max;
+			std::vector<int> portals;
+			std::vector<Model *> models;
+			std::vector<int> visibleCells; //potentially visible set
+			bool outsideVisible; //whether the outside is in the potentially visible set
+		};
+		
+		//portal
+		//the plane's normal points from cells[0] into cells[1]
+		struct Portal {
+			int cells[2];
+			std::vector<Vec4f> vertices;
+			Plane plane;
+		};
+		
+		//visit cell
+		void visitCell(int cellIndex, int fromPortal, Vec4f cameraPosition, Frustum * frustum, int depth, std::vector<Model *> * visibleModels, std::vector<Frustum> * outsideFrustums);
+		
+		//add the models in a cell that are in the frustum to the list
+		void addVisibleModels(Cell * cell, Frustum * frustum, std::vector<Model *> * visibleModels);
+		
+		//narrow frustum to the part of a portal that can be seen through it, returns false if none of it can be seen
+		bool narrowFrustum(Portal * portal, Vec4f cameraPosition, Frustum * frustum, Frustum * narrowedFrustum);
+		
+		//find the cells reachable from a portal chain, for the potentially visible set
+		void findVisibleCells(int sourceCell, int cellIndex, std::vector<int> * chain, std::vector<bool> * visible, bool * outsideVisible);
+		
+		//clip polygon to the inside of a plane
+		static void clipPolygon(std::vector<Vec4f> * polygon, Vec4f normal, double distance);
+		
+		//check if any vertex of a portal is in front of a plane
+		static bool isPortalInFront(Portal * portal, Plane * plane);
+		
+		//data members
+		std::vector<Cell> cells;
+		std::vector<Portal> portals;
+		bool usePotentiallyVisibleSets;
+		bool potentiallyVisibleSetsBuilt;
+		int visitedCellCount;
+		std::unordered_set<Model *> addedModels; //models added by the current query (kept to avoid allocating every query)
+};
+
+#endif
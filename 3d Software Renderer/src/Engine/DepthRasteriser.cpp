@@ -0,0 +1,111 @@
+//DepthRasteriser.cpp
+
+#include "DepthRasteriser.hpp"
+
+//draw triangle
+bool DepthRasteriser::drawTriangle(DepthTarget * target, const float * x, const float * y, const float * depth){
+	//make the winding consistent, so the edge functions are positive inside
+	float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+	
+	if(area == 0){
+		return false;
+	};
+	
+	int second = area > 0 ? 1 : 2;
+	int third = area > 0 ? 2 : 1;
+	float vx[3] = {x[0], x[second], x[third]};
+	float vy[3] = {y[0], y[second], y[third]};
+	float vd[3] = {depth[0], depth[second], depth[third]};
+	area = fabs(area);
+	
+	//find the pixels the triangle may cover (clamped to the buffer before converting to integers, as points close to a near plane can
+	//project very far out)
+	float edgeX = target->width - 1;
+	float edgeY = target->height - 1;
+	int minX = (int) floor(std::max(0.0f, std::min(vx[0], std::min(vx[1], vx[2]))));
+	int maxX = (int) floor(std::min(edgeX, std::max(vx[0], std::max(vx[1], vx[2]))));
+	int minY = (int) floor(std::max(0.0f, std::min(vy[0], std::min(vy[1], vy[2]))));
+	int maxY = (int) floor(std::min(edgeY, std::max(vy[0], std::max(vy[1], vy[2]))));
+	
+	if(minX > maxX || minY > maxY){
+		return false;
+	};
+	
+	//set up edge functions (edge i goes from vertex i to vertex i + 1, and is zero at both)
+	float a[3];
+	float b[3];
+	float c[3];
+	
+	for(int i = 0; i < 3; i++){
+		int j = (i + 1) % 3;
+		a[i] = vy[i] - vy[j];
+		b[i] = vx[j] - vx[i];
+		c[i] = -(a[i] * vx[i] + b[i] * vy[i]);
+	};
+	
+	//set up depth (the weight of each vertex is the edge function of the opposite edge, divided by the area)
+	float depthA = (vd[0] * a[1] + vd[1] * a[2] + vd[2] * a[0]) / area;
+	float depthB = (vd[0] * b[1] + vd[1] * b[2] + vd[2] * b[0]) / area;
+	float depthC = (vd[0] * c[1] + vd[1] * c[2] + vd[2] * c[0]) / area;
+	
+	//a completely covered pixel is drawn with the furthest depth within it, which is half the depth's change across the pixel further
+	//than at its centre
+	bool lessDepthTest = target->depthTest == LESS_DEPTH_TEST;
+	
+	if(target->coverage == FULL_PIXEL_COVERAGE){
+		float furthest = 0.5f * (fabs(depthA) + fabs(depthB));
+		depthC += lessDepthTest ? furthest : -furthest;
+	};
+	
+	//load constants
+	__m128 offsets = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+	__m128 edgeA[3];
+	__m128 edgeThreshold[3];
+	
+	for(int i = 0; i < 3; i++){
+		edgeA[i] = _mm_set1_ps(a[i]);
+		edgeThreshold[i] = target->coverage == FULL_PIXEL_COVERAGE ? _mm_set1_ps(0.5f * (fabs(a[i]) + fabs(b[i]))) : _mm_setzero_ps();
+	};
+	
+	__m128 depthAVector = _mm_set1_ps(depthA);
+	
+	//iterate through rows
+	for(int py = minY; py <= maxY; py++){
+		float centreY = py + 0.5f;
+		
+		__m128 edgeRow[3];
+		for(int i = 0; i < 3; i++){
+			edgeRow[i] = _mm_set1_ps(b[i] * centreY + c[i]);
+		};
+		
+		__m128 depthRow = _mm_set1_ps(depthB * centreY + depthC);
+		float * row = &target->depth[py * target->width];
+		int tileRow = target->tileMask != nullptr ? (py / target->tileSize) * target->tileCount : 0;
+		
+		//iterate through groups of four pixels (which are always in the same tile)
+		for(int px = minX & ~3; px <= maxX; px += 4){
+			if(target->tileMask != nullptr && !(*target->tileMask)[tileRow + px / target->tileSize]){
+				continue;
+			};
+			
+			__m128 centreX = _mm_add_ps(_mm_set1_ps((float) px), offsets);
+			
+			__m128 inside = _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA[0], centreX), edgeRow[0]), edgeThreshold[0]);
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA[1], centreX), edgeRow[1]), edgeThreshold[1]));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA[2], centreX), edgeRow[2]), edgeThreshold[2]));
+			
+			if(_mm_movemask_ps(inside) == 0){
+				continue;
+			};
+			
+			//keep the nearest depth in covered pixels
+			__m128 pixelDepth = _mm_add_ps(_mm_mul_ps(depthAVector, centreX), depthRow);
+			__m128 oldDepth = _mm_loadu_ps(row + px);
+			__m128 newDepth = lessDepthTest ? _mm_min_ps(oldDepth, pixelDepth) : _mm_max_ps(oldDepth, pixelDepth);
+			
+			_mm_storeu_ps(row + px, _mm_or_ps(_mm_and_ps(inside, newDepth), _mm_andnot_ps(inside, oldDepth)));
+		};
+	};
+	
+	return true;
+};
@@ -0,0 +1,58 @@
+//DepthRasteriser.hpp
+
+#ifndef DEPTH_RASTERISER_HPP
+#define DEPTH_RASTERISER_HPP
+
+#include <vector>
+#include <algorithm>
+#include <math.h>
+#include <emmintrin.h>
+
+/*
+	Notes about the depth rasteriser:
+	The occlusion buffer and shadow maps both draw triangles into buffers that hold nothing but a depth for each pixel. The depth
+	rasteriser draws a triangle that has already been projected into such a buffer, four pixels at a time with SSE.
+	
+	Each edge has an edge function E(x, y) = Ax + By + C, which is positive on the inside of the edge and changes by |A| + |B| across a
+	pixel at most (from one corner to the opposite one). Depth must be linear across the buffer (e.g. 1 / z for a perspective projection),
+	so it is interpolated in the same way. Buffers choose:
+		- the coverage rule: pixels whose centres are inside the triangle, or only pixels that are inside it completely (E at the centre
+		  is at least half of |A| + |B| for all three edges). Completely covered pixels are drawn with the furthest depth of the triangle
+		  within the pixel, so nothing behind any part of the triangle is hidden
+		- the depth test: whether smaller or larger depths are nearer (the nearest depth is kept in each pixel)
+		- a tile mask: buffers divided into tiles can draw into some tiles and leave the rest untouched
+*/
+
+//coverage rules enumeration
+enum DEPTH_COVERAGE_RULES {
+	PIXEL_CENTRE_COVERAGE=0,
+	FULL_PIXEL_COVERAGE
+};
+
+//depth tests enumeration
+enum DEPTH_TESTS {
+	LESS_DEPTH_TEST=0, //smaller depths are nearer
+	GREATER_DEPTH_TEST
+};
+
+//depth target (a buffer to draw triangles into)
+struct DepthTarget {
+	float * depth; //row by row (the width must be a multiple of 4)
+	int width;
+	int height;
+	int coverage;
+	int depthTest;
+	std::vector<bool> * tileMask; //tiles to draw into, row by row (nullptr to draw into every pixel)
+	int tileSize; //a multiple of 4
+	int tileCount; //tiles across the buffer
+};
+
+//declare class
+class DepthRasteriser {
+	public:
+		//draw triangle (buffer coordinates and depths of its vertices, in either winding)
+		//returns false if it has no area or does not overlap the buffer
+		static bool drawTriangle(DepthTarget * target, const float * x, const float * y, const float * depth);
+};
+
+#endif
@@ -0,0 +1,160 @@
+//Frustum.hpp
+
+#ifndef FRUSTUM_HPP
+#define FRUSTUM_HPP
+
+#include "Mathematics.hpp"
+
+/*
+	Notes about frustum culling:
+	The view frustum is the volume that can be seen by the camera. In view space (camera at the origin, looking along +z), a point is
+	drawn by the renderer if:
+		-z * tanHalfFov <= x <= z * tanHalfFov
+		-z * tanHalfFov / aspectRatio <= y <= z * tanHalfFov / aspectRatio
+		z >= projection plane distance (near plane)
+		z <= far distance (far plane, if there is one)
+	Each of these is a plane, stored as a unit normal n pointing into the frustum and a distance d, so that n.p + d >= 0 for points
+	on the inside.
+	
+	A plane can be moved into another space by multiplying (n, d) by the transpose of the matrix that maps that space to view space.
+	The renderer uses this to move the frustum into the model's own space once per model, so mesh bounds can be tested without
+	transforming them.
+	
+	A frustum can have more planes than the five or six of the view frustum (up to FRUSTUM_MAX_PLANES), e.g. when it is narrowed to look
+	through a portal. The tests below work the same way for any number of planes.
+	
+	The far plane is the only plane that the camera is inside of rather than on or behind, so a frustum keeps the index of its far plane
+	(or -1 without one) for code that has to treat it differently (e.g. narrowing a frustum to a portal).
+*/
+
+//frustum plane indices
+#define FRUSTUM_LEFT 0
+#define FRUSTUM_RIGHT 1
+#define FRUSTUM_BOTTOM 2
+#define FRUSTUM_TOP 3
+#define FRUSTUM_NEAR 4
+#define FRUSTUM_FAR 5
+#define FRUSTUM_PLANE_COUNT 6
+
+//maximum number of planes in a frustum
+#define FRUSTUM_MAX_PLANES 16
+
+//plane
+struct Plane {
+	Vec4f normal;
+	double distance;
+};
+
+//declare class
+class Frustum {
+	public:
+		//planes
+		Plane planes[FRUSTUM_MAX_PLANES];
+		int planeCount;
+		int farPlane; //index of the far plane, or -1 if there is none
+		
+		//constructor
+		Frustum(){
+			this->planeCount = 0;
+			this->farPlane = -1;
+		};
+		
+		//create view space frustum (without a far plane if farDistance is 0)
+		static Frustum createViewFrustum(double tanHalfFov, double aspectRatio, double nearDistance, double farDistance){
+			Frustum frustum;
+			frustum.planes[FRUSTUM_LEFT] = Frustum::createPlane(Vec4f(1.0f, 0.0f, tanHalfFov, 0.0f), 0.0f);
+			frustum.planes[FRUSTUM_RIGHT] = Frustum::createPlane(Vec4f(-1.0f, 0.0f, tanHalfFov, 0.0f), 0.0f);
+			frustum.planes[FRUSTUM_BOTTOM] = Frustum::createPlane(Vec4f(0.0f, 1.0f, tanHalfFov / aspectRatio, 0.0f), 0.0f);
+			frustum.planes[FRUSTUM_TOP] = Frustum::createPlane(Vec4f(0.0f, -1.0f, tanHalfFov / aspectRatio, 0.0f), 0.0f);
+			frustum.planes[FRUSTUM_NEAR] = Frustum::createPlane(Vec4f(0.0f, 0.0f, 1.0f, 0.0f), -nearDistance);
+			frustum.planeCount = FRUSTUM_NEAR + 1;
+			
+			if(farDistance > 0){
+				frustum.planes[FRUSTUM_FAR] = Frustum::createPlane(Vec4f(0.0f, 0.0f, -1.0f, 0.0f), farDistance);
+				frustum.planeCount = FRUSTUM_PLANE_COUNT;
+				frustum.farPlane = FRUSTUM_FAR;
+			};
+			
+			return frustum;
+		};
+		
+		//transform frustum
+		//transform must map the space the frustum is wanted in to the space it is currently in (e.g. the model-view matrix, to move a view space frustum into model space)
+		static Frustum transformFrustum(Frustum frustum, Mat4x4f transform){
+			Mat4x4f transpose = Math::matrixTranspose(transform);
+			
+			for(int i = 0; i < frustum.planeCount; i++){
+				Vec4f plane = Math::matrixProduct(transpose, Vec4f(frustum.planes[i].normal.x, frustum.planes[i].normal.y, frustum.planes[i].normal.z, frustum.planes[i].distance));
+				frustum.planes[i] = Frustum::createPlane(Vec4f(plane.x, plane.y, plane.z, 0.0f), plane.w);
+			};
+			
+			return frustum;
+		};
+		
+		//add plane (n.p + d >= 0 on the inside, the normal does not need to be unit length)
+		//returns false if the frustum is full or the normal has no length, in which case the frustum is left larger than asked for
+		bool addPlane(Vec4f normal, double distance){
+			if(this->planeCount == FRUSTUM_MAX_PLANES || Math::magnitude(normal) < 1e-9){
+				return false;
+			};
+			
+			this->planes[this->planeCount] = Frustum::createPlane(normal, distance);
+			this->planeCount++;
+			return true;
+		};
+		
+		//check if sphere is at least partly inside the frustum
+		bool intersectsSphere(Vec4f centre, double radius){
+			for(int i = 0; i < this->planeCount; i++){
+				if(Math::dotProduct(this->planes[i].normal, centre) + this->planes[i].distance < -radius){
+					return false;
+				};
+			};
+			
+			return true;
+		};
+		
+		//check if axis-aligned box is at least partly inside the frustum
+		//for each plane, only the corner furthest along the plane normal needs to be tested - if it is outside, the whole box is
+		//this is conservative: a box outside the frustum near one of its edges may not be rejected
+		bool intersectsBox(Vec4f min, Vec4f max){
+			for(int i = 0; i < this->planeCount; i++){
+				Vec4f & normal = this->planes[i].normal;
+				Vec4f corner(normal.x >= 0 ? max.x : min.x, normal.y >= 0 ? max.y : min.y, normal.z >= 0 ? max.z : min.z, 1.0f);
+				
+				if(Math::dotProduct(normal, corner) + this->planes[i].distance < 0){
+					return false;
+				};
+			};
+			
+			return true;
+		};
+	
+		//check if axis-aligned box is entirely inside the frustum
+		//for each plane, the corner furthest against the plane normal must be inside
+		bool containsBox(Vec4f min, Vec4f max){
+			for(int i = 0; i < this->planeCount; i++){
+				Vec4f & normal = this->planes[i].normal;
+				Vec4f corner(normal.x >= 0 ? min.x : max.x, normal.y >= 0 ? min.y : max.y, normal.z >= 0 ? min.z : max.z, 1.0f);
+				
+				if(Math::dotProduct(normal, corner) + this->planes[i].distance < 0){
+					return false;
+				};
+			};
+			
+			return true;
+		};
+	
+	private:
+		//create plane with a unit normal (so that n.p + d is the distance from the plane)
+		static Plane createPlane(Vec4f normal, double distance){
+			double length = Math::magnitude(normal);
+			
+			Plane plane;
+			plane.normal = Vec4f(normal.x / length, normal.y / length, normal.z / length, 0.0f);
+			plane.distance = distance / length;
+			return plane;
+		};
+};
+
+#endif
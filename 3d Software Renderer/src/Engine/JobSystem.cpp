@@ -0,0 +1,287 @@
+//JobSystem.cpp
+
+#include "JobSystem.hpp"
+
+//the job system and worker index of the calling thread
+static thread_local JobSystem * currentJobSystem = nullptr;
+static thread_local int currentWorkerIndex = -1;
+
+//state of the calling thread's random number generator, for choosing which worker to steal from first
+static thread_local unsigned int stealRandomState = 0;
+
+//constructor
+JobSystem::JobSystem(int threadCount, int affinity) : queue(JOB_QUEUE_CAPACITY){
+	if(threadCount < 0){
+		threadCount = std::thread::hardware_concurrency() > 1 ? std::thread::hardware_concurrency() - 1 : 0;
+	};
+	
+	this->queuedJobCount = 0;
+	this->sleepingWorkerCount = 0;
+	this->stopping = false;
+	
+	//create every worker before starting any threads, as they steal from each other
+	for(int i = 0; i < threadCount + 1; i++){
+		this->workers.push_back(new Worker());
+	};
+	
+	//the calling thread is worker 0
+	currentJobSystem = this;
+	currentWorkerIndex = 0;
+	stealRandomState = 2654435761u;
+	
+	for(int i = 1; i < this->workers.size(); i++){
+		this->workers[i]->thread = std::thread(&JobSystem::workerLoop, this, i);
+	};
+	
+	//pin worker i to logical processor i
+	if(affinity == PIN_THREADS_TO_PROCESSORS){
+		SetThreadAffinityMask(GetCurrentThread(), 1);
+		
+		for(int i = 1; i < this->workers.size(); i++){
+			SetThreadAffinityMask((HANDLE) this->workers[i]->thread.native_handle(), (DWORD_PTR) 1 << (i % (sizeof(DWORD_PTR) * 8)));
+		};
+	};
+};
+
+//destructor
+JobSystem::~JobSystem(){
+	//wake workers and wait for them to stop
+	{
+		std::lock_guard<std::mutex> lock(this->sleepMutex);
+		this->stopping = true;
+	};
+	this->sleepCondition.notify_all();
+	
+	for(int i = 1; i < this->workers.size(); i++){
+		this->workers[i]->thread.join();
+	};
+	
+	for(int i = 0; i < this->workers.size(); i++){
+		delete this->workers[i];
+	};
+	
+	if(currentJobSystem == this){
+		currentJobSystem = nullptr;
+		currentWorkerIndex = -1;
+	};
+};
+
+//run job
+void JobSystem::run(JobFunction function, JobCounter * counter){
+	if(counter != nullptr){
+		counter->count.fetch_add(1);
+	};
+	
+	this->queueJob(new Job{function, counter});
+};
+
+//run job after dependency
+//the job is added to the dependency's waiting jobs while holding its mutex, so it cannot be missed by the job that brings the count to 0
+void JobSystem::run(JobFunction function, JobCounter * counter, JobCounter * dependency){
+	if(counter != nullptr){
+		counter->count.fetch_add(1);
+	};
+	
+	Job * job = new Job{function, counter};
+	
+	{
+		std::lock_guard<std::mutex> lock(dependency->mutex);
+		
+		if(dependency->count.load() > 0){
+			dependency->waitingJobs.push_back(job);
+			return;
+		};
+	};
+	
+	this->queueJob(job);
+};
+
+//wait
+void JobSystem::wait(JobCounter * counter){
+	int index = this->getWorkerIndex();
+	
+	while(counter->count.load(std::memory_order_acquire) > 0){
+		Job * job = this->findJob(index);
+		
+		if(job != nullptr){
+			this->executeJob(job);
+		} else {
+			std::this_thread::yield();
+		};
+	};
+	
+	//the job that finished last may still hold the counter's mutex, which must be released before the counter can be destroyed
+	std::lock_guard<std::mutex> lock(counter->mutex);
+};
+
+//parallel for
+//the calling thread runs the first piece itself, then helps with the rest while it waits
+void JobSystem::parallelFor(int first, int last, int grainSize, JobRangeFunction function){
+	int count = last - first;
+	
+	if(count <= 0){
+		return;
+	};
+	
+	grainSize = grainSize > 1 ? grainSize : 1;
+	
+	int pieceCount = (count + grainSize - 1) / grainSize;
+	if(pieceCount > this->getThreadCount() * JOB_PARALLEL_FOR_PIECES_PER_THREAD){
+		pieceCount = this->getThreadCount() * JOB_PARALLEL_FOR_PIECES_PER_THREAD;
+	};
+	
+	if(pieceCount <= 1){
+		function(first, last);
+		return;
+	};
+	
+	JobCounter counter;
+	
+	for(int i = 1; i < pieceCount; i++){
+		int begin = first + (int) ((int64_t) count * i / pieceCount);
+		int end = first + (int) ((int64_t) count * (i + 1) / pieceCount);
+		
+		this->run([&function, begin, end](){
+			function(begin, end);
+		}, &counter);
+	};
+	
+	function(first, first + count / pieceCount);
+	this->wait(&counter);
+};
+
+//get thread count
+int JobSystem::getThreadCount(){
+	return this->workers.size();
+};
+
+//worker loop
+void JobSystem::workerLoop(int index){
+	currentJobSystem = this;
+	currentWorkerIndex = index;
+	stealRandomState = (index + 1) * 2654435761u;
+	
+	int spinCount = 0;
+	
+	while(!this->stopping.load()){
+		Job * job = this->findJob(index);
+		
+		if(job != nullptr){
+			this->executeJob(job);
+			spinCount = 0;
+			continue;
+		};
+		
+		if(spinCount < JOB_SPIN_COUNT){
+			spinCount++;
+			std::this_thread::yield();
+			continue;
+		};
+		
+		//sleep until a job is queued
+		//the sleeping count is incremented before the queued count is checked, and queueJob increments the queued count before checking
+		//the sleeping count, so either this sees the new job or queueJob sees this worker asleep and wakes it
+		spinCount = 0;
+		
+		std::unique_lock<std::mutex> lock(this->sleepMutex);
+		this->sleepingWorkerCount++;
+		this->sleepCondition.wait(lock, [this](){
+			return this->queuedJobCount.load() > 0 || this->stopping.load();
+		});
+		this->sleepingWorkerCount--;
+	};
+};
+
+//queue job
+void JobSystem::queueJob(Job * job){
+	int index = this->getWorkerIndex();
+	
+	bool queued = index >= 0 && this->workers[index]->deque.push(job);
+	
+	if(!queued){
+		queued = this->queue.push(job);
+	};
+	
+	//both are full - run the job now
+	if(!queued){
+		this->executeJob(job);
+		return;
+	};
+	
+	this->queuedJobCount++;
+	
+	if(this->sleepingWorkerCount.load() > 0){
+		std::lock_guard<std::mutex> lock(this->sleepMutex);
+		this->sleepCondition.notify_one();
+	};
+};
+
+//find job
+Job * JobSystem::findJob(int index){
+	Job * job = nullptr;
+	bool found = (index >= 0 && this->workers[index]->deque.pop(&job)) || this->queue.pop(&job);
+	
+	//steal, starting from a random worker (threads that are not workers seed their generator the first time they steal)
+	if(!found){
+		if(stealRandomState == 0){
+			stealRandomState = 2463534242u;
+		};
+		
+		stealRandomState ^= stealRandomState << 13;
+		stealRandomState ^= stealRandomState >> 17;
+		stealRandomState ^= stealRandomState << 5;
+		
+		int workerCount = this->workers.size();
+		int start = stealRandomState % workerCount;
+		
+		for(int i = 0; i < workerCount && !found; i++){
+			int victim = (start + i) % workerCount;
+			
+			if(victim != index){
+				found = this->workers[victim]->deque.steal(&job);
+			};
+		};
+	};
+	
+	if(!found){
+		return nullptr;
+	};
+	
+	this->queuedJobCount--;
+	return job;
+};
+
+//execute job
+void JobSystem::executeJob(Job * job){
+	job->function();
+	
+	JobCounter * counter = job->counter;
+	delete job;
+	
+	if(counter != nullptr){
+		this->finishJob(counter);
+	};
+};
+
+//finish job
+void JobSystem::finishJob(JobCounter * counter){
+	std::vector<Job *> readyJobs;
+	
+	{
+		std::lock_guard<std::mutex> lock(counter->mutex);
+		
+		if(counter->count.fetch_sub(1) == 1){
+			readyJobs.swap(counter->waitingJobs);
+		};
+	};
+	
+	//the counter may be destroyed as soon as its mutex is released, so only the jobs taken from it are used from here
+	for(int i = 0; i < readyJobs.size(); i++){
+		this->queueJob(readyJobs[i]);
+	};
+};
+
+//get worker index
+int JobSystem::getWorkerIndex(){
+	return currentJobSystem == this ? currentWorkerIndex : -1;
+};
@@ -0,0 +1,176 @@
+//JobSystem.hpp
+
+#ifndef JOB_SYSTEM_HPP
+#define JOB_SYSTEM_HPP
+
+#include <windows.h>
+#include <malloc.h>
+#include <new>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include "WorkStealingDeque.hpp"
+#include "LockFreeQueue.hpp"
+
+/*
+	Notes about the job system:
+	The job system runs small pieces of work (jobs) on a fixed set of worker threads, so that anything that can be split up (vertex
+	processing, culling, decoding assets) shares the same threads rather than each starting its own. The thread that creates the job
+	system is worker 0, and does work whenever it waits for jobs to finish, so with n extra threads n + 1 cores are used.
+	
+	Each worker has its own work-stealing deque (see notes on the work-stealing deque). Jobs started by a worker are pushed onto its
+	own deque, and it takes its newest job first, so a job that splits its work keeps working on the pieces it has just made while they
+	are in its cache. A worker with nothing left steals the oldest job from another worker, starting from a random one so thieves spread
+	out. Threads that are not workers (e.g. the asset loader's threads) push their jobs onto a shared lock-free queue instead, which
+	every worker checks before stealing.
+	
+	A job counter counts the jobs started with it that have not finished. wait runs other jobs until the counter reaches 0 rather than
+	blocking, so waiting inside a job cannot leave the workers with nothing to do while the job it waits for is queued. A job can also be
+	given a counter to depend on: it is kept on that counter, and only queued once the counter reaches 0, so chains of work (e.g. cull,
+	then transform, then bin) can be started at once and wait for each other without a thread waiting in between. A counter must not be
+	started with again until it has been waited on.
+	
+	A worker with nothing to do looks for jobs JOB_SPIN_COUNT times (yielding in between) before it sleeps, as most jobs come in bursts
+	(e.g. a parallel for each frame) and waking a sleeping thread takes far longer than a job does. Starting a job only wakes a worker
+	if one is asleep.
+	
+	Workers can be pinned to logical processors (worker i to processor i, including the thread that created the job system), which
+	stops the operating system from moving them between cores and losing their caches. This is best left off when the game shares the
+	machine with other busy programs, as a pinned worker has to wait for its own processor.
+*/
+
+//thread affinity options enumeration
+enum JOB_THREAD_AFFINITIES {
+	NO_THREAD_AFFINITY=0,
+	PIN_THREADS_TO_PROCESSORS
+};
+
+//capacity of each worker's deque and of the queue for jobs started by other threads (powers of two)
+//a job that does not fit is run straight away by the thread that started it
+#define JOB_DEQUE_CAPACITY 4096
+#define JOB_QUEUE_CAPACITY 4096
+
+//number of times an idle worker looks for jobs before it sleeps
+#define JOB_SPIN_COUNT 64
+
+//parallelFor splits its range into up to this many pieces per thread, so threads that finish early can steal the rest
+#define JOB_PARALLEL_FOR_PIECES_PER_THREAD 4
+
+//job functions
+typedef std::function<void()> JobFunction;
+typedef std::function<void(int, int)> JobRangeFunction; //called with the first index and one past the last index of a range
+
+//declare job counter
+class JobCounter;
+
+//job
+struct Job {
+	JobFunction function;
+	JobCounter * counter;
+};
+
+//job counter (see notes on the job system)
+class JobCounter {
+	public:
+		//constructor
+		JobCounter() : count(0) {};
+		
+		//get number of jobs that have not finished
+		int getCount(){
+			return this->count.load(std::memory_order_acquire);
+		};
+	
+	private:
+		friend class JobSystem;
+		
+		//data members
+		std::atomic<int> count;
+		std::mutex mutex; //held while the count is decremented and jobs are added to waitingJobs
+		std::vector<Job *> waitingJobs; //jobs that depend on this counter
+};
+
+//declare class
+class JobSystem {
+	public:
+		//constructor
+		//threadCount is the number of threads created besides the calling thread (-1 for one less than the number of logical processors)
+		JobSystem(int threadCount, int affinity);
+		
+		//destructor (every job must have finished)
+		~JobSystem();
+		
+		//prevent copying
+		JobSystem(const JobSystem &) = delete;
+		JobSystem & operator=(const JobSystem &) = delete;
+		
+		//run job (counter may be nullptr if the job is not waited for)
+		void run(JobFunction function, JobCounter * counter);
+		
+		//run job once the dependency's count has reached 0
+		void run(JobFunction function, JobCounter * counter, JobCounter * dependency);
+		
+		//run jobs until the counter's count reaches 0
+		void wait(JobCounter * counter);
+		
+		//split a range into pieces of at least grainSize indices, run them on every thread and wait for them
+		void parallelFor(int first, int last, int grainSize, JobRangeFunction function);
+		
+		//get number of threads that run jobs (including the thread that created the job system)
+		int getThreadCount();
+	
+	private:
+		//worker
+		struct Worker {
+			WorkStealingDeque<Job *> deque;
+			std::thread thread;
+			
+			Worker() : deque(JOB_DEQUE_CAPACITY) {};
+			
+			//plain new does not honour the deque's cache line alignment before C++17, so workers are allocated aligned
+			static void * operator new(size_t size){
+				void * memory = _aligned_malloc(size, alignof(Worker));
+				
+				if(memory == nullptr){
+					throw std::bad_alloc();
+				};
+				
+				return memory;
+			};
+			
+			static void operator delete(void * memory){
+				_aligned_free(memory);
+			};
+		};
+		
+		//worker thread function
+		void workerLoop(int index);
+		
+		//queue job (on the calling worker's deque, or the shared queue), waking a sleeping worker
+		void queueJob(Job * job);
+		
+		//find job to run (the worker's own deque, then the shared queue, then stealing), returns nullptr if there are none
+		Job * findJob(int index);
+		
+		//run job and finish it
+		void executeJob(Job * job);
+		
+		//finish job on a counter, queueing the jobs that depend on it if it reaches 0
+		void finishJob(JobCounter * counter);
+		
+		//get the calling thread's worker index (-1 if it is not a worker)
+		int getWorkerIndex();
+		
+		//data members
+		std::vector<Worker *> workers;
+		LockFreeQueue<Job *> queue;
+		std::atomic<int> queuedJobCount;
+		std::atomic<int> sleepingWorkerCount;
+		std::mutex sleepMutex;
+		std::condition_variable sleepCondition;
+		std::atomic<bool> stopping;
+};
+
+#endif
@@ -0,0 +1,206 @@
+//LightSet.cpp
+
+#include "LightSet.hpp"
+
+//constructor
+LightSet::LightSet(){
+	this->ambientIntensity = 0;
+};
+
+//compile lights
+void LightSet::compile(std::vector<Light> * lights, Mat4x4f viewTransform){
+	this->clear();
+	this->inverseViewTransform = Math::matrixInverse(viewTransform);
+	
+	for(int i = 0; i < lights->size(); i++){
+		Light & light = (*lights)[i];
+		
+		if(light.type == AMBIENT_LIGHT){
+			this->ambientIntensity += light.intensity;
+		} else if(light.type == DIRECTIONAL_LIGHT){
+			//turn the direction into view space, and reverse it so it points towards the light
+			Vec4f direction = Math::matrixProduct(viewTransform, light.direction);
+			double length = Math::magnitude(direction);
+			
+			//a directional light with no direction cannot light anything
+			if(length == 0){
+				continue;
+			};
+			
+			this->directionalX.push_back(-direction.x / length);
+			this->directionalY.push_back(-direction.y / length);
+			this->directionalZ.push_back(-direction.z / length);
+			this->directionalIntensity.push_back(light.intensity);
+			this->directionalShadowMaps.push_back(light.shadowMap);
+		} else if(light.type == POINT_LIGHT){
+			//move the light into view space
+			Vec4f position = Math::matrixProduct(viewTransform, light.position);
+			
+			this->pointX.push_back(position.x);
+			this->pointY.push_back(position.y);
+			this->pointZ.push_back(position.z);
+			this->pointIntensity.push_back(light.intensity);
+			this->pointRange.push_back(light.range > 0 ? light.range : 0);
+			this->pointInverseRangeSquared.push_back(light.range > 0 ? 1 / (light.range * light.range) : 0);
+			this->pointShadowMaps.push_back(light.shadowMap);
+		};
+	};
+	
+	this->assignAllLights();
+};
+
+//clear lights
+void LightSet::clear(){
+	this->ambientIntensity = 0;
+	
+	this->directionalX.clear();
+	this->directionalY.clear();
+	this->directionalZ.clear();
+	this->directionalIntensity.clear();
+	this->directionalShadowMaps.clear();
+	
+	this->pointX.clear();
+	this->pointY.clear();
+	this->pointZ.clear();
+	this->pointIntensity.clear();
+	this->pointRange.clear();
+	this->pointInverseRangeSquared.clear();
+	this->pointShadowMaps.clear();
+	this->assignedPointLights.clear();
+};
+
+//assign lights
+//a point light reaches the sphere if the distance between their centres is less than the light's range plus the sphere's radius
+void LightSet::assignLights(Vec4f centre, double radius){
+	this->assignedPointLights.clear();
+	
+	for(int i = 0; i < this->pointIntensity.size(); i++){
+		if(this->pointRange[i] > 0){
+			double dx = this->pointX[i] - centre.x;
+			double dy = this->pointY[i] - centre.y;
+			double dz = this->pointZ[i] - centre.z;
+			double reach = this->pointRange[i] + radius;
+			
+			if(dx * dx + dy * dy + dz * dz >= reach * reach){
+				continue;
+			};
+		};
+		
+		this->assignedPointLights.push_back(i);
+	};
+};
+
+//assign all lights
+void LightSet::assignAllLights(){
+	this->assignedPointLights.clear();
+	
+	for(int i = 0; i < this->pointIntensity.size(); i++){
+		this->assignedPointLights.push_back(i);
+	};
+};
+
+//light vertices
+void LightSet::lightVertices(VertexLightingBatch * vertices){
+	//pad the arrays to a whole number of groups of four (the padding vertices have zero normals, so they are only lit by ambient lights)
+	int paddedCount = (vertices->count + 3) & ~3;
+	
+	vertices->positionX.resize(paddedCount, 0.0f);
+	vertices->positionY.resize(paddedCount, 0.0f);
+	vertices->positionZ.resize(paddedCount, 0.0f);
+	vertices->normalX.resize(paddedCount, 0.0f);
+	vertices->normalY.resize(paddedCount, 0.0f);
+	vertices->normalZ.resize(paddedCount, 0.0f);
+	vertices->intensities.resize(paddedCount);
+	
+	__m128 zero = _mm_setzero_ps();
+	__m128 one = _mm_set1_ps(1.0f);
+	__m128 half = _mm_set1_ps(0.5f);
+	__m128 threeHalves = _mm_set1_ps(1.5f);
+	__m128 ambient = _mm_set1_ps((float) this->ambientIntensity);
+	
+	for(int i = 0; i < paddedCount; i += 4){
+		__m128 px = _mm_loadu_ps(&vertices->positionX[i]);
+		__m128 py = _mm_loadu_ps(&vertices->positionY[i]);
+		__m128 pz = _mm_loadu_ps(&vertices->positionZ[i]);
+		__m128 nx = _mm_loadu_ps(&vertices->normalX[i]);
+		__m128 ny = _mm_loadu_ps(&vertices->normalY[i]);
+		__m128 nz = _mm_loadu_ps(&vertices->normalZ[i]);
+		
+		//renormalise the normals, which a non-uniform scale leaves the wrong length (see Math::normalMatrix), with the same refined
+		//reciprocal square root as the point lights' distances (zero normals stay zero)
+		__m128 lengthSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nx), _mm_mul_ps(ny, ny)), _mm_mul_ps(nz, nz));
+		__m128 inverseLength = _mm_rsqrt_ps(lengthSquared);
+		inverseLength = _mm_mul_ps(inverseLength, _mm_sub_ps(threeHalves, _mm_mul_ps(_mm_mul_ps(half, lengthSquared), _mm_mul_ps(inverseLength, inverseLength))));
+		inverseLength = _mm_and_ps(inverseLength, _mm_cmpgt_ps(lengthSquared, zero));
+		
+		nx = _mm_mul_ps(nx, inverseLength);
+		ny = _mm_mul_ps(ny, inverseLength);
+		nz = _mm_mul_ps(nz, inverseLength);
+		
+		//ambient lights
+		__m128 intensity = ambient;
+		
+		//directional lights (intensity * cos(angle between the normal and the direction towards the light), if it is positive)
+		for(int j = 0; j < this->directionalIntensity.size(); j++){
+			__m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps((float) this->directionalX[j]), nx), _mm_mul_ps(_mm_set1_ps((float) this->directionalY[j]), ny)), _mm_mul_ps(_mm_set1_ps((float) this->directionalZ[j]), nz));
+			__m128 diffuse = _mm_max_ps(_mm_mul_ps(_mm_set1_ps((float) this->directionalIntensity[j]), dot), zero);
+			
+			if(this->directionalShadowMaps[j] != nullptr){
+				diffuse = _mm_mul_ps(diffuse, this->getShadowVisibility(this->directionalShadowMaps[j], vertices, i));
+			};
+			
+			intensity = _mm_add_ps(intensity, diffuse);
+		};
+		
+		//assigned point lights (the same, with the direction from the vertex to the light divided by its length, and attenuated by range)
+		for(int k = 0; k < this->assignedPointLights.size(); k++){
+			int j = this->assignedPointLights[k];
+			__m128 dx = _mm_sub_ps(_mm_set1_ps((float) this->pointX[j]), px);
+			__m128 dy = _mm_sub_ps(_mm_set1_ps((float) this->pointY[j]), py);
+			__m128 dz = _mm_sub_ps(_mm_set1_ps((float) this->pointZ[j]), pz);
+			__m128 distanceSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+			__m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, nx), _mm_mul_ps(dy, ny)), _mm_mul_ps(dz, nz));
+			
+			//1 / distance, refined with one Newton step: x' = x * (1.5 - 0.5 * d * x * x)
+			__m128 inverseDistance = _mm_rsqrt_ps(distanceSquared);
+			inverseDistance = _mm_mul_ps(inverseDistance, _mm_sub_ps(threeHalves, _mm_mul_ps(_mm_mul_ps(half, distanceSquared), _mm_mul_ps(inverseDistance, inverseDistance))));
+			
+			//a vertex at the light's position is not lit by it (its reciprocal square root is infinite)
+			__m128 diffuse = _mm_mul_ps(_mm_mul_ps(_mm_set1_ps((float) this->pointIntensity[j]), dot), inverseDistance);
+			diffuse = _mm_and_ps(diffuse, _mm_cmpgt_ps(distanceSquared, zero));
+			
+			//range attenuation: (1 - distance^2 / range^2)^2, and 0 beyond the range
+			__m128 falloff = _mm_max_ps(_mm_sub_ps(one, _mm_mul_ps(distanceSquared, _mm_set1_ps((float) this->pointInverseRangeSquared[j]))), zero);
+			diffuse = _mm_mul_ps(diffuse, _mm_mul_ps(falloff, falloff));
+			
+			if(this->pointShadowMaps[j] != nullptr){
+				diffuse = _mm_mul_ps(diffuse, this->getShadowVisibility(this->pointShadowMaps[j], vertices, i));
+			};
+			
+			intensity = _mm_add_ps(intensity, _mm_max_ps(diffuse, zero));
+		};
+		
+		//clamp intensity
+		intensity = _mm_min_ps(_mm_max_ps(intensity, zero), one);
+		
+		_mm_storeu_ps(&vertices->intensities[i], intensity);
+	};
+};
+
+//get shadow visibility
+float LightSet::getShadowVisibility(ShadowMap * shadowMap, Vec4f position){
+	return shadowMap->getVisibility(Math::matrixProduct(this->inverseViewTransform, position));
+};
+
+//get shadow visibility of four vertices
+//the shadow map lookups are done one at a time, as each vertex reads from a different part of the map
+__m128 LightSet::getShadowVisibility(ShadowMap * shadowMap, VertexLightingBatch * vertices, int first){
+	float visibility[4];
+	
+	for(int k = 0; k < 4; k++){
+		Vec4f position(vertices->positionX[first + k], vertices->positionY[first + k], vertices->positionZ[first + k], 1.0f);
+		visibility[k] = this->getShadowVisibility(shadowMap, position);
+	};
+	
+	return _mm_loadu_ps(visibility);
+};
@@ -0,0 +1,160 @@
+//LightSet.hpp
+
+#ifndef LIGHT_SET_HPP
+#define LIGHT_SET_HPP
+
+#include <vector>
+#include <emmintrin.h>
+#include "Mathematics.hpp"
+#include "ShadowMap.hpp"
+
+//light types enumeration
+enum LIGHT_TYPES {
+	AMBIENT_LIGHT=0,
+	DIRECTIONAL_LIGHT,
+	POINT_LIGHT
+};
+
+//light structure
+//a directional light's direction is the way its light travels, and is ignored for the other types (as is position for all but point lights)
+//a point light with a range fades out to nothing at that distance, and one without (a range of 0) lights everything
+//directional and point lights can be given a shadow map, which must be updated by the game before the lights are compiled (see notes on shadow maps)
+struct Light {
+	int type;
+	Vec4f position;
+	Vec4f direction;
+	double intensity;
+	double range;
+	ShadowMap * shadowMap;
+	
+	Light(int type, Vec4f position, Vec4f direction, double intensity) : type(type), position(position), direction(direction), intensity(intensity), range(0), shadowMap(nullptr) {};
+	Light(int type, Vec4f position, Vec4f direction, double intensity, double range) : type(type), position(position), direction(direction), intensity(intensity), range(range), shadowMap(nullptr) {};
+};
+
+/*
+	Notes about light sets:
+	Lights are described as a list of Light structures, which is convenient for game code but slow to light vertices with: each light
+	has to be checked for its type, moved into view space and (for directional lights) normalised for every vertex it lights. A light set
+	is the same lights compiled once per frame into the form the lighting code uses:
+		- ambient lights are summed into a single intensity
+		- directional lights are stored as unit vectors pointing towards the light, in view space
+		- point lights are stored as positions in view space, with their range and the reciprocal of its square (both 0 if they have no range)
+	Each type is kept in its own arrays, one per component (x, y, z and intensity), so lighting loops over each type without branching,
+	and several lights can be loaded at once by SIMD code. The arrays keep their memory between frames, so compiling a light set does not
+	allocate once it has held as many lights as it will need.
+	
+	A light set must be compiled again whenever the lights or the camera change, as it is in view space (usually once per frame, after
+	the camera has moved).
+	
+	Vertices are lit in batches, which hold their positions and normals one array per component as well. lightVertices lights four
+	vertices at a time with SSE, going through every assigned light for each group of four: the contribution of a light to four vertices takes
+	the same instructions as to one. The distance to a point light is found with the SSE reciprocal square root estimate, refined with one
+	step of Newton's method (which is accurate to about one part in a million, far less than one step of the 8-bit colour it is used for)
+	rather than a square root and a divide. The normals are renormalised in the same way before they are used, as transforming them
+	under a non-uniform scale changes their lengths.
+	
+	A point light with a range is attenuated by (1 - (distance / range)^2)^2, which is 1 at the light, falls off smoothly and reaches 0
+	at the range with no visible edge. It only needs the distance squared, and is 1 for lights with no range (whose reciprocal range
+	squared is 0), so both kinds are lit by the same code.
+	
+	With many short-range point lights (e.g. muzzle flashes and explosions) most of them cannot reach most of what is being drawn. Before
+	an object is lit, the renderer assigns lights to it from its bounding sphere in view space: only the point lights whose range reaches
+	the sphere (and those with no range) are kept in assignedPointLights, and lightVertices only goes through those. This is one sphere
+	test per point light per object rather than per vertex, so the cost of lighting a vertex depends on the lights near it rather than on
+	how many lights there are. Compiling a light set assigns every light to begin with.
+	
+	Lights with a shadow map are multiplied by the visibility of each vertex in the map. Shadow maps are in world space, so the light
+	set keeps the inverse of the view transform to move vertices back into world space, which is only done for lights with shadows.
+*/
+
+//vertex lighting batch
+//view space positions and normals of the vertices to light (normalised when they are lit), and the intensities they are lit with
+//the arrays are padded to a multiple of 4 vertices when they are lit
+struct VertexLightingBatch {
+	std::vector<float> positionX;
+	std::vector<float> positionY;
+	std::vector<float> positionZ;
+	std::vector<float> normalX;
+	std::vector<float> normalY;
+	std::vector<float> normalZ;
+	std::vector<float> intensities;
+	int count;
+	
+	VertexLightingBatch() : count(0) {};
+	
+	//clear vertices (keeping the memory for the next batch)
+	void clear(){
+		this->positionX.clear();
+		this->positionY.clear();
+		this->positionZ.clear();
+		this->normalX.clear();
+		this->normalY.clear();
+		this->normalZ.clear();
+		this->count = 0;
+	};
+	
+	//add vertex
+	void add(Vec4f position, Vec4f normal){
+		this->positionX.push_back((float) position.x);
+		this->positionY.push_back((float) position.y);
+		this->positionZ.push_back((float) position.z);
+		this->normalX.push_back((float) normal.x);
+		this->normalY.push_back((float) normal.y);
+		this->normalZ.push_back((float) normal.z);
+		this->count++;
+	};
+};
+
+//declare class
+class LightSet {
+	public:
+		//constructor
+		LightSet();
+		
+		//compile lights (viewTransform is the camera transformation matrix that the lights will be drawn with)
+		void compile(std::vector<Light> * lights, Mat4x4f viewTransform);
+		
+		//clear lights
+		void clear();
+		
+		//assign lights to an object (keeps the point lights that reach a view space bounding sphere), or assign every light
+		void assignLights(Vec4f centre, double radius);
+		void assignAllLights();
+		
+		//light vertices (sets the intensity of each vertex in the batch, clamped to 0 to 1)
+		void lightVertices(VertexLightingBatch * vertices);
+		
+		//get the visibility of a view space point in a shadow map
+		float getShadowVisibility(ShadowMap * shadowMap, Vec4f position);
+		
+		//ambient lights (sum of their intensities)
+		double ambientIntensity;
+		
+		//directional lights (unit vector pointing towards the light, in view space)
+		std::vector<double> directionalX;
+		std::vector<double> directionalY;
+		std::vector<double> directionalZ;
+		std::vector<double> directionalIntensity;
+		std::vector<ShadowMap *> directionalShadowMaps; //nullptr for lights without shadows
+		
+		//point lights (position in view space, and range)
+		std::vector<double> pointX;
+		std::vector<double> pointY;
+		std::vector<double> pointZ;
+		std::vector<double> pointIntensity;
+		std::vector<double> pointRange;
+		std::vector<double> pointInverseRangeSquared;
+		std::vector<ShadowMap *> pointShadowMaps;
+		
+		//indices of the point lights assigned to the object being lit
+		std::vector<int> assignedPointLights;
+		
+		//view space to world space (for looking up shadow maps)
+		Mat4x4f inverseViewTransform;
+	
+	private:
+		//get the visibility of four vertices in a shadow map
+		__m128 getShadowVisibility(ShadowMap * shadowMap, VertexLightingBatch * vertices, int first);
+};
+
+#endif
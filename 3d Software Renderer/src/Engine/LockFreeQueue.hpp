@@ -0,0 +1,118 @@
+//LockFreeQueue.hpp
+
+#ifndef LOCK_FREE_QUEUE_HPP
+#define LOCK_FREE_QUEUE_HPP
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+	Notes about the lock-free queue:
+	This is a bounded multi-producer multi-consumer queue (based on Dmitry Vyukov's design). The queue is a ring buffer of cells,
+	each with a sequence number that says whose turn it is to use the cell:
+		sequence == position - the cell is empty and can be written by the producer that claims this position
+		sequence == position + 1 - the cell is full and can be read by the consumer that claims this position
+	Producers and consumers claim positions with a compare-and-swap on the enqueue / dequeue position, so no thread ever blocks another.
+	The capacity must be a power of two.
+*/
+
+//declare class
+template <typename T>
+class LockFreeQueue {
+	public:
+		//constructor
+		LockFreeQueue(size_t capacity){
+			this->cells = new Cell[capacity];
+			this->mask = capacity - 1;
+			
+			for(size_t i = 0; i < capacity; i++){
+				this->cells[i].sequence.store(i, std::memory_order_relaxed);
+			};
+			
+			this->enqueuePosition.store(0, std::memory_order_relaxed);
+			this->dequeuePosition.store(0, std::memory_order_relaxed);
+		};
+		
+		//destructor
+		~LockFreeQueue(){
+			delete[] this->cells;
+		};
+		
+		//prevent copying
+		LockFreeQueue(const LockFreeQueue &) = delete;
+		LockFreeQueue & operator=(const LockFreeQueue &) = delete;
+		
+		//push (returns false if the queue is full)
+		bool push(const T & value){
+			Cell * cell;
+			size_t position = this->enqueuePosition.load(std::memory_order_relaxed);
+			
+			while(true){
+				cell = &this->cells[position & this->mask];
+				size_t sequence = cell->sequence.load(std::memory_order_acquire);
+				intptr_t difference = (intptr_t) sequence - (intptr_t) position;
+				
+				if(difference == 0){
+					//cell is empty - try to claim it
+					if(this->enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)){
+						break;
+					};
+				} else if(difference < 0){
+					//cell still holds a value from the previous lap - queue is full
+					return false;
+				} else {
+					//another producer claimed this position
+					position = this->enqueuePosition.load(std::memory_order_relaxed);
+				};
+			};
+			
+			cell->data = value;
+			cell->sequence.store(position + 1, std::memory_order_release);
+			return true;
+		};
+		
+		//pop (returns false if the queue is empty)
+		bool pop(T * value){
+			Cell * cell;
+			size_t position = this->dequeuePosition.load(std::memory_order_relaxed);
+			
+			while(true){
+				cell = &this->cells[position & this->mask];
+				size_t sequence = cell->sequence.load(std::memory_order_acquire);
+				intptr_t difference = (intptr_t) sequence - (intptr_t) (position + 1);
+				
+				if(difference == 0){
+					//cell is full - try to claim it
+					if(this->dequeuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)){
+						break;
+					};
+				} else if(difference < 0){
+					//cell has not been written yet - queue is empty
+					return false;
+				} else {
+					//another consumer claimed this position
+					position = this->dequeuePosition.load(std::memory_order_relaxed);
+				};
+			};
+			
+			*value = cell->data;
+			cell->sequence.store(position + this->mask + 1, std::memory_order_release);
+			return true;
+		};
+	
+	private:
+		//cell
+		struct Cell {
+			std::atomic<size_t> sequence;
+			T data;
+		};
+		
+		//data members
+		Cell * cells;
+		size_t mask;
+		alignas(64) std::atomic<size_t> enqueuePosition; //positions are on separate cache lines so producers and consumers do not contend
+		alignas(64) std::atomic<size_t> dequeuePosition;
+};
+
+#endif
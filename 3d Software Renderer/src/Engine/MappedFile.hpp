@@ -0,0 +1,86 @@
+//MappedFile.hpp
+
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include <windows.h>
+#include <stdint.h>
+
+/*
+	Maps a whole file into memory (read-only), so that it can be parsed in place without copying it through a stream.
+	The mapping is released when the object is destroyed.
+*/
+
+//declare class
+class MappedFile {
+	public:
+		//constructor
+		MappedFile(const char * filePath){
+			//open file
+			this->fileHandle = CreateFile(filePath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+			
+			if(this->fileHandle == INVALID_HANDLE_VALUE){
+				return;
+			};
+			
+			//get file size (empty files cannot be mapped)
+			LARGE_INTEGER fileSize;
+			if(!GetFileSizeEx(this->fileHandle, &fileSize) || fileSize.QuadPart == 0){
+				return;
+			};
+			
+			//map file
+			this->mappingHandle = CreateFileMapping(this->fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+			
+			if(this->mappingHandle == NULL){
+				return;
+			};
+			
+			this->data = (const uint8_t *) MapViewOfFile(this->mappingHandle, FILE_MAP_READ, 0, 0, 0);
+			
+			if(this->data != nullptr){
+				this->size = (size_t) fileSize.QuadPart;
+			};
+		};
+		
+		//destructor
+		~MappedFile(){
+			if(this->data != nullptr){
+				UnmapViewOfFile(this->data);
+			};
+			
+			if(this->mappingHandle != NULL){
+				CloseHandle(this->mappingHandle);
+			};
+			
+			if(this->fileHandle != INVALID_HANDLE_VALUE){
+				CloseHandle(this->fileHandle);
+			};
+		};
+		
+		//prevent copying (the destructor would release the mapping twice)
+		MappedFile(const MappedFile &) = delete;
+		MappedFile & operator=(const MappedFile &) = delete;
+		
+		//getters
+		bool isOpen(){
+			return this->data != nullptr;
+		};
+		
+		const uint8_t * getData(){
+			return this->data;
+		};
+		
+		size_t getSize(){
+			return this->size;
+		};
+	
+	private:
+		//data members
+		HANDLE fileHandle = INVALID_HANDLE_VALUE;
+		HANDLE mappingHandle = NULL;
+		const uint8_t * data = nullptr;
+		size_t size = 0;
+};
+
+#endif
@@ -10,6 +10,7 @@
 			3d vector
 			4d vector
 			4x4 matrix
+			quaternion (for orientations)
 		These have been chosen because they are all useful for 3d graphics and will be used in the game engine extensively.
 		If different types are needed, or different dimensions of vectors or matrices are needed, these should be added ad hoc.
 		
@@ -32,7 +33,7 @@ class Vec2f {
 		double y;
 		
 		Vec2f(){this->x = 0; this->y = 0;};		
-		Vec2f(double x, double y) : x(this->x), y(this->y) {};
+		Vec2f(double x, double y) : x(x), y(y) {};
 		
 		//overload arithmetic operators
 		Vec2f operator+(Vec2f & v){
@@ -70,7 +71,7 @@ class Vec3f {
 		double z;
 		
 		Vec3f(){this->x = 0; this->y = 0; this->z = 0;};		
-		Vec3f(double x, double y, double z) : x(this->x), y(this->y), z(this->z) {};
+		Vec3f(double x, double y, double z) : x(x), y(y), z(z) {};
 
 		//overload arithmetic operators
 		Vec3f operator+(Vec3f & v){
@@ -198,6 +199,21 @@ class Mat4x4f {
 		};
 };
 
+//quaternion
+//a unit quaternion (w, x, y, z) = (cos(a / 2), sin(a / 2) * axis) is a rotation by a around the axis (anticlockwise, looking along the
+//axis towards the origin, unlike the rotation matrices below, which rotate the other way around the x and y axes)
+class Quaternion {
+	public:
+		double w;
+		double x;
+		double y;
+		double z;
+		
+		Quaternion(){this->w = 1; this->x = 0; this->y = 0; this->z = 0;};
+		
+		Quaternion(double w, double x, double y, double z) : w(w), x(x), y(y), z(z) {};
+};
+
 //maths class - this is a static class that is not meant to be instantiated
 //it provides methods for matrix and vector operations
 class Math {
@@ -365,6 +381,98 @@ class Math {
 					a.data[j][i] = temp;
 				};
 			};
+			
+			return a;
+		};
+		
+		//matrix inverse
+		/*
+			The inverse is found by Gauss-Jordan elimination: row operations that reduce the matrix to the identity are applied to an
+			identity matrix at the same time, which turns it into the inverse. The row with the largest value in the current column is
+			used as the pivot, to reduce rounding errors. A singular matrix has no inverse - the identity matrix is returned.
+		*/
+		static Mat4x4f matrixInverse(Mat4x4f a){
+			Mat4x4f result = Math::identityMatrix();
+			
+			for(int column = 0; column < 4; column++){
+				//find pivot row
+				int pivot = column;
+				for(int row = column + 1; row < 4; row++){
+					if(fabs(a.data[row][column]) > fabs(a.data[pivot][column])){
+						pivot = row;
+					};
+				};
+				
+				if(a.data[pivot][column] == 0){
+					return Math::identityMatrix();
+				};
+				
+				//swap pivot row into place
+				for(int j = 0; j < 4; j++){
+					double temp = a.data[column][j];
+					a.data[column][j] = a.data[pivot][j];
+					a.data[pivot][j] = temp;
+					
+					temp = result.data[column][j];
+					result.data[column][j] = result.data[pivot][j];
+					result.data[pivot][j] = temp;
+				};
+				
+				//scale pivot row so the pivot is 1
+				double scale = 1 / a.data[column][column];
+				for(int j = 0; j < 4; j++){
+					a.data[column][j] *= scale;
+					result.data[column][j] *= scale;
+				};
+				
+				//eliminate column from the other rows
+				for(int row = 0; row < 4; row++){
+					if(row != column){
+						double factor = a.data[row][column];
+						
+						for(int j = 0; j < 4; j++){
+							a.data[row][j] -= factor * a.data[column][j];
+							result.data[row][j] -= factor * result.data[column][j];
+						};
+					};
+				};
+			};
+			
+			return result;
+		};
+		
+		//normal matrix
+		/*
+			Normals cannot be transformed by the same matrix as positions: a transform that stretches a model along one axis would tilt its
+			normals the wrong way. The transpose of the inverse keeps them perpendicular to the surface. Normals are directions, so the
+			translation is removed.
+			
+			For a rotation scaled by s, the transpose of the inverse is the rotation divided by s, so it is multiplied by s (the cube root of
+			the determinant) to keep unit normals unit length. Under a non-uniform scale their lengths still change, by as much as the ratio
+			of the largest scale to the smallest, so lighting renormalises them (see LightSet::lightVertices).
+		*/
+		static Mat4x4f normalMatrix(Mat4x4f a){
+			Mat4x4f result = Math::matrixTranspose(Math::matrixInverse(a));
+			
+			//determinant of the upper 3x3 (rotation and scale) part
+			double determinant = a.data[0][0] * (a.data[1][1] * a.data[2][2] - a.data[1][2] * a.data[2][1]) - a.data[0][1] * (a.data[1][0] * a.data[2][2] - a.data[1][2] * a.data[2][0]) + a.data[0][2] * (a.data[1][0] * a.data[2][1] - a.data[1][1] * a.data[2][0]);
+			double scale = cbrt(fabs(determinant));
+			
+			for(int i = 0; i < 3; i++){
+				for(int j = 0; j < 3; j++){
+					result.data[i][j] *= scale;
+				};
+			};
+			
+			result.data[0][3] = 0;
+			result.data[1][3] = 0;
+			result.data[2][3] = 0;
+			result.data[3][0] = 0;
+			result.data[3][1] = 0;
+			result.data[3][2] = 0;
+			result.data[3][3] = 1;
+			
+			return result;
 		};
 		
 		//identity matrix
@@ -540,6 +648,89 @@ class Math {
 			return Math::rotationMatrix(r.x, r.y, r.z);
 		};
 		
+		//quaternions
+		//quaternion from axis (unit vector) and angle
+		static Quaternion quaternionFromAxisAngle(Vec4f axis, double angle){
+			double s = sin(angle / 2);
+			return Quaternion(cos(angle / 2), axis.x * s, axis.y * s, axis.z * s);
+		};
+		
+		//quaternion product (the rotation b followed by the rotation a)
+		static Quaternion quaternionProduct(Quaternion a, Quaternion b){
+			return Quaternion(
+				a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z,
+				a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+				a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x,
+				a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w
+			);
+		};
+		
+		//quaternion conjugate (the inverse rotation, for a unit quaternion)
+		static Quaternion quaternionConjugate(Quaternion q){
+			return Quaternion(q.w, -q.x, -q.y, -q.z);
+		};
+		
+		//normalise quaternion (repeated products drift away from unit length through rounding)
+		static Quaternion normalise(Quaternion q){
+			double length = sqrt(q.w * q.w + q.x * q.x + q.y * q.y + q.z * q.z);
+			return Quaternion(q.w / length, q.x / length, q.y / length, q.z / length);
+		};
+		
+		//rotate vector by quaternion
+		//v' = v + 2w(u x v) + 2u x (u x v), where u is the vector part of the quaternion
+		static Vec4f quaternionRotate(Quaternion q, Vec4f v){
+			Vec4f u(q.x, q.y, q.z, 0.0f);
+			Vec4f t = Math::scalarProduct(2, Math::crossProduct(u, v));
+			Vec4f ut = Math::crossProduct(u, t);
+			return Vec4f(v.x + q.w * t.x + ut.x, v.y + q.w * t.y + ut.y, v.z + q.w * t.z + ut.z, v.w);
+		};
+		
+		//rotation matrix from quaternion
+		static Mat4x4f quaternionToMatrix(Quaternion q){
+			Mat4x4f m = Math::identityMatrix();
+			
+			m.data[0][0] = 1 - 2 * (q.y * q.y + q.z * q.z);
+			m.data[0][1] = 2 * (q.x * q.y - q.w * q.z);
+			m.data[0][2] = 2 * (q.x * q.z + q.w * q.y);
+			
+			m.data[1][0] = 2 * (q.x * q.y + q.w * q.z);
+			m.data[1][1] = 1 - 2 * (q.x * q.x + q.z * q.z);
+			m.data[1][2] = 2 * (q.y * q.z - q.w * q.x);
+			
+			m.data[2][0] = 2 * (q.x * q.z - q.w * q.y);
+			m.data[2][1] = 2 * (q.y * q.z + q.w * q.x);
+			m.data[2][2] = 1 - 2 * (q.x * q.x + q.y * q.y);
+			
+			return m;
+		};
+		
+		//spherical linear interpolation
+		/*
+			Interpolates along the shortest arc between two orientations at a constant angular speed. q and -q are the same orientation, so b
+			is negated if that is closer to a. For nearly equal quaternions sin(angle) is too small to divide by, so they are interpolated
+			linearly and normalised instead.
+		*/
+		static Quaternion slerp(Quaternion a, Quaternion b, double t){
+			double cosAngle = a.w * b.w + a.x * b.x + a.y * b.y + a.z * b.z;
+			
+			if(cosAngle < 0){
+				b = Quaternion(-b.w, -b.x, -b.y, -b.z);
+				cosAngle = -cosAngle;
+			};
+			
+			double weightA = 1 - t;
+			double weightB = t;
+			
+			if(cosAngle < 0.9995){
+				double angle = acos(cosAngle);
+				double sinAngle = sin(angle);
+				weightA = sin((1 - t) * angle) / sinAngle;
+				weightB = sin(t * angle) / sinAngle;
+			};
+			
+			return Math::normalise(Quaternion(a.w * weightA + b.w * weightB, a.x * weightA + b.x * weightB, a.y * weightA + b.y * weightB, a.z * weightA + b.z * weightB));
+		};
+		
 		//create translation matrix
 		static Mat4x4f translationMatrix(double x, double y, double z){
 			Mat4x4f result = Math::identityMatrix();
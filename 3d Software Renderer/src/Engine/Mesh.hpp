@@ -8,9 +8,11 @@
 #include <string>
 #include <fstream>
 #include <vector>
+#include <unordered_map>
 #include "Mathematics.hpp"
 #include "Pixel.hpp"
 #include "Bitmap.hpp"
+#include "Frustum.hpp"
 
 //vertex
 struct Vertex {
@@ -30,6 +32,62 @@ struct Triangle {
 
 //maybe make notes on copy constructors?
 
+//bounds (axis-aligned box and a bounding sphere around its centre)
+struct Bounds {
+	Vec4f min;
+	Vec4f max;
+	Vec4f centre;
+	double radius;
+};
+
+//submesh (a range of triangles from one object or group of the .obj file)
+struct Submesh {
+	std::string name;
+	int firstTriangle;
+	int triangleCount;
+	int firstMeshlet;
+	int meshletCount;
+	Bounds bounds;
+};
+
+//meshlet (a range of up to MESHLET_MAX_TRIANGLES neighbouring triangles within a submesh)
+struct Meshlet {
+	int firstTriangle;
+	int triangleCount;
+	
+	//bounding sphere
+	Vec4f centre;
+	double radius;
+	
+	//normal cone - the front faces of all triangles are within the cone around the axis (coneCutoff is the sine of its half angle, or 1 if the cone cannot be used for culling)
+	Vec4f coneAxis;
+	double coneCutoff;
+	
+	//range of vertices used (only set for quantized meshes)
+	int firstVertex;
+	int vertexCount;
+};
+
+/*
+	Notes about meshlets:
+	Each submesh is split into meshlets by growing clusters of triangles across shared vertices, starting from the first unused triangle.
+	The next triangle added is the neighbour whose normal is closest to the cluster's average normal, so a meshlet tends to be a connected
+	patch facing one way. Growth stops at MESHLET_MAX_TRIANGLES, or once there are MESHLET_MIN_TRIANGLES if the closest neighbour is
+	too far from the average normal. A meshlet that runs out of neighbours before it has MESHLET_MIN_TRIANGLES continues from the
+	nearest unused triangle, so small separate pieces of the mesh are grouped together.
+	
+	The front faces of a meshlet all point within its normal cone, so the whole meshlet is back-facing if the camera is behind the cone
+	from every point of the bounding sphere (see Renderer::isMeshletBackFacing). This lets the renderer skip back-facing meshlets before
+	any of their vertices are transformed.
+*/
+
+//meshlet size limits
+#define MESHLET_MAX_TRIANGLES 128
+#define MESHLET_MIN_TRIANGLES 32
+
+//once a meshlet has MESHLET_MIN_TRIANGLES, growth stops if the closest neighbour's normal has a lower dot product than this with the average normal
+#define MESHLET_NORMAL_THRESHOLD 0.85
+
 /*
 	Notes about the .obj file format:
 	# defines a comment
@@ -38,6 +96,7 @@ struct Triangle {
 	vt defines texture coordinates, also called UV coordinates, with (x, y) coordinates 
 	f defines a face using 3 vertices each in the format: "vertex coordinate/texture coordinate/normal vector" and each separated by a space.
 		-Note that if no texture coordinates are present, vertices will be expressed in the form "vertex coordinate//normal vector"
+	o and g start a new object or group - the triangles after them (up to the next o or g) form a submesh
 		
 */
 
@@ -51,11 +110,22 @@ class Mesh {
 		std::vector<Vec4f> normals;
 		std::vector<Triangle> triangles;
 		
+		//bounds, submeshes and meshlets (calculated by prepareMesh)
+		Bounds bounds;
+		std::vector<Submesh> submeshes;
+		std::vector<Meshlet> meshlets;
+		
+		//object space plane of each triangle, with the normal pointing out of its front face (calculated by prepareMesh)
+		std::vector<Plane> facePlanes;
+		
+		//levels of detail, from most to least detailed (generated by MeshSimplifier::generateLods)
+		std::vector<Mesh> lods;
+		
 		//static
 		static bool loadMeshFromObjFile(std::string filePath, Mesh * mesh, std::string bitmapFilePath, Bitmap * bmp){
 			//load bitmap
 			if(bmp != nullptr){
-				Bitmap::loadBitmapFromBMPFile(bitmapFilePath.c_str(), bmp);
+				Bitmap::loadBitmapFromFile(bitmapFilePath.c_str(), bmp);
 			};
 			
 			//open file
@@ -68,12 +138,16 @@ class Mesh {
 				mesh->vertices.clear();
 				mesh->normals.clear();
 				mesh->triangles.clear();
+				mesh->submeshes.clear();
 				
 				//reserve 
 				mesh->vertices.reserve(100);
 				mesh->normals.reserve(100);
 				mesh->triangles.reserve(100);
 				
+				//set if a face vertex has no normal
+				bool missingNormals = false;
+				
 				//read through .obj file once to count the number of vertices, normals and faces
 				std::string line;
 				while(std::getline(file, line)){
@@ -109,6 +183,12 @@ class Mesh {
 						lineStream >> tex.x;
 						lineStream >> tex.y;
 						mesh->textureCoords.push_back(tex);
+					} else if(token == "o" || token == "g"){
+						//start submesh
+						Submesh submesh;
+						lineStream >> submesh.name;
+						submesh.firstTriangle = mesh->triangles.size();
+						mesh->submeshes.push_back(submesh);
 					} else if(token == "f"){
 						//add face to triangles
 						Triangle t;
@@ -122,8 +202,8 @@ class Mesh {
 							int startIndex = 0;
 							int endIndex = 0;
 							
-							//index data
-							int indices[3];
+							//index data (-1 where an index is missing)
+							int indices[3] = {-1, -1, -1};
 							int indexCount = 0;
 							bool numEndReached = false;
 							
@@ -182,6 +262,8 @@ class Mesh {
 							
 							if(indices[2] >= 0){
 								t.vertices[i].normal = mesh->normals[indices[2] - 1];
+							} else {
+								missingNormals = true;
 							};
 						};
 						
@@ -194,10 +276,509 @@ class Mesh {
 				//close file
 				file.close();
 				
+				//generate normals if any are missing, otherwise make sure the ones in the file are unit length
+				if(missingNormals){
+					Mesh::calculateSmoothNormals(mesh);
+				} else {
+					Mesh::normaliseNormals(mesh);
+				};
+				
+				//calculate bounds
+				Mesh::prepareMesh(mesh);
+				
 				return true;
 			};
 			return false;
 		};
+		
+		//create box mesh
+		//creates an untextured axis-aligned box (used as a placeholder while a mesh is loading)
+		static void createBoxMesh(Mesh * mesh, Vec4f min, Vec4f max){
+			mesh->vertices.clear();
+			mesh->textureCoords.clear();
+			mesh->normals.clear();
+			mesh->triangles.clear();
+			mesh->submeshes.clear();
+			
+			//corners (bit 0 selects x, bit 1 selects y, bit 2 selects z)
+			for(int i = 0; i < 8; i++){
+				mesh->vertices.push_back(Vec4f(i & 1 ? max.x : min.x, i & 2 ? max.y : min.y, i & 4 ? max.z : min.z, 1.0f));
+			};
+			
+			//faces, each with the corners in order around the face and the outward normal
+			int faces[6][4] = {{0, 2, 6, 4}, {1, 5, 7, 3}, {0, 4, 5, 1}, {2, 3, 7, 6}, {0, 1, 3, 2}, {4, 6, 7, 5}};
+			Vec4f faceNormals[6] = {Vec4f(-1.0f, 0.0f, 0.0f, 0.0f), Vec4f(1.0f, 0.0f, 0.0f, 0.0f), Vec4f(0.0f, -1.0f, 0.0f, 0.0f), Vec4f(0.0f, 1.0f, 0.0f, 0.0f), Vec4f(0.0f, 0.0f, -1.0f, 0.0f), Vec4f(0.0f, 0.0f, 1.0f, 0.0f)};
+			
+			for(int i = 0; i < 6; i++){
+				for(int j = 0; j < 2; j++){
+					Triangle t;
+					t.texture = nullptr;
+					
+					int corners[3] = {faces[i][0], faces[i][j + 1], faces[i][j + 2]};
+					
+					for(int k = 0; k < 3; k++){
+						t.vertices[k].position = mesh->vertices[corners[k]];
+						t.vertices[k].normal = faceNormals[i];
+					};
+					
+					//wind the triangle so that its front face (the side its cross product points to) faces outward
+					Vec4f normal = Math::crossProduct(t.vertices[1].position - t.vertices[0].position, t.vertices[2].position - t.vertices[0].position);
+					if(Math::dotProduct(normal, faceNormals[i]) < 0){
+						Vertex temp = t.vertices[1];
+						t.vertices[1] = t.vertices[2];
+						t.vertices[2] = temp;
+					};
+					
+					mesh->triangles.push_back(t);
+				};
+			};
+			
+			//calculate bounds
+			Mesh::prepareMesh(mesh);
+		};
+		
+		//prepare mesh
+		/*
+			Sets the triangle count of each submesh from where the next one starts (triangles before the first o or g are given a submesh
+			of their own), removes empty submeshes, splits each submesh into meshlets (which reorders the triangles within the submesh),
+			calculates the bounds of the mesh, of each submesh and of each meshlet, and calculates the face planes.
+			This must be called again if the triangles are changed.
+		*/
+		static void prepareMesh(Mesh * mesh){
+			//add submesh for triangles before the first object or group (or for the whole mesh if there are none)
+			if(mesh->submeshes.size() == 0 || mesh->submeshes[0].firstTriangle > 0){
+				Submesh submesh;
+				submesh.firstTriangle = 0;
+				mesh->submeshes.insert(mesh->submeshes.begin(), submesh);
+			};
+			
+			//set triangle counts and remove empty submeshes
+			std::vector<Submesh> submeshes;
+			mesh->meshlets.clear();
+			
+			for(int i = 0; i < mesh->submeshes.size(); i++){
+				Submesh submesh = mesh->submeshes[i];
+				int end = i + 1 < mesh->submeshes.size() ? mesh->submeshes[i + 1].firstTriangle : mesh->triangles.size();
+				submesh.triangleCount = end - submesh.firstTriangle;
+				
+				if(submesh.triangleCount > 0){
+					Mesh::buildMeshlets(mesh, &submesh);
+					submesh.bounds = Mesh::calculateBounds(mesh, submesh.firstTriangle, submesh.triangleCount);
+					submeshes.push_back(submesh);
+				};
+			};
+			
+			mesh->submeshes = submeshes;
+			mesh->bounds = Mesh::calculateBounds(mesh, 0, mesh->triangles.size());
+			Mesh::calculateFacePlanes(mesh);
+		};
+		
+		//calculate face planes
+		//this must be called again if the triangles are reordered
+		static void calculateFacePlanes(Mesh * mesh){
+			mesh->facePlanes.resize(mesh->triangles.size());
+			
+			for(int i = 0; i < mesh->triangles.size(); i++){
+				Plane & plane = mesh->facePlanes[i];
+				plane.normal = Mesh::calculateFaceNormal(&mesh->triangles[i]);
+				plane.distance = -Math::dotProduct(plane.normal, mesh->triangles[i].vertices[0].position);
+			};
+		};
+		
+		//normalise normals
+		//lighting expects unit normals, which .obj files do not guarantee (zero normals are left as they are)
+		static void normaliseNormals(Mesh * mesh){
+			for(int i = 0; i < mesh->triangles.size(); i++){
+				for(int j = 0; j < 3; j++){
+					Vec4f & normal = mesh->triangles[i].vertices[j].normal;
+					
+					if(Math::magnitude(normal) > 0){
+						normal = Math::normalise(normal);
+					};
+				};
+			};
+		};
+		
+		//calculate smooth normals
+		/*
+			Used for meshes loaded without normals. The normal at each vertex is the sum of the face normals of the triangles around it, each
+			weighted by the angle of the triangle's corner at the vertex, so it does not depend on how the faces are split into triangles (a
+			quad split in two would otherwise count twice as much as a triangle beside it). Vertices are welded by position, so the normals
+			are smooth across texture seams.
+		*/
+		static void calculateSmoothNormals(Mesh * mesh){
+			std::unordered_map<std::string, int> positionMap;
+			std::vector<int> triangleVertices(mesh->triangles.size() * 3);
+			std::vector<Vec4f> normalSums;
+			
+			for(int i = 0; i < mesh->triangles.size(); i++){
+				Triangle & t = mesh->triangles[i];
+				Vec4f faceNormal = Mesh::calculateFaceNormal(&t);
+				
+				for(int j = 0; j < 3; j++){
+					std::string key((const char *) &t.vertices[j].position, sizeof(Vec4f));
+					int vertex = positionMap.emplace(key, (int) positionMap.size()).first->second;
+					triangleVertices[i * 3 + j] = vertex;
+					
+					if(vertex == normalSums.size()){
+						normalSums.push_back(Vec4f(0.0f, 0.0f, 0.0f, 0.0f));
+					};
+					
+					//find the angle of the corner from the edges leaving it
+					Vec4f edge1 = t.vertices[(j + 1) % 3].position - t.vertices[j].position;
+					Vec4f edge2 = t.vertices[(j + 2) % 3].position - t.vertices[j].position;
+					double lengths = Math::magnitude(edge1) * Math::magnitude(edge2);
+					
+					if(lengths > 0){
+						double angle = acos(fmax(-1.0, fmin(1.0, Math::dotProduct(edge1, edge2) / lengths)));
+						Vec4f weightedNormal = Math::scalarProduct(angle, faceNormal);
+						normalSums[vertex] += weightedNormal;
+					};
+				};
+			};
+			
+			//vertices only used by degenerate triangles are left with the (zero) face normal
+			for(int i = 0; i < mesh->triangles.size(); i++){
+				for(int j = 0; j < 3; j++){
+					Vec4f & normalSum = normalSums[triangleVertices[i * 3 + j]];
+					mesh->triangles[i].vertices[j].normal = Math::magnitude(normalSum) > 0 ? Math::normalise(normalSum) : normalSum;
+				};
+			};
+		};
+		
+		//calculate flat normals
+		//sets the normal of every vertex to the unit normal of its face, so each triangle is lit evenly and edges between faces stay sharp
+		static void calculateFlatNormals(Mesh * mesh){
+			for(int i = 0; i < mesh->triangles.size(); i++){
+				Vec4f faceNormal = Mesh::calculateFaceNormal(&mesh->triangles[i]);
+				
+				for(int j = 0; j < 3; j++){
+					mesh->triangles[i].vertices[j].normal = faceNormal;
+				};
+			};
+		};
+		
+		//build meshlets
+		//splits the triangles of a submesh into meshlets (see notes on meshlets) and reorders them so each meshlet is a contiguous range
+		static void buildMeshlets(Mesh * mesh, Submesh * submesh){
+			int start = submesh->firstTriangle;
+			int count = submesh->triangleCount;
+			
+			//weld vertices by position, so triangles that share a corner are neighbours even if their texture coordinates or normals differ
+			std::unordered_map<std::string, int> positionMap;
+			std::vector<int> triangleVertices(count * 3);
+			
+			for(int i = 0; i < count; i++){
+				for(int j = 0; j < 3; j++){
+					std::string key((const char *) &mesh->triangles[start + i].vertices[j].position, sizeof(Vec4f));
+					triangleVertices[i * 3 + j] = positionMap.emplace(key, (int) positionMap.size()).first->second;
+				};
+			};
+			
+			//build vertex to triangle adjacency (the triangles of vertex v are adjacency[offsets[v]] to adjacency[offsets[v + 1] - 1])
+			std::vector<int> offsets(positionMap.size() + 1, 0);
+			std::vector<int> adjacency(count * 3);
+			
+			for(int i = 0; i < count * 3; i++){
+				offsets[triangleVertices[i] + 1]++;
+			};
+			
+			for(int i = 0; i < positionMap.size(); i++){
+				offsets[i + 1] += offsets[i];
+			};
+			
+			std::vector<int> fill(offsets.begin(), offsets.end() - 1);
+			for(int i = 0; i < count * 3; i++){
+				adjacency[fill[triangleVertices[i]]++] = i / 3;
+			};
+			
+			//calculate unit face normals (the direction the front face points) and centroids
+			std::vector<Vec4f> normals(count);
+			std::vector<Vec4f> centroids(count);
+			for(int i = 0; i < count; i++){
+				Triangle & t = mesh->triangles[start + i];
+				normals[i] = Mesh::calculateFaceNormal(&t);
+				centroids[i] = Vec4f((t.vertices[0].position.x + t.vertices[1].position.x + t.vertices[2].position.x) / 3, (t.vertices[0].position.y + t.vertices[1].position.y + t.vertices[2].position.y) / 3, (t.vertices[0].position.z + t.vertices[1].position.z + t.vertices[2].position.z) / 3, 1.0f);
+			};
+			
+			//grow meshlets
+			std::vector<bool> used(count, false);
+			std::vector<int> frontierMeshlet(count, -1); //the last meshlet each triangle was added to the frontier of
+			std::vector<int> frontier;
+			std::vector<int> order;
+			order.reserve(count);
+			
+			submesh->firstMeshlet = mesh->meshlets.size();
+			int seed = 0;
+			
+			while(order.size() < count){
+				//start from the first unused triangle
+				while(used[seed]){
+					seed++;
+				};
+				
+				int meshletIndex = mesh->meshlets.size();
+				int meshletStart = order.size();
+				Vec4f normalSum(0.0f, 0.0f, 0.0f, 0.0f);
+				Vec4f centroidSum(0.0f, 0.0f, 0.0f, 0.0f);
+				
+				frontier.clear();
+				frontier.push_back(seed);
+				frontierMeshlet[seed] = meshletIndex;
+				
+				while(order.size() - meshletStart < MESHLET_MAX_TRIANGLES && order.size() < count){
+					//if the meshlet has run out of neighbours while it is still small (a separate piece of the mesh), continue from the nearest unused triangle
+					if(frontier.size() == 0){
+						if(order.size() - meshletStart >= MESHLET_MIN_TRIANGLES){
+							break;
+						};
+						
+						//triangles facing the same way as the meshlet are preferred, so that its normal cone stays narrow
+						Vec4f meshletCentroid = Math::scalarProduct(1.0f / (order.size() - meshletStart), centroidSum);
+						Vec4f axis = Math::magnitude(normalSum) > 0 ? Math::normalise(normalSum) : normalSum;
+						int nearest = -1;
+						double nearestDistance = 0;
+						bool nearestFacing = false;
+						
+						for(int i = seed; i < count; i++){
+							if(used[i]){
+								continue;
+							};
+							
+							double distance = Math::magnitude(centroids[i] - meshletCentroid);
+							bool facing = Math::dotProduct(normals[i], axis) >= MESHLET_NORMAL_THRESHOLD;
+							
+							if(nearest == -1 || (facing && !nearestFacing) || (facing == nearestFacing && distance < nearestDistance)){
+								nearest = i;
+								nearestDistance = distance;
+								nearestFacing = facing;
+							};
+						};
+						
+						if(!nearestFacing){
+							break;
+						};
+						
+						frontier.push_back(nearest);
+						frontierMeshlet[nearest] = meshletIndex;
+					};
+					
+					//find the neighbour with the normal closest to the average normal
+					Vec4f axis = Math::magnitude(normalSum) > 0 ? Math::normalise(normalSum) : normalSum;
+					int best = 0;
+					double bestScore = -2;
+					
+					for(int i = 0; i < frontier.size(); i++){
+						double score = Math::dotProduct(normals[frontier[i]], axis);
+						
+						if(score > bestScore){
+							best = i;
+							bestScore = score;
+						};
+					};
+					
+					if(order.size() - meshletStart >= MESHLET_MIN_TRIANGLES && bestScore < MESHLET_NORMAL_THRESHOLD){
+						break;
+					};
+					
+					//add triangle to meshlet
+					int triangle = frontier[best];
+					frontier[best] = frontier.back();
+					frontier.pop_back();
+					
+					used[triangle] = true;
+					order.push_back(triangle);
+					normalSum += normals[triangle];
+					centroidSum += centroids[triangle];
+					
+					//add its unused neighbours to the frontier
+					for(int j = 0; j < 3; j++){
+						int vertex = triangleVertices[triangle * 3 + j];
+						
+						for(int k = offsets[vertex]; k < offsets[vertex + 1]; k++){
+							int neighbour = adjacency[k];
+							
+							if(!used[neighbour] && frontierMeshlet[neighbour] != meshletIndex){
+								frontier.push_back(neighbour);
+								frontierMeshlet[neighbour] = meshletIndex;
+							};
+						};
+					};
+				};
+				
+				//add meshlet
+				Meshlet meshlet;
+				meshlet.firstTriangle = start + meshletStart;
+				meshlet.triangleCount = order.size() - meshletStart;
+				meshlet.firstVertex = 0;
+				meshlet.vertexCount = 0;
+				mesh->meshlets.push_back(meshlet);
+			};
+			
+			submesh->meshletCount = mesh->meshlets.size() - submesh->firstMeshlet;
+			
+			//reorder triangles so that each meshlet is contiguous
+			std::vector<Triangle> triangles(count);
+			for(int i = 0; i < count; i++){
+				triangles[i] = mesh->triangles[start + order[i]];
+			};
+			
+			std::copy(triangles.begin(), triangles.end(), mesh->triangles.begin() + start);
+			
+			//calculate meshlet bounds and normal cones
+			for(int i = submesh->firstMeshlet; i < mesh->meshlets.size(); i++){
+				Mesh::calculateMeshletBounds(mesh, &mesh->meshlets[i]);
+			};
+		};
+		
+		//calculate meshlet bounds
+		static void calculateMeshletBounds(Mesh * mesh, Meshlet * meshlet){
+			//bounding sphere
+			Bounds bounds = Mesh::calculateBounds(mesh, meshlet->firstTriangle, meshlet->triangleCount);
+			meshlet->centre = bounds.centre;
+			meshlet->radius = bounds.radius;
+			
+			//cone axis is the average front face direction (degenerate triangles have no normal, and cannot be seen, so they are ignored)
+			Vec4f normalSum(0.0f, 0.0f, 0.0f, 0.0f);
+			for(int i = meshlet->firstTriangle; i < meshlet->firstTriangle + meshlet->triangleCount; i++){
+				normalSum += Mesh::calculateFaceNormal(&mesh->triangles[i]);
+			};
+			
+			meshlet->coneAxis = Vec4f(0.0f, 0.0f, 0.0f, 0.0f);
+			meshlet->coneCutoff = 1;
+			
+			if(Math::magnitude(normalSum) == 0){
+				return;
+			};
+			
+			meshlet->coneAxis = Math::normalise(normalSum);
+			
+			//the cone half angle is the largest angle between the axis and a normal
+			double minimumDot = 1;
+			for(int i = meshlet->firstTriangle; i < meshlet->firstTriangle + meshlet->triangleCount; i++){
+				Vec4f normal = Mesh::calculateFaceNormal(&mesh->triangles[i]);
+				
+				if(Math::magnitude(normal) > 0){
+					minimumDot = fmin(minimumDot, Math::dotProduct(normal, meshlet->coneAxis));
+				};
+			};
+			
+			//a cone of 90 degrees or more always has a normal facing the camera
+			if(minimumDot > 0){
+				meshlet->coneCutoff = sqrt(1 - minimumDot * minimumDot);
+			};
+		};
+		
+		//calculate face normal
+		//unit vector in the direction the front face points (the side that is drawn), or zero for a degenerate triangle
+		static Vec4f calculateFaceNormal(Triangle * triangle){
+			Vec4f normal = Math::crossProduct(triangle->vertices[1].position - triangle->vertices[0].position, triangle->vertices[2].position - triangle->vertices[0].position);
+			double length = Math::magnitude(normal);
+			
+			return length > 0 ? Math::scalarProduct(1.0f / length, normal) : Vec4f(0.0f, 0.0f, 0.0f, 0.0f);
+		};
+		
+		//transform bounds
+		/*
+			The box is transformed by moving its centre and finding the extent of the transformed box along each axis, which is the sum of
+			the absolute values of the matrix row multiplied by the original extents. The result encloses the transformed box (which is no
+			longer axis-aligned if the transform includes a rotation). The sphere radius is scaled by the largest scale of the transform.
+		*/
+		static Bounds transformBounds(Bounds bounds, Mat4x4f transform){
+			Vec4f boxCentre((bounds.min.x + bounds.max.x) / 2, (bounds.min.y + bounds.max.y) / 2, (bounds.min.z + bounds.max.z) / 2, 1.0f);
+			Vec4f extent((bounds.max.x - bounds.min.x) / 2, (bounds.max.y - bounds.min.y) / 2, (bounds.max.z - bounds.min.z) / 2, 0.0f);
+			
+			boxCentre = Math::matrixProduct(transform, boxCentre);
+			Vec4f newExtent(fabs(transform.data[0][0]) * extent.x + fabs(transform.data[0][1]) * extent.y + fabs(transform.data[0][2]) * extent.z, fabs(transform.data[1][0]) * extent.x + fabs(transform.data[1][1]) * extent.y + fabs(transform.data[1][2]) * extent.z, fabs(transform.data[2][0]) * extent.x + fabs(transform.data[2][1]) * extent.y + fabs(transform.data[2][2]) * extent.z, 0.0f);
+			
+			//largest scale is the length of the longest column of the rotation and scale part of the matrix
+			double scale = 0;
+			for(int i = 0; i < 3; i++){
+				scale = fmax(scale, Math::magnitude(Vec4f(transform.data[0][i], transform.data[1][i], transform.data[2][i], 0.0f)));
+			};
+			
+			Bounds result;
+			result.min = Vec4f(boxCentre.x - newExtent.x, boxCentre.y - newExtent.y, boxCentre.z - newExtent.z, 1.0f);
+			result.max = Vec4f(boxCentre.x + newExtent.x, boxCentre.y + newExtent.y, boxCentre.z + newExtent.z, 1.0f);
+			result.centre = Math::matrixProduct(transform, bounds.centre);
+			result.radius = bounds.radius * scale;
+			return result;
+		};
+		
+		//calculate bounds of a range of triangles
+		static Bounds calculateBounds(Mesh * mesh, int firstTriangle, int triangleCount){
+			Bounds bounds;
+			
+			if(triangleCount == 0){
+				bounds.min = Vec4f(0.0f, 0.0f, 0.0f, 1.0f);
+				bounds.max = Vec4f(0.0f, 0.0f, 0.0f, 1.0f);
+				bounds.centre = Vec4f(0.0f, 0.0f, 0.0f, 1.0f);
+				bounds.radius = 0;
+				return bounds;
+			};
+			
+			//calculate box
+			bounds.min = mesh->triangles[firstTriangle].vertices[0].position;
+			bounds.max = bounds.min;
+			
+			for(int i = firstTriangle; i < firstTriangle + triangleCount; i++){
+				for(int j = 0; j < 3; j++){
+					Vec4f & p = mesh->triangles[i].vertices[j].position;
+					bounds.min = Vec4f(fmin(bounds.min.x, p.x), fmin(bounds.min.y, p.y), fmin(bounds.min.z, p.z), 1.0f);
+					bounds.max = Vec4f(fmax(bounds.max.x, p.x), fmax(bounds.max.y, p.y), fmax(bounds.max.z, p.z), 1.0f);
+				};
+			};
+			
+			//calculate sphere around the centre of the box (the radius is the distance to the furthest vertex, which is often less than half the diagonal)
+			bounds.centre = Vec4f((bounds.min.x + bounds.max.x) / 2, (bounds.min.y + bounds.max.y) / 2, (bounds.min.z + bounds.max.z) / 2, 1.0f);
+			bounds.radius = 0;
+			
+			for(int i = firstTriangle; i < firstTriangle + triangleCount; i++){
+				for(int j = 0; j < 3; j++){
+					bounds.radius = fmax(bounds.radius, Math::magnitude(mesh->triangles[i].vertices[j].position - bounds.centre));
+				};
+			};
+			
+			return bounds;
+		};
+		
+		//build index buffer
+		/*
+			Triangles store a full copy of each of their vertices, so a vertex shared by several triangles is stored several times.
+			This welds together vertices with identical position, texture coordinate and normal, producing a list of unique vertices
+			and an index buffer (three indices per triangle, in the same order as mesh->triangles).
+		*/
+		static void buildIndexBuffer(Mesh * mesh, std::vector<Vertex> * uniqueVertices, std::vector<unsigned int> * indices){
+			//clear output
+			uniqueVertices->clear();
+			indices->clear();
+			indices->reserve(mesh->triangles.size() * 3);
+			
+			//map from vertex attributes to unique vertex index
+			std::unordered_map<std::string, unsigned int> vertexMap;
+			vertexMap.reserve(mesh->triangles.size() * 3);
+			
+			//iterate through triangle vertices
+			for(int i = 0; i < mesh->triangles.size(); i++){
+				for(int j = 0; j < 3; j++){
+					Vertex & vertex = mesh->triangles[i].vertices[j];
+					
+					//build key from the raw bytes of the attributes that identify a vertex
+					std::string key;
+					key.append((const char *) &vertex.position, sizeof(Vec4f));
+					key.append((const char *) &vertex.textureCoord, sizeof(Vec2f));
+					key.append((const char *) &vertex.normal, sizeof(Vec4f));
+					
+					//add vertex if it has not been seen before
+					auto result = vertexMap.emplace(key, (unsigned int) uniqueVertices->size());
+					if(result.second){
+						uniqueVertices->push_back(vertex);
+					};
+					
+					indices->push_back(result.first->second);
+				};
+			};
+		};
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,466 @@
+//MeshOptimiser.hpp
+
+#ifndef MESH_OPTIMISER_HPP
+#define MESH_OPTIMISER_HPP
+
+#include <vector>
+#include <algorithm>
+#include "Mathematics.hpp"
+#include "Mesh.hpp"
+#include "QuantizedMesh.hpp"
+
+/*
+	Notes about mesh optimisation:
+	The order of triangles in an .obj file is whatever the modelling program exported. This class reorders triangles (and vertices) once,
+	when a mesh is loaded, in three passes:
+	
+	1. Vertex cache optimisation (Tipsify, Sander et al. 2007)
+		Triangles are emitted as fans around a "fanning" vertex. The next fanning vertex is chosen from the vertices of the triangles just
+		emitted, preferring vertices that are still in the cache and have few remaining triangles. When no candidate is suitable (a dead end),
+		the most recently used vertex with triangles left is used, and the triangles emitted since the last dead end form a cluster.
+	
+	2. Overdraw optimisation (clusters from Tipsify, sorted as in Sander et al. 2007)
+		Each cluster is split further at points where the cache efficiency is still good, then the clusters are sorted so that those facing
+		away from the centre of the mesh are drawn first. These tend to be in front of the others, so more pixels fail the depth test early.
+	
+	3. Vertex fetch optimisation
+		Vertices are reordered into the order that they are first referenced, so vertex reads walk through memory sequentially.
+	
+	Average cache miss ratio (ACMR) is the number of vertices transformed per triangle with a FIFO post-transform cache. It is 3 for no
+	reuse, and approaches 0.5 for a large regular grid.
+*/
+
+//cache size used for optimisation and reporting
+#define MESH_OPTIMISER_CACHE_SIZE 16
+
+//a cluster is split where the running miss ratio is at most this multiple of the cluster's miss ratio
+#define MESH_OPTIMISER_OVERDRAW_THRESHOLD 1.05
+
+//mesh optimisation statistics (of the mesh itself, not its levels of detail)
+struct MeshOptimisationStatistics {
+	int triangleCount;
+	double acmrBefore;
+	double acmrAfter;
+};
+
+//declare class
+class MeshOptimiser {
+	public:
+		//calculate average cache miss ratio with a FIFO cache of the given size
+		static double calculateACMR(const std::vector<unsigned int> & indices, int vertexCount, int cacheSize){
+			if(indices.size() == 0){
+				return 0;
+			};
+			
+			//timestamp of each vertex entering the cache
+			std::vector<int> cacheTime(vertexCount, -cacheSize - 1);
+			int time = 0;
+			int misses = 0;
+			
+			for(int i = 0; i < indices.size(); i++){
+				//vertex is in the cache if it entered fewer than cacheSize misses ago
+				if(time - cacheTime[indices[i]] > cacheSize){
+					cacheTime[indices[i]] = time;
+					time++;
+					misses++;
+				};
+			};
+			
+			return (double) misses / (indices.size() / 3);
+		};
+		
+		//vertex cache optimisation
+		/*
+			Returns the new order of triangles (as indices into the original triangle list), and the index into that order at which
+			each cluster starts.
+		*/
+		static void optimiseVertexCache(const std::vector<unsigned int> & indices, int vertexCount, int cacheSize, std::vector<unsigned int> * triangleOrder, std::vector<unsigned int> * clusters){
+			int triangleCount = indices.size() / 3;
+			
+			triangleOrder->clear();
+			triangleOrder->reserve(triangleCount);
+			clusters->clear();
+			
+			//build vertex-triangle adjacency
+			std::vector<unsigned int> adjacencyOffsets;
+			std::vector<unsigned int> adjacency;
+			MeshOptimiser::buildAdjacency(indices, vertexCount, &adjacencyOffsets, &adjacency);
+			
+			//number of triangles left to emit for each vertex
+			std::vector<int> liveTriangles(vertexCount);
+			for(int i = 0; i < vertexCount; i++){
+				liveTriangles[i] = adjacencyOffsets[i + 1] - adjacencyOffsets[i];
+			};
+			
+			std::vector<int> cacheTime(vertexCount, 0);
+			std::vector<bool> emitted(triangleCount, false);
+			std::vector<unsigned int> deadEndStack;
+			std::vector<unsigned int> candidates;
+			
+			int time = cacheSize + 1;
+			int cursor = 0;
+			int fanningVertex = 0;
+			bool newCluster = true;
+			
+			while(fanningVertex >= 0){
+				//start a new cluster after a dead end
+				if(newCluster){
+					if(clusters->size() == 0 || clusters->back() != triangleOrder->size()){
+						clusters->push_back(triangleOrder->size());
+					};
+					newCluster = false;
+				};
+				
+				candidates.clear();
+				
+				//emit all remaining triangles around the fanning vertex
+				for(int i = adjacencyOffsets[fanningVertex]; i < adjacencyOffsets[fanningVertex + 1]; i++){
+					unsigned int triangle = adjacency[i];
+					
+					if(!emitted[triangle]){
+						for(int j = 0; j < 3; j++){
+							unsigned int v = indices[triangle * 3 + j];
+							
+							deadEndStack.push_back(v);
+							candidates.push_back(v);
+							liveTriangles[v]--;
+							
+							//add vertex to cache if it is not already there
+							if(time - cacheTime[v] > cacheSize){
+								cacheTime[v] = time;
+								time++;
+							};
+						};
+						
+						emitted[triangle] = true;
+						triangleOrder->push_back(triangle);
+					};
+				};
+				
+				//choose the next fanning vertex from the candidates
+				int nextVertex = -1;
+				int bestPriority = -1;
+				
+				for(int i = 0; i < candidates.size(); i++){
+					unsigned int v = candidates[i];
+					
+					if(liveTriangles[v] > 0){
+						//prefer the oldest vertex that will still be in the cache after its remaining triangles are emitted
+						int priority = 0;
+						if(time - cacheTime[v] + 2 * liveTriangles[v] <= cacheSize){
+							priority = time - cacheTime[v];
+						};
+						
+						if(priority > bestPriority){
+							bestPriority = priority;
+							nextVertex = v;
+						};
+					};
+				};
+				
+				//dead end - use the most recently used vertex with triangles left, or the next one in input order
+				if(nextVertex == -1){
+					newCluster = true;
+					
+					while(deadEndStack.size() > 0 && nextVertex == -1){
+						unsigned int v = deadEndStack.back();
+						deadEndStack.pop_back();
+						
+						if(liveTriangles[v] > 0){
+							nextVertex = v;
+						};
+					};
+					
+					while(nextVertex == -1 && cursor < vertexCount){
+						if(liveTriangles[cursor] > 0){
+							nextVertex = cursor;
+						};
+						cursor++;
+					};
+				};
+				
+				fanningVertex = nextVertex;
+			};
+		};
+		
+		//overdraw optimisation
+		/*
+			Splits the clusters produced by optimiseVertexCache where the cache miss ratio of the triangles so far is within the threshold
+			of the whole cluster's ratio, then sorts the clusters by how much they face away from the centre of the mesh.
+			triangleOrder is reordered in place.
+		*/
+		static void optimiseOverdraw(const std::vector<unsigned int> & indices, const std::vector<Vec4f> & positions, int cacheSize, double threshold, std::vector<unsigned int> * triangleOrder, const std::vector<unsigned int> & clusters){
+			int triangleCount = triangleOrder->size();
+			
+			if(triangleCount == 0){
+				return;
+			};
+			
+			//split clusters at soft boundaries
+			std::vector<unsigned int> softClusters;
+			std::vector<int> cacheTime(positions.size(), -cacheSize - 1);
+			int time = 0;
+			
+			for(int c = 0; c < clusters.size(); c++){
+				int start = clusters[c];
+				int end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+				
+				//cache miss ratio of the whole cluster, starting from an empty cache
+				time += cacheSize + 1;
+				int clusterMisses = MeshOptimiser::countCacheMisses(indices, *triangleOrder, start, end, cacheSize, &cacheTime, &time);
+				double clusterACMR = (double) clusterMisses / (end - start);
+				
+				//walk the cluster again, starting a new soft cluster whenever the running ratio is good enough
+				time += cacheSize + 1;
+				softClusters.push_back(start);
+				int softStart = start;
+				int misses = 0;
+				
+				for(int i = start; i < end; i++){
+					misses += MeshOptimiser::countCacheMisses(indices, *triangleOrder, i, i + 1, cacheSize, &cacheTime, &time);
+					
+					if(i + 1 < end && (double) misses / (i + 1 - softStart) <= clusterACMR * threshold){
+						softClusters.push_back(i + 1);
+						softStart = i + 1;
+						misses = 0;
+						time += cacheSize + 1;
+					};
+				};
+			};
+			
+			//calculate mesh centroid
+			Vec4f meshCentroid(0.0f, 0.0f, 0.0f, 1.0f);
+			double meshArea = 0;
+			
+			for(int i = 0; i < triangleCount; i++){
+				Vec4f normal;
+				Vec4f centroid;
+				MeshOptimiser::getTriangleData(indices, positions, i, &normal, &centroid);
+				double area = Math::magnitude(normal);
+				
+				meshCentroid += Math::scalarProduct(area, centroid);
+				meshArea += area;
+			};
+			
+			if(meshArea > 0){
+				meshCentroid = Math::scalarProduct(1 / meshArea, meshCentroid);
+			};
+			
+			//calculate sort key for each cluster (how much its area-weighted normal points away from the mesh centroid)
+			std::vector<std::pair<double, int>> sortKeys(softClusters.size());
+			
+			for(int c = 0; c < softClusters.size(); c++){
+				int start = softClusters[c];
+				int end = c + 1 < softClusters.size() ? softClusters[c + 1] : triangleCount;
+				
+				Vec4f clusterNormal;
+				Vec4f clusterCentroid;
+				double clusterArea = 0;
+				
+				for(int i = start; i < end; i++){
+					Vec4f normal;
+					Vec4f centroid;
+					MeshOptimiser::getTriangleData(indices, positions, (*triangleOrder)[i], &normal, &centroid);
+					double area = Math::magnitude(normal);
+					
+					clusterNormal += normal;
+					clusterCentroid += Math::scalarProduct(area, centroid);
+					clusterArea += area;
+				};
+				
+				if(clusterArea > 0){
+					clusterCentroid = Math::scalarProduct(1 / clusterArea, clusterCentroid);
+				};
+				
+				double normalMagnitude = Math::magnitude(clusterNormal);
+				double key = 0;
+				
+				if(normalMagnitude > 0){
+					key = Math::dotProduct(clusterCentroid - meshCentroid, clusterNormal) / normalMagnitude;
+				};
+				
+				sortKeys[c] = std::make_pair(key, c);
+			};
+			
+			//sort clusters in descending order of key (stable so that clusters with equal keys keep their cache-friendly order)
+			std::stable_sort(sortKeys.begin(), sortKeys.end(), [](const std::pair<double, int> & a, const std::pair<double, int> & b){
+				return a.first > b.first;
+			});
+			
+			//rebuild triangle order
+			std::vector<unsigned int> newOrder;
+			newOrder.reserve(triangleCount);
+			
+			for(int c = 0; c < sortKeys.size(); c++){
+				int cluster = sortKeys[c].second;
+				int start = softClusters[cluster];
+				int end = cluster + 1 < softClusters.size() ? softClusters[cluster + 1] : triangleCount;
+				
+				newOrder.insert(newOrder.end(), triangleOrder->begin() + start, triangleOrder->begin() + end);
+			};
+			
+			*triangleOrder = newOrder;
+		};
+		
+		//vertex fetch optimisation
+		/*
+			Returns a remap table from old vertex index to new vertex index, with vertices numbered in the order they are first used.
+			Unused vertices are moved to the end.
+		*/
+		static void optimiseVertexFetch(std::vector<unsigned int> * indices, int vertexCount, std::vector<unsigned int> * remap){
+			remap->assign(vertexCount, (unsigned int) -1);
+			unsigned int nextVertex = 0;
+			
+			for(int i = 0; i < indices->size(); i++){
+				unsigned int & index = (*indices)[i];
+				
+				if((*remap)[index] == (unsigned int) -1){
+					(*remap)[index] = nextVertex;
+					nextVertex++;
+				};
+				
+				index = (*remap)[index];
+			};
+			
+			for(int i = 0; i < vertexCount; i++){
+				if((*remap)[i] == (unsigned int) -1){
+					(*remap)[i] = nextVertex;
+					nextVertex++;
+				};
+			};
+		};
+		
+		//optimise mesh
+		//reorders mesh->triangles (within each meshlet) for vertex cache efficiency and overdraw, and returns the ACMR before and after
+		//levels of detail are optimised as well
+		static MeshOptimisationStatistics optimiseMesh(Mesh * mesh){
+			//build index buffer
+			std::vector<Vertex> uniqueVertices;
+			std::vector<unsigned int> indices;
+			Mesh::buildIndexBuffer(mesh, &uniqueVertices, &indices);
+			
+			std::vector<Vec4f> positions(uniqueVertices.size());
+			for(int i = 0; i < uniqueVertices.size(); i++){
+				positions[i] = uniqueVertices[i].position;
+			};
+			
+			double acmrBefore = MeshOptimiser::calculateACMR(indices, uniqueVertices.size(), MESH_OPTIMISER_CACHE_SIZE);
+			
+			//optimise triangle order
+			std::vector<unsigned int> triangleOrder;
+			std::vector<unsigned int> clusters;
+			MeshOptimiser::optimiseVertexCache(indices, uniqueVertices.size(), MESH_OPTIMISER_CACHE_SIZE, &triangleOrder, &clusters);
+			MeshOptimiser::optimiseOverdraw(indices, positions, MESH_OPTIMISER_CACHE_SIZE, MESH_OPTIMISER_OVERDRAW_THRESHOLD, &triangleOrder, clusters);
+			
+			//keep the triangles of each meshlet together (in their optimised order), so meshlet and submesh ranges are unchanged
+			std::vector<int> triangleMeshlet(mesh->triangles.size());
+			for(int i = 0; i < mesh->meshlets.size(); i++){
+				for(int j = 0; j < mesh->meshlets[i].triangleCount; j++){
+					triangleMeshlet[mesh->meshlets[i].firstTriangle + j] = i;
+				};
+			};
+			
+			std::stable_sort(triangleOrder.begin(), triangleOrder.end(), [&triangleMeshlet](unsigned int a, unsigned int b){
+				return triangleMeshlet[a] < triangleMeshlet[b];
+			});
+			
+			//reorder triangles and indices
+			std::vector<Triangle> triangles(triangleOrder.size());
+			std::vector<unsigned int> newIndices(indices.size());
+			
+			for(int i = 0; i < triangleOrder.size(); i++){
+				triangles[i] = mesh->triangles[triangleOrder[i]];
+				
+				for(int j = 0; j < 3; j++){
+					newIndices[i * 3 + j] = indices[triangleOrder[i] * 3 + j];
+				};
+			};
+			
+			mesh->triangles = triangles;
+			Mesh::calculateFacePlanes(mesh);
+			
+			double acmrAfter = MeshOptimiser::calculateACMR(newIndices, uniqueVertices.size(), MESH_OPTIMISER_CACHE_SIZE);
+			
+			for(int i = 0; i < mesh->lods.size(); i++){
+				MeshOptimiser::optimiseMesh(&mesh->lods[i]);
+			};
+			
+			MeshOptimisationStatistics statistics;
+			statistics.triangleCount = triangles.size();
+			statistics.acmrBefore = acmrBefore;
+			statistics.acmrAfter = acmrAfter;
+			return statistics;
+		};
+		
+		//optimise quantized mesh vertex order
+		//triangles are drawn in index buffer order, so this should be run after the triangle order has been optimised
+		static void optimiseVertexFetch(QuantizedMesh * mesh){
+			std::vector<unsigned int> remap;
+			MeshOptimiser::optimiseVertexFetch(&mesh->indices, mesh->vertices.size(), &remap);
+			
+			std::vector<QuantizedVertex> vertices(mesh->vertices.size());
+			for(int i = 0; i < mesh->vertices.size(); i++){
+				vertices[remap[i]] = mesh->vertices[i];
+			};
+			
+			mesh->vertices = vertices;
+			mesh->calculateMeshletVertexRanges();
+			
+			for(int i = 0; i < mesh->lods.size(); i++){
+				MeshOptimiser::optimiseVertexFetch(&mesh->lods[i]);
+			};
+		};
+	
+	private:
+		//build vertex to triangle adjacency (the triangles of vertex v are adjacency[offsets[v]] to adjacency[offsets[v + 1] - 1])
+		static void buildAdjacency(const std::vector<unsigned int> & indices, int vertexCount, std::vector<unsigned int> * offsets, std::vector<unsigned int> * adjacency){
+			offsets->assign(vertexCount + 1, 0);
+			
+			for(int i = 0; i < indices.size(); i++){
+				(*offsets)[indices[i] + 1]++;
+			};
+			
+			for(int i = 0; i < vertexCount; i++){
+				(*offsets)[i + 1] += (*offsets)[i];
+			};
+			
+			adjacency->resize(indices.size());
+			std::vector<unsigned int> fill(offsets->begin(), offsets->end() - 1);
+			
+			for(int i = 0; i < indices.size(); i++){
+				(*adjacency)[fill[indices[i]]] = i / 3;
+				fill[indices[i]]++;
+			};
+		};
+		
+		//count cache misses for a range of the triangle order
+		static int countCacheMisses(const std::vector<unsigned int> & indices, const std::vector<unsigned int> & triangleOrder, int start, int end, int cacheSize, std::vector<int> * cacheTime, int * time){
+			int misses = 0;
+			
+			for(int i = start; i < end; i++){
+				for(int j = 0; j < 3; j++){
+					unsigned int v = indices[triangleOrder[i] * 3 + j];
+					
+					if(*time - (*cacheTime)[v] > cacheSize){
+						(*cacheTime)[v] = *time;
+						(*time)++;
+						misses++;
+					};
+				};
+			};
+			
+			return misses;
+		};
+		
+		//get triangle normal (with magnitude proportional to area) and centroid
+		static void getTriangleData(const std::vector<unsigned int> & indices, const std::vector<Vec4f> & positions, int triangle, Vec4f * normal, Vec4f * centroid){
+			Vec4f p0 = positions[indices[triangle * 3]];
+			Vec4f p1 = positions[indices[triangle * 3 + 1]];
+			Vec4f p2 = positions[indices[triangle * 3 + 2]];
+			
+			*normal = Math::crossProduct(p1 - p0, p2 - p0);
+			*centroid = Vec4f((p0.x + p1.x + p2.x) / 3, (p0.y + p1.y + p2.y) / 3, (p0.z + p1.z + p2.z) / 3, 1.0f);
+		};
+};
+
+#endif
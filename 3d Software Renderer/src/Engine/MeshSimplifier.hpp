@@ -0,0 +1,450 @@
+//MeshSimplifier.hpp
+
+#ifndef MESH_SIMPLIFIER_HPP
+#define MESH_SIMPLIFIER_HPP
+
+#include <vector>
+#include <queue>
+#include <unordered_map>
+#include "Mathematics.hpp"
+#include "Mesh.hpp"
+
+/*
+	Notes about mesh simplification:
+	A mesh is simplified by repeatedly collapsing an edge - moving one of its vertices onto the other, which removes the (usually two)
+	triangles that shared the edge. The edge collapsed next is the one that changes the shape of the mesh least, measured with quadric
+	error metrics (Garland and Heckbert 1997):
+	
+	The squared distance from a point p = (x, y, z, 1) to a plane n.p + d = 0 is (n.p + d)^2, which can be written as p^T Q p for the
+	symmetric 4x4 matrix Q = (n, d)(n, d)^T. Each vertex starts with the sum of the quadrics of its triangles' planes (weighted by area),
+	so its error is zero where it is and grows as it moves away from those planes. When u is collapsed onto v, v's quadric becomes the
+	sum of both, so the error of later collapses includes the shape already lost.
+	
+	Details:
+	- vertices are welded by position, and each triangle corner keeps its own texture coordinate, normal and colour, so texture seams
+	  do not stop collapses (the texture may stretch slightly, which is not noticeable at the distance a simplified mesh is drawn)
+	- a vertex is only ever moved onto another vertex, so no new positions are made
+	- edges on the border of an open mesh are given an extra quadric for the plane through the edge at right angles to its triangle,
+	  so borders keep their outline
+	- a collapse is rejected if it would turn a triangle over, or would join two parts of the mesh that only touch along the edge
+	
+	Levels of detail:
+	generateLods adds a chain of simplified meshes to mesh->lods, each with about half the triangles of the one before. The renderer
+	draws a simpler level as a model gets smaller on screen (see Renderer::selectLod).
+*/
+
+//number of levels of detail generated (as well as the full mesh)
+#define MESH_SIMPLIFIER_LOD_COUNT 3
+
+//fraction of the previous level's triangles kept by each level of detail
+#define MESH_SIMPLIFIER_LOD_RATIO 0.5
+
+//border quadrics are weighted by this, so border vertices are only moved along the border
+#define MESH_SIMPLIFIER_BORDER_WEIGHT 10.0
+
+//quadric (the ten unique values of the symmetric matrix)
+struct Quadric {
+	double xx, xy, xz, xw, yy, yz, yw, zz, zw, ww;
+};
+
+//edge collapse (moves vertex "from" onto vertex "to")
+struct EdgeCollapse {
+	double error;
+	int from;
+	int to;
+	int fromVersion;
+	int toVersion;
+	
+	//collapses with the lowest error come first in a priority queue
+	bool operator<(const EdgeCollapse & collapse) const {
+		return this->error > collapse.error;
+	};
+};
+
+//declare class
+class MeshSimplifier {
+	public:
+		//generate levels of detail
+		//replaces mesh->lods with MESH_SIMPLIFIER_LOD_COUNT simplified meshes, each simplified from the one before (levels are left out if the mesh cannot be simplified further)
+		static void generateLods(Mesh * mesh){
+			mesh->lods.clear();
+			mesh->lods.reserve(MESH_SIMPLIFIER_LOD_COUNT);
+			
+			for(int i = 0; i < MESH_SIMPLIFIER_LOD_COUNT; i++){
+				Mesh * previous = i == 0 ? mesh : &mesh->lods[i - 1];
+				int targetTriangleCount = previous->triangles.size() * MESH_SIMPLIFIER_LOD_RATIO;
+				
+				Mesh lod;
+				MeshSimplifier::simplifyMesh(previous, &lod, targetTriangleCount);
+				
+				//stop if the mesh could not be simplified much further (e.g. every edge left is on a border)
+				if(lod.triangles.size() == 0 || lod.triangles.size() > previous->triangles.size() * (1 + MESH_SIMPLIFIER_LOD_RATIO) / 2){
+					break;
+				};
+				
+				mesh->lods.push_back(lod);
+			};
+		};
+		
+		//simplify mesh
+		//writes a copy of mesh to simplified with edges collapsed until it has at most targetTriangleCount triangles (or no more edges can be collapsed)
+		static void simplifyMesh(Mesh * mesh, Mesh * simplified, int targetTriangleCount){
+			int triangleCount = mesh->triangles.size();
+			
+			//weld vertices by position
+			std::unordered_map<std::string, int> positionMap;
+			std::vector<Vec4f> positions;
+			std::vector<int> corners(triangleCount * 3);
+			
+			for(int i = 0; i < triangleCount; i++){
+				for(int j = 0; j < 3; j++){
+					Vec4f & position = mesh->triangles[i].vertices[j].position;
+					std::string key((const char *) &position, sizeof(Vec4f));
+					
+					auto result = positionMap.emplace(key, (int) positions.size());
+					if(result.second){
+						positions.push_back(position);
+					};
+					
+					corners[i * 3 + j] = result.first->second;
+				};
+			};
+			
+			int vertexCount = positions.size();
+			
+			//find the triangles of each vertex
+			std::vector<std::vector<int>> vertexTriangles(vertexCount);
+			for(int i = 0; i < triangleCount * 3; i++){
+				vertexTriangles[corners[i]].push_back(i / 3);
+			};
+			
+			//add the quadrics of the triangle planes
+			std::vector<Quadric> quadrics(vertexCount, Quadric{0, 0, 0, 0, 0, 0, 0, 0, 0, 0});
+			
+			for(int i = 0; i < triangleCount; i++){
+				Vec4f normal = Math::crossProduct(positions[corners[i * 3 + 1]] - positions[corners[i * 3]], positions[corners[i * 3 + 2]] - positions[corners[i * 3]]);
+				double length = Math::magnitude(normal);
+				
+				if(length == 0){
+					continue;
+				};
+				
+				normal = Math::scalarProduct(1.0f / length, normal);
+				Quadric quadric = MeshSimplifier::createPlaneQuadric(normal, -Math::dotProduct(normal, positions[corners[i * 3]]), length / 2);
+				
+				for(int j = 0; j < 3; j++){
+					MeshSimplifier::addQuadric(&quadrics[corners[i * 3 + j]], quadric);
+				};
+			};
+			
+			//count the triangles of each edge (keyed by its vertices, lowest first)
+			std::unordered_map<long long, int> edgeTriangleCounts;
+			for(int i = 0; i < triangleCount; i++){
+				for(int j = 0; j < 3; j++){
+					edgeTriangleCounts[MeshSimplifier::getEdgeKey(corners[i * 3 + j], corners[i * 3 + (j + 1) % 3], vertexCount)]++;
+				};
+			};
+			
+			//add border quadrics
+			for(int i = 0; i < triangleCount; i++){
+				Vec4f faceNormal = Math::crossProduct(positions[corners[i * 3 + 1]] - positions[corners[i * 3]], positions[corners[i * 3 + 2]] - positions[corners[i * 3]]);
+				
+				for(int j = 0; j < 3; j++){
+					int a = corners[i * 3 + j];
+					int b = corners[i * 3 + (j + 1) % 3];
+					
+					if(edgeTriangleCounts[MeshSimplifier::getEdgeKey(a, b, vertexCount)] != 1){
+						continue;
+					};
+					
+					Vec4f edge = positions[b] - positions[a];
+					Vec4f normal = Math::crossProduct(edge, faceNormal);
+					double length = Math::magnitude(normal);
+					
+					if(length == 0){
+						continue;
+					};
+					
+					normal = Math::scalarProduct(1.0f / length, normal);
+					double edgeLength = Math::magnitude(edge);
+					Quadric quadric = MeshSimplifier::createPlaneQuadric(normal, -Math::dotProduct(normal, positions[a]), MESH_SIMPLIFIER_BORDER_WEIGHT * edgeLength * edgeLength);
+					
+					MeshSimplifier::addQuadric(&quadrics[a], quadric);
+					MeshSimplifier::addQuadric(&quadrics[b], quadric);
+				};
+			};
+			
+			//queue a collapse in each direction of every edge
+			std::vector<int> versions(vertexCount, 0);
+			std::priority_queue<EdgeCollapse> collapses;
+			
+			for(auto & edge : edgeTriangleCounts){
+				int a = edge.first / vertexCount;
+				int b = edge.first % vertexCount;
+				
+				collapses.push(MeshSimplifier::createCollapse(a, b, positions, quadrics, versions));
+				collapses.push(MeshSimplifier::createCollapse(b, a, positions, quadrics, versions));
+			};
+			
+			//collapse edges, lowest error first
+			std::vector<bool> removedTriangles(triangleCount, false);
+			std::vector<bool> removedVertices(vertexCount, false);
+			std::vector<int> neighbourMarks(vertexCount, 0);
+			int mark = 0;
+			std::vector<int> neighbours;
+			int remainingTriangles = triangleCount;
+			
+			while(remainingTriangles > targetTriangleCount && collapses.size() > 0){
+				EdgeCollapse collapse = collapses.top();
+				collapses.pop();
+				
+				//skip collapses that are out of date (a vertex has been removed, or its quadric or neighbours have changed since it was queued)
+				if(removedVertices[collapse.from] || removedVertices[collapse.to] || versions[collapse.from] != collapse.fromVersion || versions[collapse.to] != collapse.toVersion){
+					continue;
+				};
+				
+				mark++;
+				if(!MeshSimplifier::canCollapse(collapse.from, collapse.to, positions, corners, vertexTriangles, removedTriangles, &neighbourMarks, mark)){
+					continue;
+				};
+				
+				//remove the triangles of the edge, and move the other triangles of "from" onto "to"
+				for(int i = 0; i < vertexTriangles[collapse.from].size(); i++){
+					int triangle = vertexTriangles[collapse.from][i];
+					
+					if(removedTriangles[triangle]){
+						continue;
+					};
+					
+					int * triangleCorners = &corners[triangle * 3];
+					
+					if(triangleCorners[0] == collapse.to || triangleCorners[1] == collapse.to || triangleCorners[2] == collapse.to){
+						removedTriangles[triangle] = true;
+						remainingTriangles--;
+						continue;
+					};
+					
+					for(int j = 0; j < 3; j++){
+						if(triangleCorners[j] == collapse.from){
+							triangleCorners[j] = collapse.to;
+						};
+					};
+					
+					vertexTriangles[collapse.to].push_back(triangle);
+				};
+				
+				removedVertices[collapse.from] = true;
+				vertexTriangles[collapse.from].clear();
+				MeshSimplifier::addQuadric(&quadrics[collapse.to], quadrics[collapse.from]);
+				
+				//drop removed triangles from the list of "to"
+				std::vector<int> & toTriangles = vertexTriangles[collapse.to];
+				int kept = 0;
+				for(int i = 0; i < toTriangles.size(); i++){
+					if(!removedTriangles[toTriangles[i]]){
+						toTriangles[kept] = toTriangles[i];
+						kept++;
+					};
+				};
+				toTriangles.resize(kept);
+				
+				//requeue the edges around "to", whose error has changed
+				versions[collapse.to]++;
+				mark++;
+				MeshSimplifier::findNeighbours(collapse.to, corners, vertexTriangles, removedTriangles, &neighbourMarks, mark, &neighbours);
+				
+				for(int i = 0; i < neighbours.size(); i++){
+					collapses.push(MeshSimplifier::createCollapse(collapse.to, neighbours[i], positions, quadrics, versions));
+					collapses.push(MeshSimplifier::createCollapse(neighbours[i], collapse.to, positions, quadrics, versions));
+				};
+			};
+			
+			//find the submesh of each triangle
+			std::vector<int> triangleSubmesh(triangleCount, 0);
+			for(int i = 0; i < mesh->submeshes.size(); i++){
+				for(int j = 0; j < mesh->submeshes[i].triangleCount; j++){
+					triangleSubmesh[mesh->submeshes[i].firstTriangle + j] = i;
+				};
+			};
+			
+			//copy the remaining triangles (in their original order, so submeshes stay contiguous), with the corners moved to their new positions
+			simplified->vertices.clear();
+			simplified->textureCoords.clear();
+			simplified->normals.clear();
+			simplified->triangles.clear();
+			simplified->submeshes.clear();
+			simplified->lods.clear();
+			
+			for(int i = 0; i < triangleCount; i++){
+				if(removedTriangles[i]){
+					continue;
+				};
+				
+				//start a submesh at its first remaining triangle
+				while(simplified->submeshes.size() <= triangleSubmesh[i]){
+					Submesh submesh;
+					submesh.name = mesh->submeshes[simplified->submeshes.size()].name;
+					submesh.firstTriangle = simplified->triangles.size();
+					simplified->submeshes.push_back(submesh);
+				};
+				
+				Triangle triangle = mesh->triangles[i];
+				for(int j = 0; j < 3; j++){
+					triangle.vertices[j].position = positions[corners[i * 3 + j]];
+				};
+				
+				simplified->triangles.push_back(triangle);
+			};
+			
+			Mesh::prepareMesh(simplified);
+		};
+	
+	private:
+		//check if edge can be collapsed
+		//neighbourMarks must not contain mark (or 0) before the call
+		static bool canCollapse(int from, int to, const std::vector<Vec4f> & positions, const std::vector<int> & corners, const std::vector<std::vector<int>> & vertexTriangles, const std::vector<bool> & removedTriangles, std::vector<int> * neighbourMarks, int mark){
+			//count the triangles of the edge, and mark the neighbours of "from"
+			int edgeTriangles = 0;
+			
+			for(int i = 0; i < vertexTriangles[from].size(); i++){
+				int triangle = vertexTriangles[from][i];
+				
+				if(removedTriangles[triangle]){
+					continue;
+				};
+				
+				const int * triangleCorners = &corners[triangle * 3];
+				bool hasTo = triangleCorners[0] == to || triangleCorners[1] == to || triangleCorners[2] == to;
+				
+				if(hasTo){
+					edgeTriangles++;
+				} else {
+					//the triangle must not be turned over when "from" is moved onto "to"
+					Vec4f p0 = positions[triangleCorners[0]];
+					Vec4f p1 = positions[triangleCorners[1]];
+					Vec4f p2 = positions[triangleCorners[2]];
+					
+					Vec4f oldNormal = Math::crossProduct(p1 - p0, p2 - p0);
+					Vec4f moved[3];
+					
+					for(int j = 0; j < 3; j++){
+						moved[j] = triangleCorners[j] == from ? positions[to] : positions[triangleCorners[j]];
+					};
+					
+					Vec4f newNormal = Math::crossProduct(moved[1] - moved[0], moved[2] - moved[0]);
+					
+					if(Math::dotProduct(oldNormal, newNormal) <= 0){
+						return false;
+					};
+				};
+				
+				for(int j = 0; j < 3; j++){
+					(*neighbourMarks)[triangleCorners[j]] = mark;
+				};
+			};
+			
+			//the edge no longer exists
+			if(edgeTriangles == 0){
+				return false;
+			};
+			
+			//each triangle of the edge has one vertex that is a neighbour of both ends - any other shared neighbour means the collapse would join separate parts of the mesh
+			int sharedNeighbours = 0;
+			
+			for(int i = 0; i < vertexTriangles[to].size(); i++){
+				int triangle = vertexTriangles[to][i];
+				
+				if(removedTriangles[triangle]){
+					continue;
+				};
+				
+				for(int j = 0; j < 3; j++){
+					int vertex = corners[triangle * 3 + j];
+					
+					if(vertex != from && vertex != to && (*neighbourMarks)[vertex] == mark){
+						(*neighbourMarks)[vertex] = 0;
+						sharedNeighbours++;
+					};
+				};
+			};
+			
+			return sharedNeighbours <= edgeTriangles;
+		};
+		
+		//find neighbours of vertex
+		//neighbourMarks must not contain mark before the call
+		static void findNeighbours(int vertex, const std::vector<int> & corners, const std::vector<std::vector<int>> & vertexTriangles, const std::vector<bool> & removedTriangles, std::vector<int> * neighbourMarks, int mark, std::vector<int> * neighbours){
+			neighbours->clear();
+			
+			for(int i = 0; i < vertexTriangles[vertex].size(); i++){
+				int triangle = vertexTriangles[vertex][i];
+				
+				if(removedTriangles[triangle]){
+					continue;
+				};
+				
+				for(int j = 0; j < 3; j++){
+					int neighbour = corners[triangle * 3 + j];
+					
+					if(neighbour != vertex && (*neighbourMarks)[neighbour] != mark){
+						(*neighbourMarks)[neighbour] = mark;
+						neighbours->push_back(neighbour);
+					};
+				};
+			};
+		};
+		
+		//create collapse
+		static EdgeCollapse createCollapse(int from, int to, const std::vector<Vec4f> & positions, const std::vector<Quadric> & quadrics, const std::vector<int> & versions){
+			Quadric quadric = quadrics[from];
+			MeshSimplifier::addQuadric(&quadric, quadrics[to]);
+			
+			EdgeCollapse collapse;
+			collapse.error = MeshSimplifier::evaluateQuadric(quadric, positions[to]);
+			collapse.from = from;
+			collapse.to = to;
+			collapse.fromVersion = versions[from];
+			collapse.toVersion = versions[to];
+			return collapse;
+		};
+		
+		//create plane quadric
+		static Quadric createPlaneQuadric(Vec4f normal, double distance, double weight){
+			double a = normal.x;
+			double b = normal.y;
+			double c = normal.z;
+			double d = distance;
+			
+			return Quadric{weight * a * a, weight * a * b, weight * a * c, weight * a * d, weight * b * b, weight * b * c, weight * b * d, weight * c * c, weight * c * d, weight * d * d};
+		};
+		
+		//add quadric
+		static void addQuadric(Quadric * quadric, const Quadric & other){
+			quadric->xx += other.xx;
+			quadric->xy += other.xy;
+			quadric->xz += other.xz;
+			quadric->xw += other.xw;
+			quadric->yy += other.yy;
+			quadric->yz += other.yz;
+			quadric->yw += other.yw;
+			quadric->zz += other.zz;
+			quadric->zw += other.zw;
+			quadric->ww += other.ww;
+		};
+		
+		//evaluate quadric (p^T Q p, with w = 1)
+		static double evaluateQuadric(const Quadric & q, Vec4f p){
+			double x = p.x;
+			double y = p.y;
+			double z = p.z;
+			
+			return q.xx * x * x + 2 * q.xy * x * y + 2 * q.xz * x * z + 2 * q.xw * x + q.yy * y * y + 2 * q.yz * y * z + 2 * q.yw * y + q.zz * z * z + 2 * q.zw * z + q.ww;
+		};
+		
+		//get edge key (the same for both directions)
+		static long long getEdgeKey(int a, int b, int vertexCount){
+			return a < b ? (long long) a * vertexCount + b : (long long) b * vertexCount + a;
+		};
+};
+
+#endif
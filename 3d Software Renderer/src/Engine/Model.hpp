@@ -4,30 +4,66 @@
 #define MODEL_HPP
 
 #include "Mesh.hpp"
+#include "QuantizedMesh.hpp"
+#include "SceneNode.hpp"
+
+//baked lighting
+//the intensity the renderer's static lights give each corner of each triangle of one level of detail, and the versions of the static
+//lights and the model's world matrix it was baked with (see notes on static lighting)
+struct BakedLighting {
+	std::vector<float> intensities;
+	int lightingVersion = -1;
+	int worldVersion = -1;
+};
 
 //mesh
-class Model {
+//the model's transform is set through its scene node, and it can be attached to another model (see notes on the transform hierarchy)
+class Model : public SceneNode {
 	public:
 		//properties
 		Mesh * mesh;
-		Vec4f enlargement;
-		Vec4f rotation;
-		Vec4f translation;
+		QuantizedMesh * quantizedMesh = nullptr; //if set, the model is drawn from the quantized mesh instead of the mesh triangles
+		int lod = 0; //level of detail drawn last frame (0 is the full mesh), kept so that the renderer can avoid switching back and forth
+		bool occluder = false; //if set, the model is always drawn into the occlusion buffer when it is in view (see notes on occlusion culling)
+		Mesh * occluderMesh = nullptr; //if set, this is drawn into the occlusion buffer instead of the mesh (it must fit inside the mesh, e.g. a simple box inside a wall)
+		bool staticLighting = false; //if set, the renderer's static lights are baked into the model's vertices rather than lit every frame (see notes on static lighting)
+		std::vector<BakedLighting> bakedLighting; //one per level of detail, baked the first time it is drawn
 		
 		//constructor
-		Model(Mesh * mesh){
+		Model(Mesh * mesh) : SceneNode(Vec4f(0.0f, 0.0f, 0.0f, 0.0f), Vec4f(0.0f, 0.0f, 0.0f, 0.0f), Vec4f(0.0f, 0.0f, 0.0f, 1.0f)) {
 			this->mesh = mesh;
-			this->enlargement = Vec4f(0.0f, 0.0f, 0.0f, 0.0f);
-			this->rotation = Vec4f(0.0f, 0.0f, 0.0f, 0.0f);
-			this->translation = Vec4f(0.0f, 0.0f, 0.0f, 1.0f);
 		};
 		
-		Model(Mesh * mesh, Vec4f enlargement, Vec4f rotation, Vec4f translation){
+		Model(Mesh * mesh, Vec4f enlargement, Vec4f rotation, Vec4f translation) : SceneNode(enlargement, rotation, translation) {
 			this->mesh = mesh;
-			this->enlargement = enlargement;
-			this->rotation = rotation;
-			this->translation = translation;
 		};
+		
+		//get transformation matrix (model space to world space)
+		Mat4x4f getTransformationMatrix(){
+			return this->getWorldMatrix();
+		};
+};
+
+//instance transform
+//one copy of a mesh drawn by Renderer::drawInstanced, with its transform already calculated (so it is not rebuilt when drawing)
+struct InstanceTransform {
+	Mat4x4f transform; //model space to world space
+	double scale; //largest scale of the transform, for scaling the mesh's bounding sphere
+	
+	InstanceTransform(Vec4f enlargement, Vec4f rotation, Vec4f translation){
+		this->transform = SceneNode::calculateTransformationMatrix(enlargement, rotation, translation);
+		this->scale = fmax(fabs(enlargement.x), fmax(fabs(enlargement.y), fabs(enlargement.z)));
+	};
+	
+	InstanceTransform(Mat4x4f transform){
+		this->transform = transform;
+		this->scale = 0;
+		
+		//largest scale is the length of the longest column of the rotation and scale part of the matrix
+		for(int i = 0; i < 3; i++){
+			this->scale = fmax(this->scale, Math::magnitude(Vec4f(transform.data[0][i], transform.data[1][i], transform.data[2][i], 0.0f)));
+		};
+	};
 };
 
 #endif
\ No newline at end of file
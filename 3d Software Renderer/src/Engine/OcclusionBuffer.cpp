@@ -0,0 +1,144 @@
+//OcclusionBuffer.cpp
+
+#include "OcclusionBuffer.hpp"
+
+//constructor
+OcclusionBuffer::OcclusionBuffer(){
+	this->depth.resize(OCCLUSION_BUFFER_WIDTH * OCCLUSION_BUFFER_HEIGHT, 0.0f);
+	this->tanHalfFov = 1;
+	this->aspectRatio = 1;
+	this->nearDistance = 1;
+	this->occluderTriangleCount = 0;
+};
+
+//clear
+void OcclusionBuffer::clear(double tanHalfFov, double aspectRatio, double nearDistance){
+	this->tanHalfFov = tanHalfFov;
+	this->aspectRatio = aspectRatio;
+	this->nearDistance = nearDistance;
+	this->occluderTriangleCount = 0;
+	
+	std::fill(this->depth.begin(), this->depth.end(), 0.0f);
+};
+
+//draw occluder
+void OcclusionBuffer::drawOccluder(Mesh * mesh, Mat4x4f modelViewTransform){
+	for(int i = 0; i < mesh->triangles.size(); i++){
+		Triangle & t = mesh->triangles[i];
+		
+		Vec4f v0 = Math::matrixProduct(modelViewTransform, t.vertices[0].position);
+		Vec4f v1 = Math::matrixProduct(modelViewTransform, t.vertices[1].position);
+		Vec4f v2 = Math::matrixProduct(modelViewTransform, t.vertices[2].position);
+		
+		//skip back faces (the same test as Renderer::cullBackFace) - the front faces of a closed mesh cover the same pixels, and are nearer
+		if(Math::dotProduct(Math::crossProduct(v1 - v0, v2 - v0), v0) >= 0){
+			continue;
+		};
+		
+		this->drawTriangle(v0, v1, v2);
+	};
+};
+
+//draw triangle
+//only pixels the triangle covers completely are drawn, with the furthest depth of the triangle within each one (see notes on the depth rasteriser)
+void OcclusionBuffer::drawTriangle(Vec4f v0, Vec4f v1, Vec4f v2){
+	//project vertices (triangles crossing the near plane are not drawn)
+	float x[3];
+	float y[3];
+	float w[3];
+	
+	if(!this->projectPoint(v0, &x[0], &y[0], &w[0]) || !this->projectPoint(v1, &x[1], &y[1], &w[1]) || !this->projectPoint(v2, &x[2], &y[2], &w[2])){
+		return;
+	};
+	
+	//move the depths back, so rounding cannot hide a surface behind itself
+	for(int i = 0; i < 3; i++){
+		w[i] *= 1.0f - OCCLUSION_BUFFER_DEPTH_BIAS;
+	};
+	
+	DepthTarget target;
+	target.depth = &this->depth[0];
+	target.width = OCCLUSION_BUFFER_WIDTH;
+	target.height = OCCLUSION_BUFFER_HEIGHT;
+	target.coverage = FULL_PIXEL_COVERAGE;
+	target.depthTest = GREATER_DEPTH_TEST;
+	target.tileMask = nullptr;
+	target.tileSize = 0;
+	target.tileCount = 0;
+	
+	if(DepthRasteriser::drawTriangle(&target, x, y, w)){
+		this->occluderTriangleCount++;
+	};
+};
+
+//check if box may be visible
+bool OcclusionBuffer::isBoxVisible(Vec4f min, Vec4f max, Mat4x4f modelViewTransform){
+	//project corners, finding the rectangle they cover and the depth of the nearest one
+	float minX = OCCLUSION_BUFFER_WIDTH;
+	float maxX = 0;
+	float minY = OCCLUSION_BUFFER_HEIGHT;
+	float maxY = 0;
+	float nearestDepth = 0;
+	
+	for(int i = 0; i < 8; i++){
+		Vec4f corner(i & 1 ? max.x : min.x, i & 2 ? max.y : min.y, i & 4 ? max.z : min.z, 1.0f);
+		
+		float x;
+		float y;
+		float w;
+		
+		//a box crossing the near plane is always visible
+		if(!this->projectPoint(Math::matrixProduct(modelViewTransform, corner), &x, &y, &w)){
+			return true;
+		};
+		
+		minX = std::min(minX, x);
+		maxX = std::max(maxX, x);
+		minY = std::min(minY, y);
+		maxY = std::max(maxY, y);
+		nearestDepth = std::max(nearestDepth, w);
+	};
+	
+	//clip rectangle to the buffer (a box entirely off screen cannot be seen)
+	int startX = std::max(0, (int) floor(minX));
+	int endX = std::min(OCCLUSION_BUFFER_WIDTH - 1, (int) floor(maxX));
+	int startY = std::max(0, (int) floor(minY));
+	int endY = std::min(OCCLUSION_BUFFER_HEIGHT - 1, (int) floor(maxY));
+	
+	if(startX > endX || startY > endY){
+		return false;
+	};
+	
+	//the box is visible if any pixel has no occluder in front of its nearest corner
+	//pixels are tested in groups of four, so a few pixels to either side of the rectangle are tested as well, which is still conservative
+	__m128 nearestDepthVector = _mm_set1_ps(nearestDepth);
+	
+	for(int py = startY; py <= endY; py++){
+		float * row = &this->depth[py * OCCLUSION_BUFFER_WIDTH];
+		
+		for(int px = startX & ~3; px <= endX; px += 4){
+			if(_mm_movemask_ps(_mm_cmple_ps(_mm_loadu_ps(row + px), nearestDepthVector)) != 0){
+				return true;
+			};
+		};
+	};
+	
+	return false;
+};
+
+//get occluder triangle count (triangles drawn since the buffer was cleared)
+int OcclusionBuffer::getOccluderTriangleCount(){
+	return this->occluderTriangleCount;
+};
+
+//project point
+bool OcclusionBuffer::projectPoint(Vec4f point, float * x, float * y, float * inverseDepth){
+	if(point.z <= this->nearDistance){
+		return false;
+	};
+	
+	*x = (point.x / (point.z * this->tanHalfFov) + 1) * 0.5f * OCCLUSION_BUFFER_WIDTH;
+	*y = (1 - point.y * this->aspectRatio / (point.z * this->tanHalfFov)) * 0.5f * OCCLUSION_BUFFER_HEIGHT;
+	*inverseDepth = 1.0f / point.z;
+	return true;
+};
@@ -0,0 +1,73 @@
+//OcclusionBuffer.hpp
+
+#ifndef OCCLUSION_BUFFER_HPP
+#define OCCLUSION_BUFFER_HPP
+
+#include <vector>
+#include <algorithm>
+#include <math.h>
+#include <emmintrin.h>
+#include "Mathematics.hpp"
+#include "Mesh.hpp"
+#include "DepthRasteriser.hpp"
+
+/*
+	Notes about occlusion culling:
+	Frustum culling keeps everything in front of the camera, including rooms hidden behind walls. The occlusion buffer is a small depth
+	buffer that a few large models (occluders) are drawn into before anything else. The bounding box of a model or meshlet can then be
+	tested against it: if every pixel the box covers already has an occluder in front of the nearest point of the box, the box is hidden
+	and nothing in it needs to be drawn.
+	
+	The test must never hide something that can be seen, so both sides are conservative:
+	- occluders only cover pixels that they cover completely, and each pixel stores the furthest depth of the occluder within that pixel
+	- boxes cover every pixel their projection touches, and are tested with the depth of their nearest corner
+	Triangles and boxes that cross the near plane are not drawn as occluders, and are always visible.
+	
+	The buffer stores 1 / z for each pixel (0 where there is no occluder), which is linear across the screen, so it can be interpolated
+	across a triangle. Occluders are drawn with the depth rasteriser (see notes on the depth rasteriser), and boxes are tested four pixels
+	at a time with SSE.
+*/
+
+//occlusion buffer size (width must be a multiple of 4)
+#define OCCLUSION_BUFFER_WIDTH 256
+#define OCCLUSION_BUFFER_HEIGHT 128
+
+//occluder depths are moved back by this fraction, so rounding cannot hide a surface behind itself
+#define OCCLUSION_BUFFER_DEPTH_BIAS 0.0001
+
+//declare class
+class OcclusionBuffer {
+	public:
+		//constructor
+		OcclusionBuffer();
+		
+		//clear buffer and set the projection used for the frame
+		void clear(double tanHalfFov, double aspectRatio, double nearDistance);
+		
+		//draw occluder
+		//modelViewTransform maps the mesh to view space, and back-facing triangles are skipped
+		void drawOccluder(Mesh * mesh, Mat4x4f modelViewTransform);
+		
+		//draw occluder triangle (vertices in view space)
+		void drawTriangle(Vec4f v0, Vec4f v1, Vec4f v2);
+		
+		//check if box may be visible
+		//the box is axis-aligned in the space that modelViewTransform maps to view space
+		bool isBoxVisible(Vec4f min, Vec4f max, Mat4x4f modelViewTransform);
+		
+		//getters
+		int getOccluderTriangleCount();
+	
+	private:
+		//project view space point to buffer coordinates, returns false if it is not in front of the near plane
+		bool projectPoint(Vec4f point, float * x, float * y, float * inverseDepth);
+		
+		//data members
+		std::vector<float> depth; //1 / z of the nearest occluder in each pixel
+		double tanHalfFov;
+		double aspectRatio;
+		double nearDistance;
+		int occluderTriangleCount;
+};
+
+#endif
@@ -0,0 +1,489 @@
+//PNGDecoder.hpp
+
+#ifndef PNG_DECODER_HPP
+#define PNG_DECODER_HPP
+
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <vector>
+
+/*
+	Notes about the .png file format:
+	A PNG file is an 8-byte signature followed by chunks. Each chunk is a 4-byte big-endian length, a 4-byte type, the data and a CRC.
+		IHDR - width, height, bit depth, colour type and interlace method
+		PLTE - palette (for colour type 3)
+		IDAT - image data (the data of all IDAT chunks is concatenated)
+		IEND - end of image
+	
+	The image data is a zlib stream (a 2-byte header followed by DEFLATE compressed data).
+	Each decompressed scanline starts with a filter type byte (None, Sub, Up, Average or Paeth), which predicts each byte from the bytes
+	to its left, above and above-left; the filter must be undone to get the pixel values.
+	
+	This decoder supports 8-bit greyscale, greyscale + alpha, RGB, RGBA and palette images without interlacing, which covers the
+	textures exported by common tools.
+*/
+
+//largest width or height accepted (larger images are rejected before anything is allocated for them)
+#define PNG_MAX_DIMENSION 16384
+
+//most bytes a byte of DEFLATE data can decompress to (a 258 byte match takes at least 2 bits), so an image that would need more
+//decompressed data than this allows cannot be valid
+#define PNG_MAX_INFLATE_RATIO 1032
+
+//declare class
+class PNGDecoder {
+	public:
+		//decode
+		//outputs the image as 8-bit RGBA, with the top row first
+		static bool decode(const uint8_t * data, size_t size, int * width, int * height, std::vector<uint8_t> * rgba){
+			static const uint8_t signature[8] = {137, 80, 78, 71, 13, 10, 26, 10};
+			
+			if(size < 8 || memcmp(data, signature, 8) != 0){
+				return false;
+			};
+			
+			//read chunks
+			std::vector<uint8_t> compressed;
+			uint8_t palette[256][4];
+			memset(palette, 255, sizeof(palette));
+			int bitDepth = 0;
+			int colourType = 0;
+			int interlace = 0;
+			size_t offset = 8;
+			
+			*width = 0;
+			*height = 0;
+			
+			while(offset + 12 <= size){
+				uint32_t length = PNGDecoder::readBigEndian(data + offset);
+				const uint8_t * type = data + offset + 4;
+				const uint8_t * chunk = data + offset + 8;
+				
+				if(length > size - offset - 12){
+					return false;
+				};
+				
+				if(memcmp(type, "IHDR", 4) == 0 && length >= 13){
+					*width = PNGDecoder::readBigEndian(chunk);
+					*height = PNGDecoder::readBigEndian(chunk + 4);
+					bitDepth = chunk[8];
+					colourType = chunk[9];
+					interlace = chunk[12];
+				} else if(memcmp(type, "PLTE", 4) == 0){
+					for(int i = 0; i < length / 3 && i < 256; i++){
+						palette[i][0] = chunk[i * 3];
+						palette[i][1] = chunk[i * 3 + 1];
+						palette[i][2] = chunk[i * 3 + 2];
+					};
+				} else if(memcmp(type, "tRNS", 4) == 0 && colourType == 3){
+					for(int i = 0; i < length && i < 256; i++){
+						palette[i][3] = chunk[i];
+					};
+				} else if(memcmp(type, "IDAT", 4) == 0){
+					compressed.insert(compressed.end(), chunk, chunk + length);
+				} else if(memcmp(type, "IEND", 4) == 0){
+					break;
+				};
+				
+				offset += length + 12;
+			};
+			
+			//check format is supported
+			int channels;
+			switch(colourType){
+				case 0: channels = 1; break; //greyscale
+				case 2: channels = 3; break; //RGB
+				case 3: channels = 1; break; //palette
+				case 4: channels = 2; break; //greyscale + alpha
+				case 6: channels = 4; break; //RGBA
+				default: return false;
+			};
+			
+			if(bitDepth != 8 || interlace != 0 || *width <= 0 || *height <= 0 || compressed.size() < 2){
+				return false;
+			};
+			
+			//check the size of the image, so a corrupt or malicious header cannot make it allocate a huge buffer
+			//(the dimensions are capped first, so the sizes below cannot overflow)
+			if(*width > PNG_MAX_DIMENSION || *height > PNG_MAX_DIMENSION){
+				return false;
+			};
+			
+			size_t stride = (size_t) *width * channels;
+			size_t filteredSize = (stride + 1) * *height;
+			
+			if(filteredSize / PNG_MAX_INFLATE_RATIO > compressed.size()){
+				return false;
+			};
+			
+			//decompress (skipping the 2-byte zlib header)
+			std::vector<uint8_t> filtered;
+			filtered.reserve(filteredSize);
+			
+			if(!PNGDecoder::inflate(compressed.data() + 2, compressed.size() - 2, &filtered) || filtered.size() < filteredSize){
+				return false;
+			};
+			
+			//undo filters in place
+			std::vector<uint8_t> previousRow(stride, 0);
+			
+			for(int y = 0; y < *height; y++){
+				uint8_t filter = filtered[y * (stride + 1)];
+				uint8_t * row = &filtered[y * (stride + 1) + 1];
+				const uint8_t * above = y > 0 ? row - (stride + 1) : previousRow.data();
+				
+				if(!PNGDecoder::unfilterRow(filter, row, above, stride, channels)){
+					return false;
+				};
+			};
+			
+			//convert to RGBA
+			rgba->resize((size_t) *width * *height * 4);
+			uint8_t * output = rgba->data();
+			
+			for(int y = 0; y < *height; y++){
+				const uint8_t * row = &filtered[y * (stride + 1) + 1];
+				
+				for(int x = 0; x < *width; x++){
+					switch(colourType){
+						case 0:
+							output[0] = output[1] = output[2] = row[x];
+							output[3] = 255;
+							break;
+						case 2:
+							output[0] = row[x * 3];
+							output[1] = row[x * 3 + 1];
+							output[2] = row[x * 3 + 2];
+							output[3] = 255;
+							break;
+						case 3:
+							memcpy(output, palette[row[x]], 4);
+							break;
+						case 4:
+							output[0] = output[1] = output[2] = row[x * 2];
+							output[3] = row[x * 2 + 1];
+							break;
+						case 6:
+							memcpy(output, row + x * 4, 4);
+							break;
+					};
+					
+					output += 4;
+				};
+			};
+			
+			return true;
+		};
+	
+	private:
+		//read 32-bit big-endian integer
+		static uint32_t readBigEndian(const uint8_t * data){
+			return ((uint32_t) data[0] << 24) | ((uint32_t) data[1] << 16) | ((uint32_t) data[2] << 8) | data[3];
+		};
+		
+		//undo the filter of a row
+		static bool unfilterRow(uint8_t filter, uint8_t * row, const uint8_t * above, size_t stride, int bytesPerPixel){
+			switch(filter){
+				case 0: //none
+					break;
+				case 1: //sub
+					for(size_t i = bytesPerPixel; i < stride; i++){
+						row[i] += row[i - bytesPerPixel];
+					};
+					break;
+				case 2: //up
+					for(size_t i = 0; i < stride; i++){
+						row[i] += above[i];
+					};
+					break;
+				case 3: //average
+					for(size_t i = 0; i < stride; i++){
+						int left = i >= bytesPerPixel ? row[i - bytesPerPixel] : 0;
+						row[i] += (uint8_t) ((left + above[i]) / 2);
+					};
+					break;
+				case 4: //paeth
+					for(size_t i = 0; i < stride; i++){
+						int a = i >= bytesPerPixel ? row[i - bytesPerPixel] : 0;
+						int b = above[i];
+						int c = i >= bytesPerPixel ? above[i - bytesPerPixel] : 0;
+						int p = a + b - c;
+						int pa = abs(p - a);
+						int pb = abs(p - b);
+						int pc = abs(p - c);
+						row[i] += (uint8_t) ((pa <= pb && pa <= pc) ? a : (pb <= pc ? b : c));
+					};
+					break;
+				default:
+					return false;
+			};
+			
+			return true;
+		};
+		
+		/*
+			Notes about DEFLATE (RFC 1951):
+			The stream is a sequence of blocks, each starting with a "last block" bit and a 2-bit type:
+				0 - stored (uncompressed, byte-aligned length and data)
+				1 - compressed with fixed Huffman codes
+				2 - compressed with dynamic Huffman codes (the code lengths are sent at the start of the block, themselves Huffman coded)
+			Compressed blocks contain literals (0-255), an end of block symbol (256) and length symbols (257-285), each length being
+			followed by a distance symbol, meaning "copy length bytes from distance bytes back in the output".
+			
+			Bits are read least significant first, but Huffman codes are stored most significant bit first, so decoding tables are
+			indexed by the bit-reversed code.
+		*/
+		
+		//bit reader
+		struct BitReader {
+			const uint8_t * data;
+			size_t size;
+			size_t position;
+			uint64_t buffer;
+			int bitCount;
+			
+			//make sure at least the given number of bits (up to 32) are buffered (bits past the end of the data are zero)
+			void refill(int bits){
+				while(this->bitCount < bits){
+					uint64_t byte = this->position < this->size ? this->data[this->position] : 0;
+					this->position++;
+					this->buffer |= byte << this->bitCount;
+					this->bitCount += 8;
+				};
+			};
+			
+			int readBits(int bits){
+				if(bits == 0){
+					return 0;
+				};
+				
+				this->refill(bits);
+				int value = (int) (this->buffer & ((1ull << bits) - 1));
+				this->buffer >>= bits;
+				this->bitCount -= bits;
+				return value;
+			};
+			
+			bool overrun(){
+				return this->position > this->size + 8;
+			};
+		};
+		
+		//huffman decoding table
+		//entry is (symbol << 4) | code length, indexed by the next 15 bits of input
+		struct HuffmanTable {
+			std::vector<uint16_t> entries;
+			
+			bool build(const uint8_t * lengths, int symbolCount){
+				//count codes of each length
+				int counts[16] = {0};
+				for(int i = 0; i < symbolCount; i++){
+					counts[lengths[i]]++;
+				};
+				counts[0] = 0;
+				
+				//calculate first code of each length (canonical huffman codes)
+				int nextCode[16];
+				int code = 0;
+				for(int length = 1; length < 16; length++){
+					code = (code + counts[length - 1]) << 1;
+					nextCode[length] = code;
+				};
+				
+				//fill table
+				this->entries.assign(1 << 15, 0);
+				
+				for(int symbol = 0; symbol < symbolCount; symbol++){
+					int length = lengths[symbol];
+					
+					if(length == 0){
+						continue;
+					};
+					
+					//reverse code
+					int reversed = 0;
+					int value = nextCode[length]++;
+					
+					if(value >= (1 << length)){
+						return false;
+					};
+					
+					for(int i = 0; i < length; i++){
+						reversed |= ((value >> i) & 1) << (length - 1 - i);
+					};
+					
+					//every index whose low bits match the reversed code decodes to this symbol
+					for(int i = reversed; i < (1 << 15); i += 1 << length){
+						this->entries[i] = (uint16_t) ((symbol << 4) | length);
+					};
+				};
+				
+				return true;
+			};
+			
+			int decode(BitReader * reader){
+				reader->refill(15);
+				uint16_t entry = this->entries[reader->buffer & 0x7FFF];
+				int length = entry & 15;
+				
+				//length 0 means an unassigned code
+				if(length == 0){
+					return -1;
+				};
+				
+				reader->buffer >>= length;
+				reader->bitCount -= length;
+				return entry >> 4;
+			};
+		};
+		
+		//inflate
+		static bool inflate(const uint8_t * data, size_t size, std::vector<uint8_t> * output){
+			static const int lengthBase[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+			static const int lengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+			static const int distanceBase[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+			static const int distanceExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+			static const int codeLengthOrder[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+			
+			BitReader reader = {data, size, 0, 0, 0};
+			HuffmanTable literalTable;
+			HuffmanTable distanceTable;
+			bool lastBlock = false;
+			
+			while(!lastBlock){
+				lastBlock = reader.readBits(1);
+				int type = reader.readBits(2);
+				
+				if(type == 0){
+					//stored block - discard remaining bits of the current byte, then read length and its complement
+					reader.readBits(reader.bitCount & 7);
+					int length = reader.readBits(16);
+					int complement = reader.readBits(16);
+					
+					if((length ^ 0xFFFF) != complement){
+						return false;
+					};
+					
+					for(int i = 0; i < length; i++){
+						output->push_back((uint8_t) reader.readBits(8));
+					};
+				} else if(type == 1 || type == 2){
+					uint8_t lengths[320];
+					
+					if(type == 1){
+						//fixed huffman codes
+						for(int i = 0; i < 288; i++){
+							lengths[i] = i < 144 ? 8 : (i < 256 ? 9 : (i < 280 ? 7 : 8));
+						};
+						for(int i = 0; i < 30; i++){
+							lengths[288 + i] = 5;
+						};
+						
+						literalTable.build(lengths, 288);
+						distanceTable.build(lengths + 288, 30);
+					} else {
+						//dynamic huffman codes
+						int literalCount = reader.readBits(5) + 257;
+						int distanceCount = reader.readBits(5) + 1;
+						int codeLengthCount = reader.readBits(4) + 4;
+						
+						uint8_t codeLengthLengths[19] = {0};
+						for(int i = 0; i < codeLengthCount; i++){
+							codeLengthLengths[codeLengthOrder[i]] = (uint8_t) reader.readBits(3);
+						};
+						
+						HuffmanTable codeLengthTable;
+						if(!codeLengthTable.build(codeLengthLengths, 19)){
+							return false;
+						};
+						
+						//read literal and distance code lengths (run-length encoded)
+						int count = 0;
+						while(count < literalCount + distanceCount){
+							int symbol = codeLengthTable.decode(&reader);
+							
+							if(symbol < 0){
+								return false;
+							} else if(symbol < 16){
+								lengths[count++] = (uint8_t) symbol;
+							} else {
+								int repeat;
+								uint8_t value = 0;
+								
+								if(symbol == 16){
+									if(count == 0){
+										return false;
+									};
+									value = lengths[count - 1];
+									repeat = 3 + reader.readBits(2);
+								} else if(symbol == 17){
+									repeat = 3 + reader.readBits(3);
+								} else {
+									repeat = 11 + reader.readBits(7);
+								};
+								
+								if(count + repeat > literalCount + distanceCount){
+									return false;
+								};
+								
+								while(repeat-- > 0){
+									lengths[count++] = value;
+								};
+							};
+						};
+						
+						if(!literalTable.build(lengths, literalCount) || !distanceTable.build(lengths + literalCount, distanceCount)){
+							return false;
+						};
+					};
+					
+					//decode symbols
+					while(true){
+						int symbol = literalTable.decode(&reader);
+						
+						if(symbol < 0 || reader.overrun()){
+							return false;
+						} else if(symbol < 256){
+							output->push_back((uint8_t) symbol);
+						} else if(symbol == 256){
+							break;
+						} else {
+							//length and distance pair
+							symbol -= 257;
+							if(symbol >= 29){
+								return false;
+							};
+							int length = lengthBase[symbol] + reader.readBits(lengthExtra[symbol]);
+							
+							int distanceSymbol = distanceTable.decode(&reader);
+							if(distanceSymbol < 0 || distanceSymbol >= 30){
+								return false;
+							};
+							size_t distance = distanceBase[distanceSymbol] + reader.readBits(distanceExtra[distanceSymbol]);
+							
+							if(distance > output->size()){
+								return false;
+							};
+							
+							//copy byte by byte, as the source and destination may overlap
+							size_t start = output->size() - distance;
+							for(int i = 0; i < length; i++){
+								output->push_back((*output)[start + i]);
+							};
+						};
+					};
+				} else {
+					return false;
+				};
+				
+				if(reader.overrun()){
+					return false;
+				};
+			};
+			
+			return true;
+		};
+};
+
+#endif
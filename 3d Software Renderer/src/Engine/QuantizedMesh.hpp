@@ -0,0 +1,293 @@
+//QuantizedMesh.hpp
+
+#ifndef QUANTIZED_MESH_HPP
+#define QUANTIZED_MESH_HPP
+
+#include <stdint.h>
+#include <vector>
+#include <emmintrin.h>
+#include "Mathematics.hpp"
+#include "Mesh.hpp"
+
+/*
+	Notes about quantized vertices:
+	A Vertex stores its position and normal as Vec4f (four doubles each), its texture coordinates as a Vec2f, a colour and a light intensity,
+	and every triangle stores three of them - roughly 100 bytes per vertex, repeated for each triangle that uses it.
+	
+	A QuantizedVertex is 16 bytes:
+		position - x, y and z as 16-bit unsigned integers, relative to the bounding box of the mesh (0 = minimum, 65535 = maximum)
+		normal - unit normal in octahedral encoding, stored as two 16-bit signed integers
+		texture coordinate - u and v as 16-bit unsigned integers, relative to the range of texture coordinates used by the mesh
+	
+	Vertices are stored once and referenced by an index buffer, so shared vertices are not duplicated.
+	
+	Position dequantization is a scale and an offset, which can be written as a matrix. This is folded into the model transformation
+	matrix, so dequantization is done by the same matrix-vector product that transforms the vertex.
+*/
+
+//quantized vertex
+struct QuantizedVertex {
+	uint16_t position[4]; //w is unused, it pads the position to 8 bytes so that it can be loaded with a single 64-bit load
+	int16_t normal[2];
+	uint16_t textureCoord[2];
+};
+
+//declare class
+class QuantizedMesh {
+	public:
+		//vertex and index buffers
+		std::vector<QuantizedVertex> vertices;
+		std::vector<unsigned int> indices;
+		
+		//dequantization parameters
+		Vec4f positionMin;
+		Vec4f positionScale;
+		Vec2f textureCoordMin;
+		Vec2f textureCoordScale;
+		
+		//texture (shared by all triangles)
+		Bitmap * texture = nullptr;
+		
+		//bounds, submeshes, meshlets and face planes (copied from the mesh - index buffer triangles are in the same order as the mesh triangles)
+		Bounds bounds;
+		std::vector<Submesh> submeshes;
+		std::vector<Meshlet> meshlets;
+		std::vector<Plane> facePlanes;
+		
+		//levels of detail (quantized from the mesh's levels of detail)
+		std::vector<QuantizedMesh> lods;
+		
+		//get number of triangles
+		int getTriangleCount(){
+			return this->indices.size() / 3;
+		};
+		
+		//get dequantization matrix
+		//this maps a quantized position (as a vector of integers with w = 1) to a model space position
+		Mat4x4f getDequantizationMatrix(){
+			Mat4x4f m = Math::enlargementMatrix(this->positionScale);
+			m.data[0][3] = this->positionMin.x;
+			m.data[1][3] = this->positionMin.y;
+			m.data[2][3] = this->positionMin.z;
+			return m;
+		};
+		
+		//dequantize texture coordinate
+		Vec2f dequantizeTextureCoord(QuantizedVertex & vertex){
+			return Vec2f(this->textureCoordMin.x + vertex.textureCoord[0] * this->textureCoordScale.x, this->textureCoordMin.y + vertex.textureCoord[1] * this->textureCoordScale.y);
+		};
+		
+		//get position transform
+		//combines the dequantization matrix with a transformation, for transforming ranges of positions
+		Mat4x4f getPositionTransform(Mat4x4f transform){
+			return Math::matrixProduct(transform, this->getDequantizationMatrix());
+		};
+		
+		//transform positions
+		/*
+			Dequantizes and transforms every vertex position with a single matrix-vector product per vertex, using SSE.
+			The dequantization matrix is combined with the given transformation, then each vertex is loaded as four 16-bit
+			integers, widened to 32-bit floats and multiplied by the columns of the combined matrix.
+		*/
+		void transformPositions(Mat4x4f transform, std::vector<Vec4f> * transformedPositions){
+			transformedPositions->resize(this->vertices.size());
+			this->transformPositions(this->getPositionTransform(transform), transformedPositions->data(), 0, this->vertices.size());
+		};
+		
+		//transform a range of positions
+		//positionTransform comes from getPositionTransform, and transformedPositions is indexed by vertex (other vertices are left unchanged),
+		//so ranges that do not overlap can be transformed on separate threads
+		void transformPositions(Mat4x4f positionTransform, Vec4f * transformedPositions, int firstVertex, int vertexCount){
+			Mat4x4f & m = positionTransform;
+			
+			//load matrix columns (the translation column is used as the w component, as the quantized w is always treated as 1)
+			__m128 column0 = _mm_setr_ps((float) m.data[0][0], (float) m.data[1][0], (float) m.data[2][0], (float) m.data[3][0]);
+			__m128 column1 = _mm_setr_ps((float) m.data[0][1], (float) m.data[1][1], (float) m.data[2][1], (float) m.data[3][1]);
+			__m128 column2 = _mm_setr_ps((float) m.data[0][2], (float) m.data[1][2], (float) m.data[2][2], (float) m.data[3][2]);
+			__m128 column3 = _mm_setr_ps((float) m.data[0][3], (float) m.data[1][3], (float) m.data[2][3], (float) m.data[3][3]);
+			
+			__m128i zero = _mm_setzero_si128();
+			
+			for(int i = firstVertex; i < firstVertex + vertexCount; i++){
+				//load x, y, z, w as 16-bit integers and widen to floats
+				__m128i quantized = _mm_loadl_epi64((const __m128i *) this->vertices[i].position);
+				__m128 position = _mm_cvtepi32_ps(_mm_unpacklo_epi16(quantized, zero));
+				
+				//multiply by matrix
+				__m128 result = _mm_add_ps(
+					_mm_add_ps(_mm_mul_ps(column0, _mm_shuffle_ps(position, position, _MM_SHUFFLE(0, 0, 0, 0))), _mm_mul_ps(column1, _mm_shuffle_ps(position, position, _MM_SHUFFLE(1, 1, 1, 1)))),
+					_mm_add_ps(_mm_mul_ps(column2, _mm_shuffle_ps(position, position, _MM_SHUFFLE(2, 2, 2, 2))), column3)
+				);
+				
+				//store as doubles
+				_mm_storeu_pd(&transformedPositions[i].x, _mm_cvtps_pd(result));
+				_mm_storeu_pd(&transformedPositions[i].z, _mm_cvtps_pd(_mm_movehl_ps(result, result)));
+			};
+		};
+		
+		//octahedral normal encoding
+		/*
+			The unit normal is projected onto the octahedron |x| + |y| + |z| = 1. The upper half (z >= 0) is projected straight
+			down onto the xy plane, and the lower half is folded over the diagonals into the corners of the square, so the whole
+			sphere maps onto the square [-1, 1] x [-1, 1], which is stored as two signed 16-bit integers.
+		*/
+		static void encodeOctahedralNormal(Vec4f normal, int16_t * encoded){
+			double sum = fabs(normal.x) + fabs(normal.y) + fabs(normal.z);
+			
+			//handle zero normals (faces without a normal in the .obj file)
+			if(sum == 0){
+				encoded[0] = 0;
+				encoded[1] = 0;
+				return;
+			};
+			
+			double x = normal.x / sum;
+			double y = normal.y / sum;
+			
+			//fold lower hemisphere
+			if(normal.z < 0){
+				double foldedX = (1 - fabs(y)) * (x >= 0 ? 1 : -1);
+				double foldedY = (1 - fabs(x)) * (y >= 0 ? 1 : -1);
+				x = foldedX;
+				y = foldedY;
+			};
+			
+			encoded[0] = (int16_t) round(x * 32767);
+			encoded[1] = (int16_t) round(y * 32767);
+		};
+		
+		static Vec4f decodeOctahedralNormal(const int16_t * encoded){
+			double x = encoded[0] / 32767.0;
+			double y = encoded[1] / 32767.0;
+			double z = 1 - fabs(x) - fabs(y);
+			
+			//unfold lower hemisphere
+			if(z < 0){
+				double unfoldedX = (1 - fabs(y)) * (x >= 0 ? 1 : -1);
+				double unfoldedY = (1 - fabs(x)) * (y >= 0 ? 1 : -1);
+				x = unfoldedX;
+				y = unfoldedY;
+			};
+			
+			double magnitude = sqrt(x * x + y * y + z * z);
+			return Vec4f(x / magnitude, y / magnitude, z / magnitude, 0.0f);
+		};
+		
+		//quantize mesh
+		static void quantizeMesh(Mesh * mesh, QuantizedMesh * quantizedMesh){
+			//weld vertices
+			std::vector<Vertex> uniqueVertices;
+			Mesh::buildIndexBuffer(mesh, &uniqueVertices, &quantizedMesh->indices);
+			
+			//give each meshlet its own copy of the vertices it uses, so the vertices of each meshlet are a separate range that can be transformed on its own
+			if(mesh->meshlets.size() > 0){
+				std::vector<Vertex> meshletVertices;
+				std::vector<int> vertexMeshlet(uniqueVertices.size(), -1);
+				std::vector<unsigned int> vertexIndex(uniqueVertices.size());
+				
+				for(int i = 0; i < mesh->meshlets.size(); i++){
+					for(int j = mesh->meshlets[i].firstTriangle * 3; j < (mesh->meshlets[i].firstTriangle + mesh->meshlets[i].triangleCount) * 3; j++){
+						unsigned int vertex = quantizedMesh->indices[j];
+						
+						if(vertexMeshlet[vertex] != i){
+							vertexMeshlet[vertex] = i;
+							vertexIndex[vertex] = meshletVertices.size();
+							meshletVertices.push_back(uniqueVertices[vertex]);
+						};
+						
+						quantizedMesh->indices[j] = vertexIndex[vertex];
+					};
+				};
+				
+				uniqueVertices = meshletVertices;
+			};
+			
+			quantizedMesh->vertices.clear();
+			quantizedMesh->texture = mesh->triangles.size() > 0 ? mesh->triangles[0].texture : nullptr;
+			quantizedMesh->bounds = mesh->bounds;
+			quantizedMesh->submeshes = mesh->submeshes;
+			quantizedMesh->meshlets = mesh->meshlets;
+			quantizedMesh->facePlanes = mesh->facePlanes;
+			
+			//quantize levels of detail
+			quantizedMesh->lods.resize(mesh->lods.size());
+			for(int i = 0; i < mesh->lods.size(); i++){
+				QuantizedMesh::quantizeMesh(&mesh->lods[i], &quantizedMesh->lods[i]);
+			};
+			
+			if(uniqueVertices.size() == 0){
+				return;
+			};
+			
+			//calculate bounds of positions and texture coordinates
+			Vec4f positionMin = uniqueVertices[0].position;
+			Vec4f positionMax = uniqueVertices[0].position;
+			Vec2f textureCoordMin = uniqueVertices[0].textureCoord;
+			Vec2f textureCoordMax = uniqueVertices[0].textureCoord;
+			
+			for(int i = 1; i < uniqueVertices.size(); i++){
+				Vertex & v = uniqueVertices[i];
+				positionMin = Vec4f(fmin(positionMin.x, v.position.x), fmin(positionMin.y, v.position.y), fmin(positionMin.z, v.position.z), 1.0f);
+				positionMax = Vec4f(fmax(positionMax.x, v.position.x), fmax(positionMax.y, v.position.y), fmax(positionMax.z, v.position.z), 1.0f);
+				textureCoordMin = Vec2f(fmin(textureCoordMin.x, v.textureCoord.x), fmin(textureCoordMin.y, v.textureCoord.y));
+				textureCoordMax = Vec2f(fmax(textureCoordMax.x, v.textureCoord.x), fmax(textureCoordMax.y, v.textureCoord.y));
+			};
+			
+			//calculate dequantization scales (a zero range is given a scale of zero, so every vertex dequantizes to the minimum)
+			quantizedMesh->positionMin = positionMin;
+			quantizedMesh->positionScale = Vec4f((positionMax.x - positionMin.x) / 65535, (positionMax.y - positionMin.y) / 65535, (positionMax.z - positionMin.z) / 65535, 1.0f);
+			quantizedMesh->textureCoordMin = textureCoordMin;
+			quantizedMesh->textureCoordScale = Vec2f((textureCoordMax.x - textureCoordMin.x) / 65535, (textureCoordMax.y - textureCoordMin.y) / 65535);
+			
+			//quantize vertices
+			quantizedMesh->vertices.resize(uniqueVertices.size());
+			
+			for(int i = 0; i < uniqueVertices.size(); i++){
+				Vertex & v = uniqueVertices[i];
+				QuantizedVertex & q = quantizedMesh->vertices[i];
+				
+				q.position[0] = QuantizedMesh::quantize(v.position.x - positionMin.x, positionMax.x - positionMin.x);
+				q.position[1] = QuantizedMesh::quantize(v.position.y - positionMin.y, positionMax.y - positionMin.y);
+				q.position[2] = QuantizedMesh::quantize(v.position.z - positionMin.z, positionMax.z - positionMin.z);
+				q.position[3] = 0;
+				
+				QuantizedMesh::encodeOctahedralNormal(v.normal, q.normal);
+				
+				q.textureCoord[0] = QuantizedMesh::quantize(v.textureCoord.x - textureCoordMin.x, textureCoordMax.x - textureCoordMin.x);
+				q.textureCoord[1] = QuantizedMesh::quantize(v.textureCoord.y - textureCoordMin.y, textureCoordMax.y - textureCoordMin.y);
+			};
+			
+			quantizedMesh->calculateMeshletVertexRanges();
+		};
+		
+		//calculate meshlet vertex ranges
+		//sets the range of vertices each meshlet uses, so only the vertices of visible meshlets need to be transformed - this must be called again if the vertices are reordered
+		void calculateMeshletVertexRanges(){
+			for(int i = 0; i < this->meshlets.size(); i++){
+				Meshlet & meshlet = this->meshlets[i];
+				unsigned int first = this->vertices.size();
+				unsigned int last = 0;
+				
+				for(int j = meshlet.firstTriangle * 3; j < (meshlet.firstTriangle + meshlet.triangleCount) * 3; j++){
+					first = this->indices[j] < first ? this->indices[j] : first;
+					last = this->indices[j] > last ? this->indices[j] : last;
+				};
+				
+				meshlet.firstVertex = first;
+				meshlet.vertexCount = last - first + 1;
+			};
+		};
+	
+	private:
+		//quantize a value in the range [0, range] to a 16-bit unsigned integer
+		static uint16_t quantize(double value, double range){
+			if(range <= 0){
+				return 0;
+			};
+			
+			double scaled = round(value / range * 65535);
+			return (uint16_t) (scaled < 0 ? 0 : (scaled > 65535 ? 65535 : scaled));
+		};
+};
+
+#endif
@@ -7,6 +7,31 @@
 Renderer::Renderer(Window * window){
 	//set window
 	this->window = window;
+	
+	//cull back faces before transforming triangles by default
+	this->backFaceCullingMode = OBJECT_SPACE_BACK_FACE_CULLING;
+	
+	//light vertices by default
+	this->lightingMode = VERTEX_LIGHTING;
+	
+	//everything is drawn on the calling thread until a job system is set
+	this->jobSystem = nullptr;
+	
+	//there is no far plane or fog by default
+	this->setFarDistance(0);
+	this->setFog(NO_FOG, Pixel(), 0, 0);
+	
+	//occlusion culling is used by drawScene by default
+	this->occlusionCulling = true;
+	this->occlusionBufferActive = false;
+	this->occlusionViewTransform = Math::identityMatrix();
+	
+	//there are no static lights until they are set
+	this->staticLightingVersion = 0;
+	this->staticLightSet.compile(&this->staticLights, Math::identityMatrix());
+	
+	//reset statistics
+	this->resetStatistics();
 };
 
 //destructor?
@@ -136,10 +161,14 @@ void Renderer::drawHorizontalLine(int x1, int x2, int y, double i1, double i2, d
 	
 	for(int i = x1; i <= x2; i++){
 		//sample bitmap to get pixel colour at (tx, ty) (since tx and ty are normalised, they must be multiplied by the width and height of the bitmap in pixels)
-		Pixel colour = bmp->pixels[(int) (floor(ty * bmp->infoHeader.biHeight) * bmp->infoHeader.biWidth + floor(tx * bmp->infoHeader.biWidth))];
+		//untextured triangles use the interpolated vertex colour
+		Pixel colour(r, g, b);
+		if(bmp != nullptr){
+			colour = bmp->pixels[(int) (floor(ty * bmp->infoHeader.biHeight) * bmp->infoHeader.biWidth + floor(tx * bmp->infoHeader.biWidth))];
+		};
 		
 		//draw pixel 
-		this->window->drawPixel(i, y, 1.f / inverseDepth, (uint8_t) ((double) colour.red * intensity), (uint8_t) ((double) colour.green * intensity), (uint8_t) ((double) colour.blue * intensity));
+		this->drawShadedPixel(i, y, 1.f / inverseDepth, colour, intensity);
 		
 		//step forward
 		r += rStep;
@@ -152,6 +181,24 @@ void Renderer::drawHorizontalLine(int x1, int x2, int y, double i1, double i2, d
 	};
 };
 
+//draw shaded pixel
+void Renderer::drawShadedPixel(int x, int y, double depth, Pixel colour, double intensity){
+	double red = (double) colour.red * intensity;
+	double green = (double) colour.green * intensity;
+	double blue = (double) colour.blue * intensity;
+	
+	//blend towards the fog colour (pixels before the fog's start distance are not fogged, and those after its end take the last entry)
+	if(this->fogMode != NO_FOG && depth > this->fogStart){
+		float visibility = this->fogTable[(int) fmin((depth - this->fogStart) * this->fogScale, FOG_TABLE_SIZE - 1)];
+		
+		red = red * visibility + this->fogColour.red * (1 - visibility);
+		green = green * visibility + this->fogColour.green * (1 - visibility);
+		blue = blue * visibility + this->fogColour.blue * (1 - visibility);
+	};
+	
+	this->window->drawPixel(x, y, depth, (uint8_t) red, (uint8_t) green, (uint8_t) blue);
+};
+
 //draw shaded triangle
 void Renderer::drawShadedTriangle(int x1, int y1, int x2, int y2, int x3, int y3, double i1, double i2, double i3, double d1, double d2, double d3, double tx1, double ty1, double tx2, double ty2, double tx3, double ty3, Bitmap * bmp, Pixel c1, Pixel c2, Pixel c3){
 	//draw shaded triangle
@@ -400,6 +447,175 @@ void Renderer::drawShadedTriangle(int x1, int y1, int x2, int y2, int x3, int y3
 	};
 };
 
+//draw lit triangle
+//the same as drawShadedTriangle, with the attributes needed to light each pixel interpolated along the edges (see notes on per-pixel lighting)
+void Renderer::drawLitTriangle(Triangle t, Triangle viewTriangle, LightSet * lights){
+	//set up the attributes of each vertex
+	int x[3];
+	int y[3];
+	double attributes[3][PIXEL_ATTRIBUTE_COUNT];
+	
+	for(int i = 0; i < 3; i++){
+		Vertex & vertex = t.vertices[i];
+		Vec4f & normal = viewTriangle.vertices[i].normal;
+		double inverseDepth = 1.f / vertex.position.z;
+		
+		x[i] = vertex.position.x;
+		y[i] = vertex.position.y;
+		attributes[i][0] = inverseDepth;
+		attributes[i][1] = vertex.lightIntensity;
+		attributes[i][2] = vertex.textureCoord.x;
+		attributes[i][3] = vertex.textureCoord.y;
+		attributes[i][4] = normal.x * inverseDepth;
+		attributes[i][5] = normal.y * inverseDepth;
+		attributes[i][6] = normal.z * inverseDepth;
+	};
+	
+	//sort vertices by y-coordinate
+	int v1 = 0;
+	int v2 = 1;
+	int v3 = 2;
+	
+	if(y[v2] < y[v1]){
+		std::swap(v1, v2);
+	};
+	
+	if(y[v3] < y[v1]){
+		std::swap(v1, v3);
+	};
+	
+	if(y[v3] < y[v2]){
+		std::swap(v2, v3);
+	};
+	
+	//steps per unit y along the edges v1 -> v3 (1) and v1 -> v2, then v2 -> v3 (2)
+	double px1 = x[v1];
+	double px2 = x[v1];
+	double xStep1 = (double) (x[v3] - x[v1]) / (y[v3] - y[v1]);
+	double xStep2 = (double) (x[v2] - x[v1]) / (y[v2] - y[v1]);
+	
+	double values1[PIXEL_ATTRIBUTE_COUNT];
+	double values2[PIXEL_ATTRIBUTE_COUNT];
+	double steps1[PIXEL_ATTRIBUTE_COUNT];
+	double steps2[PIXEL_ATTRIBUTE_COUNT];
+	
+	for(int i = 0; i < PIXEL_ATTRIBUTE_COUNT; i++){
+		values1[i] = attributes[v1][i];
+		values2[i] = attributes[v1][i];
+		steps1[i] = (attributes[v3][i] - attributes[v1][i]) / (y[v3] - y[v1]);
+		steps2[i] = (attributes[v2][i] - attributes[v1][i]) / (y[v2] - y[v1]);
+	};
+	
+	//draw the first half of the triangle
+	for(int i = y[v1]; i < y[v2]; i++){
+		this->drawLitHorizontalLine(px1, px2, i, values1, values2, t.texture, lights);
+		
+		px1 += xStep1;
+		px2 += xStep2;
+		
+		for(int j = 0; j < PIXEL_ATTRIBUTE_COUNT; j++){
+			values1[j] += steps1[j];
+			values2[j] += steps2[j];
+		};
+	};
+	
+	//re-calculate steps
+	px2 = x[v2];
+	xStep2 = (double) (x[v3] - x[v2]) / (y[v3] - y[v2]);
+	
+	for(int i = 0; i < PIXEL_ATTRIBUTE_COUNT; i++){
+		values2[i] = attributes[v2][i];
+		steps2[i] = (attributes[v3][i] - attributes[v2][i]) / (y[v3] - y[v2]);
+	};
+	
+	//draw the second half of the triangle
+	for(int i = y[v2]; i < y[v3]; i++){
+		this->drawLitHorizontalLine(px1, px2, i, values1, values2, t.texture, lights);
+		
+		px1 += xStep1;
+		px2 += xStep2;
+		
+		for(int j = 0; j < PIXEL_ATTRIBUTE_COUNT; j++){
+			values1[j] += steps1[j];
+			values2[j] += steps2[j];
+		};
+	};
+};
+
+//draw lit horizontal line
+//visible pixels are gathered and lit together four at a time, then drawn
+void Renderer::drawLitHorizontalLine(int x1, int x2, int y, double * attributes1, double * attributes2, Bitmap * bmp, LightSet * lights){
+	//swap x1 and x2, so that x1 <= x2
+	if(x2 < x1){
+		std::swap(x1, x2);
+		std::swap(attributes1, attributes2);
+	};
+	
+	double values[PIXEL_ATTRIBUTE_COUNT];
+	double steps[PIXEL_ATTRIBUTE_COUNT];
+	
+	for(int i = 0; i < PIXEL_ATTRIBUTE_COUNT; i++){
+		values[i] = attributes1[i];
+		steps[i] = (attributes2[i] - attributes1[i]) / (x2 - x1);
+	};
+	
+	//undoing the projection: view x = ndc x * depth * tanHalfFov, and view y = ndc y * depth * tanHalfFov / aspect ratio
+	double width = this->window->getWidth();
+	double height = this->window->getHeight();
+	double scaleX = this->tanHalfFov;
+	double scaleY = this->tanHalfFov / this->window->getAspectRatio();
+	double ndcY = 2 * y / height - 1;
+	
+	//gather the visible pixels
+	this->pixelLighting.clear();
+	this->litPixels.clear();
+	
+	for(int i = x1; i <= x2; i++){
+		double depth = 1.f / values[0];
+		
+		if(this->window->isPixelVisible(i, y, depth)){
+			LitPixel pixel;
+			pixel.x = i;
+			pixel.depth = depth;
+			pixel.colour = Pixel(255, 255, 255);
+			pixel.bakedIntensity = values[1];
+			
+			if(bmp != nullptr){
+				pixel.colour = bmp->pixels[(int) (floor(values[3] * bmp->infoHeader.biHeight) * bmp->infoHeader.biWidth + floor(values[2] * bmp->infoHeader.biWidth))];
+			};
+			
+			Vec4f position((2 * i / width - 1) * depth * scaleX, ndcY * depth * scaleY, depth, 1.0f);
+			Vec4f normal(values[4], values[5], values[6], 0.0f);
+			double length = Math::magnitude(normal);
+			
+			if(length > 0){
+				normal = Math::scalarProduct(1 / length, normal);
+			};
+			
+			this->pixelLighting.add(position, normal);
+			this->litPixels.push_back(pixel);
+		};
+		
+		for(int j = 0; j < PIXEL_ATTRIBUTE_COUNT; j++){
+			values[j] += steps[j];
+		};
+	};
+	
+	if(this->litPixels.size() == 0){
+		return;
+	};
+	
+	//light and draw them
+	lights->lightVertices(&this->pixelLighting);
+	
+	for(int i = 0; i < this->litPixels.size(); i++){
+		LitPixel & pixel = this->litPixels[i];
+		double intensity = fmin(this->pixelLighting.intensities[i] + pixel.bakedIntensity, 1);
+		
+		this->drawShadedPixel(pixel.x, y, pixel.depth, pixel.colour, intensity);
+	};
+};
+
 //draw textured triangle
 
 //draw rectangle
@@ -428,18 +644,25 @@ Triangle Renderer::transformTriangle(Triangle t, Mat4x4f transform){
 	for(int i = 0; i < 3; i++){
 		//transform position
 		t.vertices[i].position = Math::matrixProduct(transform, t.vertices[i].position);
+	};
 	
-		//transform normal
-		//TODO: implement normal transformation using transpose of inverse method
-		//https://www.scratchapixel.com/lessons/mathematics-physics-for-computer-graphics/geometry/transforming-normals.html
-		//t->vertices[i].normal = Math::matrixProduct(transform, t->);
+	return t;
+};
+
+//transform triangle and its normals (normalMatrix should be Math::normalMatrix(transform), which is found once per model rather than once per vertex)
+Triangle Renderer::transformTriangle(Triangle t, Mat4x4f transform, Mat4x4f normalMatrix){
+	//iterate through vertices
+	for(int i = 0; i < 3; i++){
+		t.vertices[i].position = Math::matrixProduct(transform, t.vertices[i].position);
+		t.vertices[i].normal = Math::matrixProduct(normalMatrix, t.vertices[i].normal);
 	};
 	
 	return t;
 };
 
+
 //cull back faces
-//TODO: optimise this function to run before view-space / camera transformations, so out-of-sight triangles do not need to be transformed
+//in object space culling mode, triangles facing away from the camera have already been skipped by isFacePlaneBackFacing before being transformed, so this only removes the few that rounding lets through
 bool Renderer::cullBackFace(Triangle triangle){
 	//assume camera is at (0, 0, 0) (as triangles should be transformed to view space by this point)
 	Vec4f normal = Math::crossProduct(triangle.vertices[1].position - triangle.vertices[0].position, triangle.vertices[2].position - triangle.vertices[1].position);
@@ -460,31 +683,55 @@ Triangle Renderer::convertTriangleToPixelSpace(Triangle triangle){
 };
 
 //shade vertex
-Vertex Renderer::shadeVertex(Vertex vertex, Vec4f normal, std::vector<Light> lights){
-	//reset intensity
-	vertex.lightIntensity = 0;
-	
-	//iterate through lights
-	for(int i = 0; i < lights.size(); i++){
-		//check light type
-		if(lights[i].type == AMBIENT_LIGHT){
-			vertex.lightIntensity += lights[i].intensity;
-		} else if(lights[i].type == POINT_LIGHT){
-			//calculate vector from point to light
-			Vec4f direction = vertex.position - lights[i].position;
+//the normal and vertex position must be in view space, like the light set
+Vertex Renderer::shadeVertex(Vertex vertex, Vec4f normal, LightSet * lights){
+	//renormalise the normal, which a non-uniform scale leaves the wrong length (see Math::normalMatrix)
+	double length = Math::magnitude(normal);
+	
+	if(length > 0){
+		normal = Math::scalarProduct(1 / length, normal);
+	};
+	
+	//ambient lights are summed when the light set is compiled
+	vertex.lightIntensity = lights->ambientIntensity;
+	
+	//directional lights (the direction towards the light and the normal are unit length, so their dot product is the cosine of the angle between them)
+	for(int i = 0; i < lights->directionalIntensity.size(); i++){
+		double diffuseIntensity = lights->directionalIntensity[i] * (lights->directionalX[i] * normal.x + lights->directionalY[i] * normal.y + lights->directionalZ[i] * normal.z);
 			
-			double diffuseIntensity = lights[i].intensity * Math::dotProduct(direction, normal) / (Math::magnitude(direction) * Math::magnitude(normal));
+		if(diffuseIntensity > 0 && lights->directionalShadowMaps[i] != nullptr){
+			diffuseIntensity *= lights->getShadowVisibility(lights->directionalShadowMaps[i], vertex.position);
+		};
+		
+		if(diffuseIntensity > 0){
+			vertex.lightIntensity += diffuseIntensity;
+		};
+	};
 			
-			if(diffuseIntensity > 0){
-				vertex.lightIntensity += diffuseIntensity;
-			};
-		} else if(lights[i].type == DIRECTIONAL_LIGHT){
-			//calculate diffuse intensity
-			double diffuseIntensity = lights[i].intensity * Math::dotProduct(lights[i].direction, normal);
+	//point lights assigned to the object being drawn
+	for(int j = 0; j < lights->assignedPointLights.size(); j++){
+		int i = lights->assignedPointLights[j];
+		
+		//calculate vector from point to light
+		double dx = lights->pointX[i] - vertex.position.x;
+		double dy = lights->pointY[i] - vertex.position.y;
+		double dz = lights->pointZ[i] - vertex.position.z;
+		double distanceSquared = dx * dx + dy * dy + dz * dz;
+		double distance = sqrt(distanceSquared);
 			
-			if(diffuseIntensity > 0){
-				vertex.lightIntensity += diffuseIntensity;
-			};
+		//the normal is unit length, so only the direction to the light needs to be divided by its length
+		double diffuseIntensity = distance > 0 ? lights->pointIntensity[i] * (dx * normal.x + dy * normal.y + dz * normal.z) / distance : 0;
+		
+		//fade out towards the light's range (see notes on light sets)
+		double falloff = fmax(1 - distanceSquared * lights->pointInverseRangeSquared[i], 0);
+		diffuseIntensity *= falloff * falloff;
+		
+		if(diffuseIntensity > 0 && lights->pointShadowMaps[i] != nullptr){
+			diffuseIntensity *= lights->getShadowVisibility(lights->pointShadowMaps[i], vertex.position);
+		};
+		
+		if(diffuseIntensity > 0){
+			vertex.lightIntensity += diffuseIntensity;
 		};
 	};
 	
@@ -498,13 +745,10 @@ Vertex Renderer::shadeVertex(Vertex vertex, Vec4f normal, std::vector<Light> lig
 };
 
 //apply lighting
-Triangle Renderer::applyLighting(Triangle triangle, std::vector<Light> lights){
-	//calculate normal 
-	Vec4f normal = Math::crossProduct(triangle.vertices[2].position - triangle.vertices[0].position, triangle.vertices[1].position - triangle.vertices[0].position);
-	
-	//apply lighting to each vertex
+//each vertex is lit with its own unit normal (smooth normals from the .obj file or generated when it is loaded, or face normals for flat shading)
+Triangle Renderer::applyLighting(Triangle triangle, LightSet * lights){
 	for(int i = 0; i < 3; i++){
-		triangle.vertices[i] = this->shadeVertex(triangle.vertices[i], normal, lights);
+		triangle.vertices[i] = this->shadeVertex(triangle.vertices[i], triangle.vertices[i].normal, lights);
 	};
 	
 	return triangle;
@@ -701,73 +945,825 @@ void Renderer::clipAgainstBottomPlane(Triangle triangle, std::vector<Triangle> *
 };
 
 //draw 3d triangle
-void Renderer::draw3dTriangle(Triangle t, Mat4x4f transform, Mat4x4f viewTransform, std::vector<Light> lights){
-	//transform triangle to world space
-	t = this->transformTriangle(t, transform);
+//this is a batch of one triangle - meshes should be drawn with a batch of all of their triangles
+//the light set must have been compiled with the same view transform
+void Renderer::draw3dTriangle(Triangle t, Mat4x4f transform, Mat4x4f viewTransform, LightSet * lights){
+	//transform triangle straight to view space
+	Mat4x4f modelViewTransform = Math::matrixProduct(viewTransform, transform);
+	
+	Triangle viewTriangle = this->transformTriangle(t, modelViewTransform, Math::normalMatrix(modelViewTransform));
+	
+	//assign the point lights that reach the triangle's bounding box
+	Vec4f min = viewTriangle.vertices[0].position;
+	Vec4f max = viewTriangle.vertices[0].position;
+	for(int i = 1; i < 3; i++){
+		Vec4f & position = viewTriangle.vertices[i].position;
+		min = Vec4f(fmin(min.x, position.x), fmin(min.y, position.y), fmin(min.z, position.z), 1.0f);
+		max = Vec4f(fmax(max.x, position.x), fmax(max.y, position.y), fmax(max.z, position.z), 1.0f);
+	};
+	this->assignLights(lights, min, max);
 	
-	//apply lighting to triangle in world space
-	t = this->applyLighting(t, lights);
+	this->clearBatch();
+	this->addBatchTriangle(viewTriangle, 0);
+	this->drawBatch(lights, nullptr);
+};
+
+//draw world space triangle
+void Renderer::drawWorldSpaceTriangle(Triangle t, Mat4x4f viewTransform, LightSet * lights){
+	this->draw3dTriangle(t, Math::identityMatrix(), viewTransform, lights);
+};
 	
-	//transform triangle to view space
-	t = this->transformTriangle(t, viewTransform);
+//clear batch
+void Renderer::clearBatch(){
+	this->batch.viewTriangles.clear();
+	this->batch.screenTriangles.clear();
+	this->batch.sourceTriangles.clear();
+	this->batch.visibility.clear();
+};
+	
+//add batch triangle
+void Renderer::addBatchTriangle(Triangle viewTriangle, int sourceTriangle){
+	this->batch.viewTriangles.push_back(viewTriangle);
+	this->batch.sourceTriangles.push_back(sourceTriangle);
+};
+
+//cull batch
+//marks every triangle as visible, then removes back-facing triangles
+void Renderer::cullBatch(){
+	int count = this->batch.viewTriangles.size();
+	
+	this->batch.screenTriangles.resize(count);
+	this->batch.visibility.assign((count + 31) / 32, 0xFFFFFFFF);
 	
-	//TODO - implement proper clipping
+	//clear the bits after the last triangle
+	if(count % 32 != 0){
+		this->batch.visibility.back() = (1u << (count % 32)) - 1;
+	};
 	
-	//check if face is visible
-	if(this->cullBackFace(t) && t.vertices[0].position.z > this->getProjectionPlaneDistance() && t.vertices[1].position.z > this->getProjectionPlaneDistance() && t.vertices[2].position.z > this->getProjectionPlaneDistance()){
+	for(int i = this->getNextVisibleBatchTriangle(0); i < this->batch.screenTriangles.size(); i = this->getNextVisibleBatchTriangle(i + 1)){
+		if(!this->cullBackFace(this->batch.viewTriangles[i])){
+			this->batch.visibility[i / 32] &= ~(1u << (i % 32));
+		};
+	};
+};
+
+//clip batch
+//removes triangles that are not entirely in front of the near plane, are entirely beyond the far plane or are entirely off screen, and projects the rest
+//(the pixels of triangles that cross the far plane are removed by the depth buffer, see notes on the far plane and fog)
+void Renderer::clipBatch(){
+	double nearDistance = this->getProjectionPlaneDistance();
+	double farDistance = this->farDistance > 0 ? this->farDistance : DBL_MAX;
+	
+	for(int i = this->getNextVisibleBatchTriangle(0); i < this->batch.screenTriangles.size(); i = this->getNextVisibleBatchTriangle(i + 1)){
+		Triangle & viewTriangle = this->batch.viewTriangles[i];
+		
+		//TODO - implement proper clipping
+		if(!(viewTriangle.vertices[0].position.z > nearDistance && viewTriangle.vertices[1].position.z > nearDistance && viewTriangle.vertices[2].position.z > nearDistance)){
+			this->batch.visibility[i / 32] &= ~(1u << (i % 32));
+			continue;
+		};
+		
+		if(viewTriangle.vertices[0].position.z >= farDistance && viewTriangle.vertices[1].position.z >= farDistance && viewTriangle.vertices[2].position.z >= farDistance){
+			this->batch.visibility[i / 32] &= ~(1u << (i % 32));
+			continue;
+		};
+		
 		//project triangle
-		t = this->projectTriangle(t);
+		Triangle & t = this->batch.screenTriangles[i];
+		t = this->projectTriangle(viewTriangle);
 		
 		//check against x and y bounds
-		if(!((t.vertices[0].position.x < -1 && t.vertices[1].position.x < -1 && t.vertices[2].position.x < -1) || (t.vertices[0].position.x > 1 && t.vertices[1].position.x > 1 && t.vertices[2].position.x > 1) || (t.vertices[0].position.y < -1 && t.vertices[1].position.y < -1 && t.vertices[2].position.y < -1) || (t.vertices[0].position.y > 1 && t.vertices[1].position.y > 1 && t.vertices[2].position.y > 1))){
-			t = this->convertTriangleToPixelSpace(t);
+		if((t.vertices[0].position.x < -1 && t.vertices[1].position.x < -1 && t.vertices[2].position.x < -1) || (t.vertices[0].position.x > 1 && t.vertices[1].position.x > 1 && t.vertices[2].position.x > 1) || (t.vertices[0].position.y < -1 && t.vertices[1].position.y < -1 && t.vertices[2].position.y < -1) || (t.vertices[0].position.y > 1 && t.vertices[1].position.y > 1 && t.vertices[2].position.y > 1)){
+			this->batch.visibility[i / 32] &= ~(1u << (i % 32));
+		};
+	};
+};
+			
+//light batch
+//the vertices of the visible view space triangles are gathered into a lighting batch and lit four at a time (see notes on light sets),
+//and the intensities are copied to the triangles that will be drawn, plus their baked intensities if they have any (indexed by the
+//corners of the source triangles, see notes on static lighting)
+void Renderer::lightBatch(LightSet * lights, std::vector<float> * bakedIntensities){
+	//with per-pixel lighting the lights are evaluated as the triangles are drawn, so the vertices only have their baked intensities
+	//(and without directional or point lights, every vertex is lit by the ambient lights alone)
+	bool pixelLighting = this->lightingMode == PIXEL_LIGHTING;
+	bool dynamicLighting = !pixelLighting && (lights->directionalIntensity.size() > 0 || lights->assignedPointLights.size() > 0);
+	float ambientIntensity = pixelLighting ? 0.0f : (float) fmin(fmax(lights->ambientIntensity, 0), 1);
+	
+	if(dynamicLighting){
+		this->vertexLighting.clear();
+		
+		for(int i = this->getNextVisibleBatchTriangle(0); i < this->batch.screenTriangles.size(); i = this->getNextVisibleBatchTriangle(i + 1)){
+			Triangle & t = this->batch.viewTriangles[i];
 			
-			this->drawShadedTriangle(t.vertices[0].position.x, t.vertices[0].position.y, t.vertices[1].position.x, t.vertices[1].position.y, t.vertices[2].position.x, t.vertices[2].position.y, t.vertices[0].lightIntensity, t.vertices[1].lightIntensity, t.vertices[2].lightIntensity, t.vertices[0].position.z, t.vertices[1].position.z, t.vertices[2].position.z, t.vertices[0].textureCoord.x, t.vertices[0].textureCoord.y, t.vertices[1].textureCoord.x, t.vertices[1].textureCoord.y, t.vertices[2].textureCoord.x, t.vertices[2].textureCoord.y, t.texture, Pixel(255, 255, 255), Pixel(255, 255, 255), Pixel(255, 255, 255));	
+			for(int j = 0; j < 3; j++){
+				this->vertexLighting.add(t.vertices[j].position, t.vertices[j].normal);
+			};
+		};
+		
+		lights->lightVertices(&this->vertexLighting);
+	};
+	
+	int vertex = 0;
+	
+	for(int i = this->getNextVisibleBatchTriangle(0); i < this->batch.screenTriangles.size(); i = this->getNextVisibleBatchTriangle(i + 1)){
+		for(int j = 0; j < 3; j++){
+			float intensity = dynamicLighting ? this->vertexLighting.intensities[vertex++] : ambientIntensity;
+			
+			if(bakedIntensities != nullptr){
+				assert(this->batch.sourceTriangles[i] * 3 + j < bakedIntensities->size());
+				intensity = fmin(intensity + (*bakedIntensities)[this->batch.sourceTriangles[i] * 3 + j], 1.0f);
+			};
+			
+			this->batch.screenTriangles[i].vertices[j].lightIntensity = intensity;
+		};
+	};
+};
+
+//assign lights
+//keeps the point lights that reach a view space bounding sphere, to light the triangles inside it with
+void Renderer::assignLights(LightSet * lights, Vec4f centre, double radius){
+	lights->assignLights(centre, radius);
+	
+	this->statistics.pointLightsAssigned += lights->assignedPointLights.size();
+	this->statistics.pointLightsCulled += lights->pointIntensity.size() - lights->assignedPointLights.size();
+};
+
+//the same, for a view space box (using the sphere around it)
+void Renderer::assignLights(LightSet * lights, Vec4f min, Vec4f max){
+	Vec4f centre((min.x + max.x) / 2, (min.y + max.y) / 2, (min.z + max.z) / 2, 1.0f);
+	double radius = Math::magnitude(Vec4f(max.x - min.x, max.y - min.y, max.z - min.z, 0.0f)) / 2;
+	
+	this->assignLights(lights, centre, radius);
+};
+
+//set static lights
+//the lights are compiled in world space, and only if they are different from the ones set last time, so they can be set every frame
+void Renderer::setStaticLights(std::vector<Light> * lights){
+	bool changed = lights->size() != this->staticLights.size();
+	
+	for(int i = 0; i < lights->size() && !changed; i++){
+		Light & a = (*lights)[i];
+		Light & b = this->staticLights[i];
+		
+		changed = a.type != b.type || a.intensity != b.intensity || a.range != b.range ||
+			a.position.x != b.position.x || a.position.y != b.position.y || a.position.z != b.position.z ||
+			a.direction.x != b.direction.x || a.direction.y != b.direction.y || a.direction.z != b.direction.z ||
+			a.shadowMap != b.shadowMap || (a.shadowMap != nullptr && a.shadowMap->getVersion() != this->staticShadowMapVersions[i]);
+	};
+	
+	if(!changed){
+		return;
+	};
+	
+	this->staticLights = *lights;
+	this->staticShadowMapVersions.clear();
+	
+	for(int i = 0; i < lights->size(); i++){
+		ShadowMap * shadowMap = (*lights)[i].shadowMap;
+		this->staticShadowMapVersions.push_back(shadowMap != nullptr ? shadowMap->getVersion() : 0);
+	};
+	
+	this->staticLightSet.compile(&this->staticLights, Math::identityMatrix());
+	this->staticLightingVersion++;
+};
+
+//bake lighting
+//bakes the static lights into the model's current level of detail if they or the model have changed since it was baked, and returns
+//the baked intensities (one per corner of each triangle)
+std::vector<float> * Renderer::bakeLighting(Model * model){
+	int lodCount = 1 + (model->quantizedMesh != nullptr ? model->quantizedMesh->lods.size() : model->mesh->lods.size());
+	model->bakedLighting.resize(lodCount);
+	
+	BakedLighting & baked = model->bakedLighting[model->lod];
+	
+	//the mesh can be replaced after it was baked (e.g. a placeholder by the loaded mesh), so the bake is also redone if it no longer
+	//has one intensity per corner
+	QuantizedMesh * quantizedMesh = nullptr;
+	Mesh * mesh = nullptr;
+	int cornerCount;
+	
+	if(model->quantizedMesh != nullptr){
+		quantizedMesh = model->lod == 0 ? model->quantizedMesh : &model->quantizedMesh->lods[model->lod - 1];
+		cornerCount = quantizedMesh->indices.size();
+	} else {
+		mesh = model->lod == 0 ? model->mesh : &model->mesh->lods[model->lod - 1];
+		cornerCount = mesh->triangles.size() * 3;
+	};
+	
+	if(baked.lightingVersion == this->staticLightingVersion && baked.worldVersion == model->getWorldVersion() && baked.intensities.size() == cornerCount){
+		return &baked.intensities;
+	};
+	
+	//light the corners of every triangle in world space
+	Mat4x4f transform = model->getTransformationMatrix();
+	Mat4x4f normalMatrix = Math::normalMatrix(transform);
+	
+	this->vertexLighting.clear();
+	
+	if(quantizedMesh != nullptr){
+		quantizedMesh->transformPositions(transform, &this->transformedPositions);
+		
+		Bounds bounds = Mesh::transformBounds(quantizedMesh->bounds, transform);
+		this->staticLightSet.assignLights(bounds.centre, bounds.radius);
+		
+		for(int i = 0; i < quantizedMesh->indices.size(); i++){
+			QuantizedVertex & vertex = quantizedMesh->vertices[quantizedMesh->indices[i]];
+			this->vertexLighting.add(this->transformedPositions[quantizedMesh->indices[i]], Math::matrixProduct(normalMatrix, QuantizedMesh::decodeOctahedralNormal(vertex.normal)));
+		};
+	} else {
+		Bounds bounds = Mesh::transformBounds(mesh->bounds, transform);
+		this->staticLightSet.assignLights(bounds.centre, bounds.radius);
+		
+		for(int i = 0; i < mesh->triangles.size(); i++){
+			for(int j = 0; j < 3; j++){
+				Vertex & vertex = mesh->triangles[i].vertices[j];
+				this->vertexLighting.add(Math::matrixProduct(transform, vertex.position), Math::matrixProduct(normalMatrix, vertex.normal));
+			};
+		};
+	};
+	
+	this->staticLightSet.lightVertices(&this->vertexLighting);
+	
+	baked.intensities.assign(this->vertexLighting.intensities.begin(), this->vertexLighting.intensities.begin() + this->vertexLighting.count);
+	baked.lightingVersion = this->staticLightingVersion;
+	baked.worldVersion = model->getWorldVersion();
+	
+	this->statistics.modelsBaked++;
+	
+	return &baked.intensities;
+};
+
+//rasterise batch
+void Renderer::rasteriseBatch(LightSet * lights){
+	for(int i = this->getNextVisibleBatchTriangle(0); i < this->batch.screenTriangles.size(); i = this->getNextVisibleBatchTriangle(i + 1)){
+		Triangle t = this->convertTriangleToPixelSpace(this->batch.screenTriangles[i]);
+		
+		if(this->lightingMode == PIXEL_LIGHTING){
+			this->drawLitTriangle(t, this->batch.viewTriangles[i], lights);
+			continue;
+		};
+		
+		this->drawShadedTriangle(t.vertices[0].position.x, t.vertices[0].position.y, t.vertices[1].position.x, t.vertices[1].position.y, t.vertices[2].position.x, t.vertices[2].position.y, t.vertices[0].lightIntensity, t.vertices[1].lightIntensity, t.vertices[2].lightIntensity, t.vertices[0].position.z, t.vertices[1].position.z, t.vertices[2].position.z, t.vertices[0].textureCoord.x, t.vertices[0].textureCoord.y, t.vertices[1].textureCoord.x, t.vertices[1].textureCoord.y, t.vertices[2].textureCoord.x, t.vertices[2].textureCoord.y, t.texture, Pixel(255, 255, 255), Pixel(255, 255, 255), Pixel(255, 255, 255));
+	};
+};
+
+//draw batch
+//runs every stage of the pipeline after the batch has been filled
+void Renderer::drawBatch(LightSet * lights, std::vector<float> * bakedIntensities){
+	this->cullBatch();
+	this->clipBatch();
+	this->lightBatch(lights, bakedIntensities);
+	this->rasteriseBatch(lights);
+};
+
+//get next visible batch triangle
+//returns the index of the first visible triangle at or after index, or the number of triangles if there are none (skipping 32 triangles at a time where none are visible)
+int Renderer::getNextVisibleBatchTriangle(int index){
+	int count = this->batch.screenTriangles.size();
+	
+	while(index < count){
+		uint32_t bits = this->batch.visibility[index / 32] >> (index % 32);
+		
+		if(bits == 0){
+			index = (index / 32 + 1) * 32;
+			continue;
 		};
 		
-		/*
-		//clip triangle against screen plane
-		std::vector<Triangle> clippedTriangles;
-		clippedTriangles.push_back(t);
+		while((bits & 1) == 0){
+			bits >>= 1;
+			index++;
+		};
 		
-		//clip triangle against screen plane
-		//this->clipAgainstScreenPlane(t, &clippedTriangles);
+		return index;
+	};
 		
-	//	this->clipTria
+	return count;
+};
+
+//draw 3d quantized mesh
+//only the given meshlets are drawn
+//the mesh is transformed straight to view space by the model-view transform (and its normals by the matching normal matrix)
+//camera position must be in model space, and mirrored must be set if the transform mirrors the model (see isFacePlaneBackFacing)
+void Renderer::draw3dQuantizedMesh(QuantizedMesh * mesh, std::vector<int> * meshlets, Mat4x4f modelViewTransform, Mat4x4f normalMatrix, Vec4f cameraPosition, bool mirrored, LightSet * lights, std::vector<float> * bakedIntensities){
+	//find the vertex ranges used by the meshlets, merging ranges that overlap so that no vertex is transformed twice
+	this->vertexRanges.clear();
+	for(int i = 0; i < meshlets->size(); i++){
+		Meshlet & meshlet = mesh->meshlets[(*meshlets)[i]];
+		this->vertexRanges.push_back(std::make_pair(meshlet.firstVertex, meshlet.firstVertex + meshlet.vertexCount));
+	};
+	
+	if(this->vertexRanges.size() > 0){
+		std::sort(this->vertexRanges.begin(), this->vertexRanges.end());
 		
-		for(int i = 0; i < clippedTriangles.size(); i++){
-			//project triangle
-			clippedTriangles[i] = this->projectTriangle(clippedTriangles[i]);
+		int merged = 0;
+		for(int i = 1; i < this->vertexRanges.size(); i++){
+			if(this->vertexRanges[i].first <= this->vertexRanges[merged].second){
+				this->vertexRanges[merged].second = std::max(this->vertexRanges[merged].second, this->vertexRanges[i].second);
+			} else {
+				merged++;
+				this->vertexRanges[merged] = this->vertexRanges[i];
+			};
+		};
 		
-			//get rid of triangle if behind camera
-			if(cliooed){
+		this->vertexRanges.resize(merged + 1);
+	};
+	
+	//dequantize and transform each vertex to view space once (rather than once per triangle that uses it)
+	//the ranges do not overlap, so with a job system they can be transformed on every thread at once (the positions are resized and the
+	//transform is combined with the dequantization first, so the jobs only write to their own vertices)
+	int vertexCount = 0;
+	for(int i = 0; i < this->vertexRanges.size(); i++){
+		vertexCount += this->vertexRanges[i].second - this->vertexRanges[i].first;
+	};
+	
+	this->transformedPositions.resize(mesh->vertices.size());
+	Vec4f * transformedPositions = this->transformedPositions.data();
+	Mat4x4f positionTransform = mesh->getPositionTransform(modelViewTransform);
+	
+	if(this->jobSystem != nullptr && vertexCount >= JOB_TRANSFORM_MIN_VERTICES){
+		this->jobSystem->parallelFor(0, this->vertexRanges.size(), JOB_TRANSFORM_GRAIN_SIZE, [this, mesh, transformedPositions, &positionTransform](int first, int last){
+			for(int i = first; i < last; i++){
+				mesh->transformPositions(positionTransform, transformedPositions, this->vertexRanges[i].first, this->vertexRanges[i].second - this->vertexRanges[i].first);
+			};
+		});
+	} else {
+		for(int i = 0; i < this->vertexRanges.size(); i++){
+			mesh->transformPositions(positionTransform, transformedPositions, this->vertexRanges[i].first, this->vertexRanges[i].second - this->vertexRanges[i].first);
+		};
+	};
+	
+	bool objectSpaceCulling = this->backFaceCullingMode == OBJECT_SPACE_BACK_FACE_CULLING && mesh->facePlanes.size() == mesh->getTriangleCount();
+	
+	this->clearBatch();
+	
+	//iterate through meshlets
+	for(int i = 0; i < meshlets->size(); i++){
+		Meshlet & meshlet = mesh->meshlets[(*meshlets)[i]];
 		
-			//convert triangle to pixel space
-			clippedTriangles[i] = this->convertTriangleToPixelSpace(clippedTriangles[i]);
+		//iterate through triangles
+		for(int j = meshlet.firstTriangle; j < meshlet.firstTriangle + meshlet.triangleCount; j++){
+			//skip triangle if it faces away from the camera (before it is assembled, lit and transformed to view space)
+			if(objectSpaceCulling && this->isFacePlaneBackFacing(&mesh->facePlanes[j], cameraPosition, mirrored)){
+				this->statistics.trianglesBackFaceCulled++;
+				continue;
+			};
+			
+			//assemble triangle positions from the index buffer (the other attributes are only needed if the triangle is drawn)
+			Triangle t;
 			
-			//draw triangle
-			//this->drawWireframeTriangle(clippedTriangles[i].vertices[0].position.x, clippedTriangles[i].vertices[0].position.y, clippedTriangles[i].vertices[1].position.x, clippedTriangles[i].vertices[1].position.y, clippedTriangles[i].vertices[2].position.x, clippedTriangles[i].vertices[2].position.y, Pixel(255, 255, 255), Pixel(255, 255, 255), Pixel(255, 255, 255));	
+			for(int k = 0; k < 3; k++){
+				t.vertices[k].position = this->transformedPositions[mesh->indices[j * 3 + k]];
+			};
+			
+			this->addBatchTriangle(t, j);
+		};
+	};
+	
+	this->cullBatch();
+	this->clipBatch();
+	
+	//set up the attributes of triangles that will be drawn (normals are only needed for lighting, so they go in the view space triangle)
+	for(int i = this->getNextVisibleBatchTriangle(0); i < this->batch.screenTriangles.size(); i = this->getNextVisibleBatchTriangle(i + 1)){
+		Triangle & t = this->batch.screenTriangles[i];
+		Triangle & viewTriangle = this->batch.viewTriangles[i];
+		t.texture = mesh->texture;
 		
-			this->drawShadedTriangle(clippedTriangles[i].vertices[0].position.x, clippedTriangles[i].vertices[0].position.y, clippedTriangles[i].vertices[1].position.x, clippedTriangles[i].vertices[1].position.y, clippedTriangles[i].vertices[2].position.x, clippedTriangles[i].vertices[2].position.y, clippedTriangles[i].vertices[0].lightIntensity, clippedTriangles[i].vertices[1].lightIntensity, clippedTriangles[i].vertices[2].lightIntensity, clippedTriangles[i].vertices[0].position.z, clippedTriangles[i].vertices[1].position.z, clippedTriangles[i].vertices[2].position.z, clippedTriangles[i].vertices[0].textureCoord.x, clippedTriangles[i].vertices[0].textureCoord.y, clippedTriangles[i].vertices[1].textureCoord.x, clippedTriangles[i].vertices[1].textureCoord.y, clippedTriangles[i].vertices[2].textureCoord.x, clippedTriangles[i].vertices[2].textureCoord.y, clippedTriangles[i].texture, Pixel(255, 255, 255), Pixel(255, 255, 255), Pixel(255, 255, 255));	
-		};*/
+		for(int k = 0; k < 3; k++){
+			QuantizedVertex & vertex = mesh->vertices[mesh->indices[this->batch.sourceTriangles[i] * 3 + k]];
+			
+			t.vertices[k].textureCoord = mesh->dequantizeTextureCoord(vertex);
+			viewTriangle.vertices[k].normal = Math::matrixProduct(normalMatrix, QuantizedMesh::decodeOctahedralNormal(vertex.normal));
+		};
 	};
+	
+	this->lightBatch(lights, bakedIntensities);
+	this->rasteriseBatch(lights);
 };
 
 //draw 3d mesh
-void Renderer::draw3dModel(Model * model, Camera * camera, std::vector<Light> lights){
-	//calculate model transformation matrix
-	Mat4x4f transform = Math::enlargementMatrix(model->enlargement);
-	transform = Math::matrixProduct(Math::rotationMatrix(model->rotation), transform);
-	transform = Math::matrixProduct(Math::translationMatrix(model->translation), transform);
+//the light set must have been compiled with the camera's transformation matrix
+void Renderer::draw3dModel(Model * model, Camera * camera, LightSet * lights){
+	//calculate model-view transformation, which takes vertices straight from model space to view space
+	//(the camera only recalculates its matrices and frustums when it or the projection has changed)
+	camera->setProjection(this->tanHalfFov, this->window->getAspectRatio(), this->getProjectionPlaneDistance(), this->farDistance);
+	Mat4x4f transform = model->getTransformationMatrix();
+	Mat4x4f viewTransform = camera->getCameraTransformationMatrix();
+	Mat4x4f modelViewTransform = Math::matrixProduct(viewTransform, transform);
+	
+	//move the view frustum into model space, so that mesh bounds can be tested without transforming them
+	Frustum frustum = Frustum::transformFrustum(camera->getViewFrustum(), modelViewTransform);
+	
+	//skip model if it is outside the view frustum (before any vertices are transformed)
+	Bounds & bounds = model->quantizedMesh != nullptr ? model->quantizedMesh->bounds : model->mesh->bounds;
+	if(!this->isBoundsInFrustum(bounds, &frustum)){
+		this->statistics.modelsCulled++;
+		return;
+	};
+	
+	//skip model if it is hidden behind the occluders
+	if(this->occlusionBufferActive && !this->occlusionBuffer.isBoxVisible(bounds.min, bounds.max, modelViewTransform)){
+		this->statistics.modelsOccluded++;
+		return;
+	};
+	
+	this->statistics.modelsDrawn++;
+	
+	if(this->occlusionBufferActive){
+		this->drawnModels.insert(model);
+	};
+	
+	//choose the level of detail from the size of the model on screen
+	int lodCount = 1 + (model->quantizedMesh != nullptr ? model->quantizedMesh->lods.size() : model->mesh->lods.size());
+	model->lod = this->selectLod(model->lod, this->calculateScreenSize(bounds, modelViewTransform), lodCount);
+	
+	//find the camera position in model space, for back-face culling meshlets and triangles
+	Vec4f cameraPosition = Math::matrixProduct(Math::matrixInverse(modelViewTransform), Vec4f(0.0f, 0.0f, 0.0f, 1.0f));
+	
+	//normals are transformed by the transpose of the inverse, scaled to keep them unit length (see Math::normalMatrix)
+	Mat4x4f normalMatrix = Math::normalMatrix(modelViewTransform);
+	
+	//a transform that mirrors the model swaps its front and back faces, which the meshlet normal cones do not account for
+	Vec4f column0(transform.data[0][0], transform.data[1][0], transform.data[2][0], 0.0f);
+	Vec4f column1(transform.data[0][1], transform.data[1][1], transform.data[2][1], 0.0f);
+	Vec4f column2(transform.data[0][2], transform.data[1][2], transform.data[2][2], 0.0f);
+	double determinant = Math::dotProduct(Math::crossProduct(column0, column1), column2);
+	bool backFaceCulling = determinant > 0;
+	bool mirrored = determinant < 0;
+	
+	//light the model with only the point lights that reach its bounding sphere
+	Bounds viewBounds = Mesh::transformBounds(bounds, modelViewTransform);
+	this->assignLights(lights, viewBounds.centre, viewBounds.radius);
 	
-	//calculate view space transformation
+	//static lights are baked into the model's vertices (see notes on static lighting)
+	std::vector<float> * bakedIntensities = model->staticLighting ? this->bakeLighting(model) : nullptr;
+	
+	//draw from the quantized mesh if the model has one
+	if(model->quantizedMesh != nullptr){
+		QuantizedMesh * quantizedMesh = model->lod == 0 ? model->quantizedMesh : &model->quantizedMesh->lods[model->lod - 1];
+		
+		this->cullMeshlets(&quantizedMesh->submeshes, &quantizedMesh->meshlets, &frustum, cameraPosition, backFaceCulling, this->occlusionBufferActive ? &modelViewTransform : nullptr, &this->visibleMeshlets);
+		this->draw3dQuantizedMesh(quantizedMesh, &this->visibleMeshlets, modelViewTransform, normalMatrix, cameraPosition, mirrored, lights, bakedIntensities);
+		return;
+	};
+	
+	Mesh * mesh = model->lod == 0 ? model->mesh : &model->mesh->lods[model->lod - 1];
+	
+	this->cullMeshlets(&mesh->submeshes, &mesh->meshlets, &frustum, cameraPosition, backFaceCulling, this->occlusionBufferActive ? &modelViewTransform : nullptr, &this->visibleMeshlets);
+	
+	bool objectSpaceCulling = this->backFaceCullingMode == OBJECT_SPACE_BACK_FACE_CULLING && mesh->facePlanes.size() == mesh->triangles.size();
+	
+	this->clearBatch();
+	
+	//iterate through meshlets
+	for(int i = 0; i < this->visibleMeshlets.size(); i++){
+		Meshlet & meshlet = mesh->meshlets[this->visibleMeshlets[i]];
+		
+		//iterate through triangles
+		for(int j = meshlet.firstTriangle; j < meshlet.firstTriangle + meshlet.triangleCount; j++){
+			//skip triangle if it faces away from the camera (before it is transformed or lit)
+			if(objectSpaceCulling && this->isFacePlaneBackFacing(&mesh->facePlanes[j], cameraPosition, mirrored)){
+				this->statistics.trianglesBackFaceCulled++;
+				continue;
+			};
+			
+			//transform triangle to view space
+			this->addBatchTriangle(this->transformTriangle(mesh->triangles[j], modelViewTransform, normalMatrix), j);
+		};
+	};
+	
+	//draw triangles
+	this->drawBatch(lights, bakedIntensities);
+};
+
+//draw scene
+//the scene should be updated (after moving models) before it is drawn
+void Renderer::drawScene(Scene * scene, Camera * camera, LightSet * lights){
+	//get the view frustum in world space
+	camera->setProjection(this->tanHalfFov, this->window->getAspectRatio(), this->getProjectionPlaneDistance(), this->farDistance);
+	Frustum frustum = camera->getFrustum();
+	
+	//find models that may be visible (through the portals of the camera's cell, if it is in one)
+	this->visibleModels.clear();
+	scene->queryView(camera->getPosition(), &frustum, &this->visibleModels);
+	
+	this->statistics.cellsVisited += scene->getCellGraph()->getVisitedCellCount();
+	
+	this->statistics.modelsCulled += scene->getModelCount() - this->visibleModels.size();
+	
+	//draw occluders, then draw models (skipping those hidden behind the occluders)
+	if(this->occlusionCulling){
+		this->drawOccluders(&this->visibleModels, camera->getCameraTransformationMatrix());
+		this->occlusionBufferActive = true;
+	};
+	
+	this->drawnModels.clear();
+	
+	for(int i = 0; i < this->visibleModels.size(); i++){
+		this->draw3dModel(this->visibleModels[i], camera, lights);
+	};
+	
+	//the models drawn this frame are used to choose next frame's occluders
+	this->occlusionBufferActive = false;
+	std::swap(this->drawnModels, this->previousDrawnModels);
+};
+
+//draw instanced
+/*
+	Draws many copies of a mesh, each with its own transform. The work draw3dModel does for every model (building the view matrix and
+	frustum, moving the frustum into model space, inverting the model-view matrix for back-face culling, choosing a level of detail and
+	culling meshlets) is either done once for the whole call or not at all:
+		- instances are culled by moving the centre of the mesh's bounding sphere into view space, which is two matrix-vector products
+		- only the camera position is moved into each instance's model space, for culling back-facing meshlets and triangles
+		- the triangles of every visible instance are added to one batch, which goes through the pipeline once
+	This is meant for small meshes drawn many times (ships, projectiles), so meshlets are not frustum culled and levels of detail are
+	not used.
+*/
+void Renderer::drawInstanced(Mesh * mesh, std::vector<InstanceTransform> * instances, Camera * camera, LightSet * lights){
+	camera->setProjection(this->tanHalfFov, this->window->getAspectRatio(), this->getProjectionPlaneDistance(), this->farDistance);
 	Mat4x4f viewTransform = camera->getCameraTransformationMatrix();
+	Frustum frustum = camera->getViewFrustum();
+	Vec4f cameraPosition = camera->getPosition();
+	
+	//cull instances
+	this->visibleInstances.clear();
 	
-	//iterate through triangles
-	for(int i = 0; i < model->mesh->triangles.size(); i++){
-		//draw 3d triangle
-		this->draw3dTriangle(model->mesh->triangles[i], transform, viewTransform, lights);
+	for(int i = 0; i < instances->size(); i++){
+		InstanceTransform & instance = (*instances)[i];
+		Vec4f centre = Math::matrixProduct(viewTransform, Math::matrixProduct(instance.transform, mesh->bounds.centre));
+		
+		if(!frustum.intersectsSphere(centre, mesh->bounds.radius * instance.scale)){
+			continue;
+		};
+		
+		if(this->occlusionBufferActive && !this->occlusionBuffer.isBoxVisible(mesh->bounds.min, mesh->bounds.max, Math::matrixProduct(viewTransform, instance.transform))){
+			this->statistics.modelsOccluded++;
+			continue;
+		};
+		
+		this->visibleInstances.push_back(i);
 	};
+	
+	this->statistics.instancesDrawn += this->visibleInstances.size();
+	this->statistics.instancesCulled += instances->size() - this->visibleInstances.size();
+	
+	//transform the triangles of each visible instance straight to view space
+	bool objectSpaceCulling = this->backFaceCullingMode == OBJECT_SPACE_BACK_FACE_CULLING && mesh->facePlanes.size() == mesh->triangles.size();
+	
+	this->clearBatch();
+	
+	//box around the bounding spheres of the instances in the batch in view space, to assign lights to the whole batch
+	Vec4f batchMin;
+	Vec4f batchMax;
+	int batchInstances = 0;
+	
+	for(int i = 0; i < this->visibleInstances.size(); i++){
+		InstanceTransform & instance = (*instances)[this->visibleInstances[i]];
+		Mat4x4f & transform = instance.transform;
+		Mat4x4f modelViewTransform = Math::matrixProduct(viewTransform, transform);
+		Mat4x4f normalMatrix = Math::normalMatrix(modelViewTransform);
+		
+		Vec4f centre = Math::matrixProduct(modelViewTransform, mesh->bounds.centre);
+		double radius = mesh->bounds.radius * instance.scale;
+		Vec4f min(centre.x - radius, centre.y - radius, centre.z - radius, 1.0f);
+		Vec4f max(centre.x + radius, centre.y + radius, centre.z + radius, 1.0f);
+		
+		if(batchInstances == 0){
+			batchMin = min;
+			batchMax = max;
+		} else {
+			batchMin = Vec4f(fmin(batchMin.x, min.x), fmin(batchMin.y, min.y), fmin(batchMin.z, min.z), 1.0f);
+			batchMax = Vec4f(fmax(batchMax.x, max.x), fmax(batchMax.y, max.y), fmax(batchMax.z, max.z), 1.0f);
+		};
+		batchInstances++;
+		
+		//find the camera position in model space, so back faces can be skipped before they are transformed
+		Vec4f modelCameraPosition = Math::matrixProduct(Math::matrixInverse(transform), cameraPosition);
+		
+		Vec4f column0(transform.data[0][0], transform.data[1][0], transform.data[2][0], 0.0f);
+		Vec4f column1(transform.data[0][1], transform.data[1][1], transform.data[2][1], 0.0f);
+		Vec4f column2(transform.data[0][2], transform.data[1][2], transform.data[2][2], 0.0f);
+		bool mirrored = Math::dotProduct(Math::crossProduct(column0, column1), column2) < 0;
+		
+		//iterate through meshlets
+		for(int j = 0; j < mesh->meshlets.size(); j++){
+			Meshlet & meshlet = mesh->meshlets[j];
+			
+			if(!mirrored && this->isMeshletBackFacing(&meshlet, modelCameraPosition)){
+				this->statistics.meshletsBackFaceCulled++;
+				continue;
+			};
+			
+			//iterate through triangles
+			for(int k = meshlet.firstTriangle; k < meshlet.firstTriangle + meshlet.triangleCount; k++){
+				if(objectSpaceCulling && this->isFacePlaneBackFacing(&mesh->facePlanes[k], modelCameraPosition, mirrored)){
+					this->statistics.trianglesBackFaceCulled++;
+					continue;
+				};
+				
+				this->addBatchTriangle(this->transformTriangle(mesh->triangles[k], modelViewTransform, normalMatrix), k);
+			};
+		};
+		
+		if(this->batch.viewTriangles.size() >= INSTANCE_BATCH_SIZE){
+			this->assignLights(lights, batchMin, batchMax);
+			this->drawBatch(lights, nullptr);
+			this->clearBatch();
+			batchInstances = 0;
+		};
+	};
+	
+	if(batchInstances > 0){
+		this->assignLights(lights, batchMin, batchMax);
+		this->drawBatch(lights, nullptr);
+	};
+};
+
+//draw occluders
+//clears the occlusion buffer, and draws the models marked as occluders and the largest models drawn last frame into it
+void Renderer::drawOccluders(std::vector<Model *> * models, Mat4x4f viewTransform){
+	this->occlusionBuffer.clear(this->tanHalfFov, this->window->getAspectRatio(), this->getProjectionPlaneDistance());
+	this->occlusionViewTransform = viewTransform;
+	
+	//choose occluders
+	this->occluders.clear();
+	
+	for(int i = 0; i < models->size(); i++){
+		Model * model = (*models)[i];
+		double screenSize = this->calculateScreenSize(model->mesh->bounds, Math::matrixProduct(viewTransform, model->getTransformationMatrix()));
+		
+		if(model->occluder || (screenSize >= OCCLUSION_OCCLUDER_SCREEN_SIZE && this->previousDrawnModels.count(model) > 0)){
+			this->occluders.push_back(std::make_pair(screenSize, model));
+		};
+	};
+	
+	//models marked as occluders come first, then the largest on screen
+	std::sort(this->occluders.begin(), this->occluders.end(), [](const std::pair<double, Model *> & a, const std::pair<double, Model *> & b){
+		if(a.second->occluder != b.second->occluder){
+			return a.second->occluder;
+		};
+		
+		return a.first > b.first;
+	});
+	
+	//draw occluders
+	for(int i = 0; i < this->occluders.size() && i < OCCLUSION_MAX_OCCLUDERS; i++){
+		Model * model = this->occluders[i].second;
+		Mesh * mesh = model->occluderMesh != nullptr ? model->occluderMesh : model->mesh;
+		
+		this->occlusionBuffer.drawOccluder(mesh, Math::matrixProduct(viewTransform, model->getTransformationMatrix()));
+	};
+	
+	this->statistics.occluderTriangles += this->occlusionBuffer.getOccluderTriangleCount();
+};
+
+//check if world space box may be visible
+//uses the occlusion buffer from the last drawScene, so game code can skip work for objects hidden behind occluders
+bool Renderer::isBoxVisible(Vec4f min, Vec4f max){
+	return this->isBoxVisible(min, max, Math::identityMatrix());
+};
+
+//check if box may be visible (transform maps the box's space to world space)
+bool Renderer::isBoxVisible(Vec4f min, Vec4f max, Mat4x4f transform){
+	return this->occlusionBuffer.isBoxVisible(min, max, Math::matrixProduct(this->occlusionViewTransform, transform));
+};
+
+//get occlusion buffer
+OcclusionBuffer * Renderer::getOcclusionBuffer(){
+	return &this->occlusionBuffer;
+};
+
+//get view frustum
+//this is the volume that the triangle pipeline draws triangles in, in view space
+Frustum Renderer::getViewFrustum(){
+	return Frustum::createViewFrustum(this->tanHalfFov, this->window->getAspectRatio(), this->getProjectionPlaneDistance(), this->farDistance);
+};
+
+//check if bounds are in frustum
+//the sphere is tested first, as it is cheaper and rejects most bounds that are well outside the frustum
+bool Renderer::isBoundsInFrustum(Bounds bounds, Frustum * frustum){
+	return frustum->intersectsSphere(bounds.centre, bounds.radius) && frustum->intersectsBox(bounds.min, bounds.max);
+};
+
+//check if meshlet is back-facing
+/*
+	A triangle is back-facing if its front face points away from the camera, i.e. the angle between its normal and the direction from the
+	camera to the triangle is 90 degrees or less. For every normal within the cone (half angle a) to point away from the camera, the
+	direction to the camera must be within 90 - a degrees of the cone axis, so dot(direction, axis) >= cos(90 - a) = sin(a) = coneCutoff.
+	This must hold from every point in the bounding sphere, which moves the dot product and the distance by at most the radius.
+*/
+bool Renderer::isMeshletBackFacing(Meshlet * meshlet, Vec4f cameraPosition){
+	if(meshlet->coneCutoff >= 1){
+		return false;
+	};
+	
+	Vec4f direction = meshlet->centre - cameraPosition;
+	return Math::dotProduct(direction, meshlet->coneAxis) >= meshlet->coneCutoff * Math::magnitude(direction) + meshlet->radius * (1 + meshlet->coneCutoff);
+};
+
+//check if triangle is back-facing from its face plane
+/*
+	A triangle is drawn if its front face points towards the camera, i.e. the camera is in front of the triangle's plane. The model
+	transform keeps points on the same side of the plane, so this can be tested in object space with the camera moved into object space,
+	without transforming the triangle. A transform that mirrors the model (negative determinant) turns the triangle over, so the test is
+	reversed.
+*/
+bool Renderer::isFacePlaneBackFacing(Plane * facePlane, Vec4f cameraPosition, bool mirrored){
+	double distance = Math::dotProduct(facePlane->normal, cameraPosition) + facePlane->distance;
+	
+	return mirrored ? distance >= 0 : distance <= 0;
+};
+
+//calculate screen size
+//the width of the bounding sphere on screen as a fraction of the screen width (1 if the camera is inside the sphere)
+double Renderer::calculateScreenSize(Bounds bounds, Mat4x4f modelViewTransform){
+	Bounds viewBounds = Mesh::transformBounds(bounds, modelViewTransform);
+	
+	if(viewBounds.centre.z <= viewBounds.radius){
+		return 1;
+	};
+	
+	return viewBounds.radius / (viewBounds.centre.z * this->tanHalfFov);
+};
+
+//select level of detail
+int Renderer::selectLod(int currentLod, double screenSize, int lodCount){
+	int lod = currentLod < 0 ? 0 : (currentLod >= lodCount ? lodCount - 1 : currentLod);
+	
+	//move to a simpler level while the model is well below the size the current level is drawn down to
+	while(lod + 1 < lodCount && screenSize < LOD_SCREEN_SIZE * pow(LOD_SCREEN_SIZE_RATIO, lod) * (1 - LOD_HYSTERESIS)){
+		lod++;
+	};
+	
+	//move to a more detailed level while the model is well above the size the next level up is drawn down to
+	while(lod > 0 && screenSize > LOD_SCREEN_SIZE * pow(LOD_SCREEN_SIZE_RATIO, lod - 1) * (1 + LOD_HYSTERESIS)){
+		lod--;
+	};
+	
+	return lod;
+};
+
+//cull meshlets
+//frustum and camera position must be in model space, the indices of meshlets that may be visible are written to visibleMeshlets
+//if occlusionTransform is set, meshlets are also tested against the occlusion buffer (it must map model space to view space)
+void Renderer::cullMeshlets(std::vector<Submesh> * submeshes, std::vector<Meshlet> * meshlets, Frustum * frustum, Vec4f cameraPosition, bool backFaceCulling, Mat4x4f * occlusionTransform, std::vector<int> * visibleMeshlets){
+	visibleMeshlets->clear();
+	
+	//iterate through submeshes
+	for(int i = 0; i < submeshes->size(); i++){
+		Submesh & submesh = (*submeshes)[i];
+		
+		//skip submesh if it is outside the view frustum
+		if(!this->isBoundsInFrustum(submesh.bounds, frustum)){
+			this->statistics.submeshesCulled++;
+			continue;
+		};
+		
+		this->statistics.submeshesDrawn++;
+		
+		//iterate through meshlets
+		for(int j = submesh.firstMeshlet; j < submesh.firstMeshlet + submesh.meshletCount; j++){
+			Meshlet & meshlet = (*meshlets)[j];
+			Vec4f extent(meshlet.radius, meshlet.radius, meshlet.radius, 0.0f);
+			
+			if(!frustum->intersectsSphere(meshlet.centre, meshlet.radius)){
+				this->statistics.meshletsFrustumCulled++;
+			} else if(backFaceCulling && this->isMeshletBackFacing(&meshlet, cameraPosition)){
+				this->statistics.meshletsBackFaceCulled++;
+			} else if(occlusionTransform != nullptr && !this->occlusionBuffer.isBoxVisible(meshlet.centre - extent, meshlet.centre + extent, *occlusionTransform)){
+				this->statistics.meshletsOccluded++;
+			} else {
+				this->statistics.meshletsDrawn++;
+				visibleMeshlets->push_back(j);
+			};
+		};
+	};
+};
+
+//get statistics
+RenderStatistics Renderer::getStatistics(){
+	return this->statistics;
+};
+
+//reset statistics
+void Renderer::resetStatistics(){
+	this->statistics.modelsDrawn = 0;
+	this->statistics.modelsCulled = 0;
+	this->statistics.submeshesDrawn = 0;
+	this->statistics.submeshesCulled = 0;
+	this->statistics.meshletsDrawn = 0;
+	this->statistics.meshletsFrustumCulled = 0;
+	this->statistics.meshletsBackFaceCulled = 0;
+	this->statistics.trianglesBackFaceCulled = 0;
+	this->statistics.modelsOccluded = 0;
+	this->statistics.meshletsOccluded = 0;
+	this->statistics.occluderTriangles = 0;
+	this->statistics.cellsVisited = 0;
+	this->statistics.instancesDrawn = 0;
+	this->statistics.instancesCulled = 0;
+	this->statistics.pointLightsAssigned = 0;
+	this->statistics.pointLightsCulled = 0;
+	this->statistics.modelsBaked = 0;
 };
 
 //getters
@@ -779,8 +1775,75 @@ double Renderer::getProjectionPlaneDistance(){
 	return this->tanHalfFov;
 };
 
+int Renderer::getBackFaceCullingMode(){
+	return this->backFaceCullingMode;
+};
+
+int Renderer::getLightingMode(){
+	return this->lightingMode;
+};
+
+bool Renderer::getOcclusionCulling(){
+	return this->occlusionCulling;
+};
+
+JobSystem * Renderer::getJobSystem(){
+	return this->jobSystem;
+};
+
+double Renderer::getFarDistance(){
+	return this->farDistance;
+};
+
+int Renderer::getFogMode(){
+	return this->fogMode;
+};
+
 //setters
 void Renderer::setFov(double fov){
 	this->fov = fov;
 	this->tanHalfFov = tan(this->fov / 2);
+};
+
+void Renderer::setBackFaceCullingMode(int mode){
+	this->backFaceCullingMode = mode;
+};
+
+void Renderer::setLightingMode(int mode){
+	this->lightingMode = mode;
+};
+
+void Renderer::setOcclusionCulling(bool occlusionCulling){
+	this->occlusionCulling = occlusionCulling;
+};
+
+void Renderer::setJobSystem(JobSystem * jobSystem){
+	this->jobSystem = jobSystem;
+};
+
+//set far distance
+//the depth buffer is cleared to the far distance from the next time the screen is cleared
+void Renderer::setFarDistance(double farDistance){
+	this->farDistance = farDistance;
+	this->window->setClearDepth(farDistance > 0 ? farDistance : DBL_MAX);
+};
+
+//set fog
+//builds the fog table (see notes on the far plane and fog)
+void Renderer::setFog(int mode, Pixel colour, double start, double end){
+	this->fogMode = mode;
+	this->fogColour = colour;
+	this->fogStart = start;
+	this->fogScale = end > start ? (FOG_TABLE_SIZE - 1) / (end - start) : 0;
+	this->fogTable.resize(FOG_TABLE_SIZE);
+	
+	for(int i = 0; i < FOG_TABLE_SIZE; i++){
+		double t = (double) i / (FOG_TABLE_SIZE - 1);
+		
+		//exponential fog leaves 1 / 256 of the colour at the end distance
+		this->fogTable[i] = (float) (mode == EXPONENTIAL_FOG ? exp(-log(256.0) * t) : 1 - t);
+	};
+	
+	//everything at or beyond the end is fully fogged
+	this->fogTable[FOG_TABLE_SIZE - 1] = 0;
 };
\ No newline at end of file
@@ -7,23 +7,171 @@
 #include "Model.hpp"
 #include "Camera.hpp"
 #include "Bitmap.hpp"
+#include "Frustum.hpp"
+#include "Scene.hpp"
+#include "OcclusionBuffer.hpp"
+#include "LightSet.hpp"
+#include "JobSystem.hpp"
 #include <math.h> 
+#include <algorithm>
+#include <unordered_set>
+#include <assert.h>
 
-//light types enumeration
-enum LIGHT_TYPES {
-	AMBIENT_LIGHT=0,
-	DIRECTIONAL_LIGHT,
-	POINT_LIGHT
+//back-face culling modes enumeration
+//object space culling tests each triangle against its face plane before it is transformed or lit, view space culling only tests it after
+enum BACK_FACE_CULLING_MODES {
+	VIEW_SPACE_BACK_FACE_CULLING=0,
+	OBJECT_SPACE_BACK_FACE_CULLING
 };
 
-//light structure
-struct Light {
-	int type;
-	Vec4f position;
-	Vec4f direction;
-	double intensity;
+//lighting modes enumeration
+//vertex lighting lights each vertex and interpolates the intensity across the triangle, pixel lighting lights every pixel (see notes on per-pixel lighting)
+enum LIGHTING_MODES {
+	VERTEX_LIGHTING=0,
+	PIXEL_LIGHTING
+};
+
+//fog modes enumeration
+//linear fog thickens evenly from the fog's start distance to its end, exponential fog thickens quickly at first and then more slowly (see notes on the far plane and fog)
+enum FOG_MODES {
+	NO_FOG=0,
+	LINEAR_FOG,
+	EXPONENTIAL_FOG
+};
+
+//number of entries in the fog table, from the fog's start distance to its end
+#define FOG_TABLE_SIZE 1024
+
+//per-pixel lighting interpolates 1 / depth, the baked intensity, the texture coordinates and the view space normal divided by depth
+#define PIXEL_ATTRIBUTE_COUNT 7
+
+//levels of detail
+//a model is drawn at full detail while its bounding sphere is at least LOD_SCREEN_SIZE of the screen width across, and one level
+//simpler each time its size falls by LOD_SCREEN_SIZE_RATIO (each level has half the triangles, so this keeps roughly the same
+//number of triangles per pixel) - it must move LOD_HYSTERESIS past a switching size before the level changes, so it does not flicker
+#define LOD_SCREEN_SIZE 0.5
+#define LOD_SCREEN_SIZE_RATIO 0.7071
+#define LOD_HYSTERESIS 0.1
+
+//occlusion culling
+//besides models marked as occluders, the models drawn last frame that are at least OCCLUSION_OCCLUDER_SCREEN_SIZE of the screen width
+//across are drawn into the occlusion buffer (the largest first, up to OCCLUSION_MAX_OCCLUDERS in total)
+#define OCCLUSION_OCCLUDER_SCREEN_SIZE 0.25
+#define OCCLUSION_MAX_OCCLUDERS 8
+
+//with a job system, the vertices of a quantized mesh are transformed on every thread once there are at least this many to transform
+//(each job transforms the vertex ranges of at least JOB_TRANSFORM_GRAIN_SIZE meshlets)
+#define JOB_TRANSFORM_MIN_VERTICES 4096
+#define JOB_TRANSFORM_GRAIN_SIZE 8
+
+//drawInstanced draws the batch whenever it holds this many triangles, so it stays small enough to be cached however many instances there are
+#define INSTANCE_BATCH_SIZE 2048
+
+//render statistics
+struct RenderStatistics {
+	int modelsDrawn;
+	int modelsCulled;
+	int submeshesDrawn;
+	int submeshesCulled;
+	int meshletsDrawn;
+	int meshletsFrustumCulled;
+	int meshletsBackFaceCulled;
+	int trianglesBackFaceCulled;
+	int modelsOccluded;
+	int meshletsOccluded;
+	int occluderTriangles;
+	int cellsVisited;
+	int instancesDrawn;
+	int instancesCulled;
+	int pointLightsAssigned;
+	int pointLightsCulled;
+	int modelsBaked;
+};
+
+/*
+	Notes about the triangle pipeline:
+	The triangles of a mesh are drawn in batches, one stage at a time:
+		transform - the caller fills the batch with view space triangles, transformed straight from model space by the model-view matrix
+			(so each vertex takes one matrix product, and one more for its normal, by the normal matrix found once per model)
+		cull - back-facing triangles are removed
+		clip - triangles behind the near plane, beyond the far plane or outside the screen are removed (there is no proper clipping yet,
+			so triangles crossing the near plane are removed as well) and the rest are projected
+		light - lighting is applied to the triangles that are left
+		rasterise - the triangles that are left are drawn
+	Lighting is done in view space as well, with a light set compiled into view space once per frame, so world space is never needed.
 	
-	Light(int type, Vec4f position, Vec4f direction, double intensity) : type(type), position(position), direction(direction), intensity(intensity) {};
+	Each stage only works on the triangles that survived the stages before it, which are tracked with one bit per triangle. Lighting is
+	the most expensive stage per vertex, so running it last means it is not wasted on triangles that are never drawn. Attributes that
+	are only needed for drawing (e.g. dequantized texture coordinates) can be set up after clipping in the same way.
+*/
+
+/*
+	Notes about static lighting:
+	Most of a level and the lights that light it do not move, so lighting it every frame recalculates the same intensities. Lights
+	given to setStaticLights are compiled once in world space, and baked into the vertices of models marked with staticLighting: the
+	intensity they give each corner of each triangle is stored in the model, for the level of detail that is being drawn. The lights
+	passed in when drawing (the dynamic lights) are still lit every frame, and added on top of the baked intensity.
+	
+	Only diffuse lighting is done, which does not depend on where it is seen from, so baked lighting is the same from any camera. It is
+	baked again whenever the static lights change (which setStaticLights detects by comparing them with the ones it was last given,
+	including the versions of their shadow maps, so the shadows of static lights follow casters that move), the model's world matrix
+	changes (its world version) or the mesh no longer has as many triangle corners as were baked (e.g. the asset loader has replaced a
+	placeholder with the loaded mesh), and each level of detail is baked the first time it is drawn. Both kinds of lighting are clamped
+	to 0 to 1 and never negative, so adding the clamped intensities and clamping again is the same as clamping the total. When there are
+	no dynamic directional or point lights, lighting a statically lit model only adds the baked intensities.
+	
+	Baked lighting is stored in the model rather than the mesh, as it depends on where the model is (models that share a mesh are lit
+	differently).
+*/
+
+/*
+	Notes about per-pixel lighting:
+	Vertex lighting only finds the intensity at the corners of each triangle, so a point light close to the middle of a large triangle
+	is missed, and its light spreads across the whole triangle. With PIXEL_LIGHTING, the light set is evaluated at every pixel instead,
+	with the view space position and normal of the surface at that pixel:
+		- the position is found from the pixel's coordinates and depth, by undoing the projection (so nothing extra is interpolated)
+		- the normal is interpolated as normal / depth, which is linear in screen space like 1 / depth, so the interpolation is
+			perspective correct. Dividing the normal by depth does not change its direction, and it is normalised at each pixel anyway
+	Each row of a triangle is drawn in two passes: the pixels that pass the depth test are gathered into a lighting batch, which is lit
+	four pixels at a time by the same SSE code that lights vertices (see notes on light sets), and the lit pixels are then drawn. Pixels
+	that are hidden are never lit. Baked lighting is still interpolated from the vertices, and added to the lighting at each pixel.
+	
+	This costs as much as lighting a vertex for every visible pixel, so it is worth it for large triangles near lights, rather than for
+	dense meshes (which look about the same with vertex lighting).
+*/
+
+/*
+	Notes about the far plane and fog:
+	Without a far plane, everything in front of the camera is drawn however far away it is, so the cost of an open level (e.g. terrain
+	that goes on to the horizon) grows with its size. setFarDistance adds a far plane to the view frustum, so everything the frustum is
+	tested against is culled by distance as well: models (draw3dModel and scene queries, including through portals), submeshes and
+	meshlets, and instances. Triangles entirely beyond the far plane are removed when the batch is clipped, and the depth buffer is
+	cleared to the far distance, so the pixels of triangles that cross it are not drawn either. A far distance of 0 means there is no
+	far plane, and the depth buffer is cleared to the largest double.
+	
+	Fog hides the edge at the far plane, by blending each pixel towards the fog colour by its depth: fully visible at the fog's start
+	distance, and fully fogged at its end (which should be the far distance, if there is one). Exponential fog would only reach the fog
+	colour at infinity, so its density is chosen so that it is less than one step of 8-bit colour from it at the end distance. Both
+	modes are looked up in a table of FOG_TABLE_SIZE entries between the start and end, built when the fog is set, so a fogged pixel
+	costs a multiply and a lookup whichever mode is used. Depth is the distance along the view direction rather than from the camera,
+	which is what the rasteriser already has for every pixel.
+*/
+
+//triangle batch
+struct TriangleBatch {
+	std::vector<Triangle> viewTriangles; //view space triangles (used for culling, clipping and lighting)
+	std::vector<Triangle> screenTriangles; //projected triangles (used for drawing)
+	std::vector<int> sourceTriangles; //index of each triangle in the mesh it came from
+	std::vector<uint32_t> visibility; //bit i is set while triangle i is still visible
+};
+
+//lit pixel
+//a pixel of a row being lit per pixel, waiting for its lighting
+struct LitPixel {
+	int x;
+	double depth;
+	Pixel colour;
+	float bakedIntensity;
 };
 
 //declare class
@@ -42,10 +190,17 @@ class Renderer {
 		//draw triangle
 		void drawWireframeTriangle(int x1, int y1, int x2, int y2, int x3, int y3, Pixel c1, Pixel c2, Pixel c3);
 		void drawHorizontalLine(int x1, int x2, int y, double i1, double i2, double invD1, double invD2, double tx1, double tx2, double ty1, double ty2, Bitmap * bmp, Pixel c1, Pixel c2);
+		
+		//draw pixel lit by an intensity, and fogged by its depth (see notes on the far plane and fog)
+		void drawShadedPixel(int x, int y, double depth, Pixel colour, double intensity);
 
 		//void drawHorizontalLine(int x1, int x2, int y, double i1, double i2, double invD1, double invD2, Pixel c1, Pixel c2);
 		//void drawShadedTriangle(int x1, int y1, int x2, int y2, int x3, int y3, double i1, double i2, double i3, double d1, double d2, double d3, Pixel c1, Pixel c2, Pixel c3);
 		void drawShadedTriangle(int x1, int y1, int x2, int y2, int x3, int y3, double i1, double i2, double i3, double d1, double d2, double d3, double tx1, double ty1, double tx2, double ty2, double tx3, double ty3, Bitmap * bmp, Pixel c1, Pixel c2, Pixel c3);
+		
+		//draw triangle lit per pixel (t is in pixel space, and viewTriangle is the same triangle in view space, see notes on per-pixel lighting)
+		void drawLitTriangle(Triangle t, Triangle viewTriangle, LightSet * lights);
+		void drawLitHorizontalLine(int x1, int x2, int y, double * attributes1, double * attributes2, Bitmap * bmp, LightSet * lights);
 
 		//draw rectangle
 		void drawRectangle(int left, int top, int right, int bottom, uint8_t red, uint8_t green, uint8_t blue);
@@ -55,10 +210,11 @@ class Renderer {
 		
 		//3d model functions
 		Triangle transformTriangle(Triangle t, Mat4x4f transform);
+		Triangle transformTriangle(Triangle t, Mat4x4f transform, Mat4x4f normalMatrix);
 		bool cullBackFace(Triangle triangle);
 		Triangle convertTriangleToPixelSpace(Triangle triangle);
-		Vertex Renderer::shadeVertex(Vertex vertex, Vec4f normal, std::vector<Light> lights);
-		Triangle Renderer::applyLighting(Triangle triangle, std::vector<Light> lights);
+		Vertex shadeVertex(Vertex vertex, Vec4f normal, LightSet * lights);
+		Triangle applyLighting(Triangle triangle, LightSet * lights);
 		int clipTriangleAgainstPlane(Triangle triangle, Vec4f planePos, Vec4f planeNormal, Triangle * clippedTriangle1, Triangle * clippedTriangle2);
 		void clipAgainstScreenPlane(Triangle triangle, std::vector<Triangle> * clippedTriangles);
 		void clipAgainstTopPlane(Triangle triangle, std::vector<Triangle> * clippedTriangles);
@@ -66,21 +222,107 @@ class Renderer {
 		void clipAgainstLeftPlane(Triangle triangle, std::vector<Triangle> * clippedTriangles);
 		void clipAgainstRightPlane(Triangle triangle, std::vector<Triangle> * clippedTriangles);
 		Triangle projectTriangle(Triangle triangle);
-		void draw3dTriangle(Triangle t, Mat4x4f transform, Mat4x4f viewTransform, std::vector<Light> lights);
-		void draw3dModel(Model * model, Camera * camera, std::vector<Light> lights);
+		void draw3dTriangle(Triangle t, Mat4x4f transform, Mat4x4f viewTransform, LightSet * lights);
+		void drawWorldSpaceTriangle(Triangle t, Mat4x4f viewTransform, LightSet * lights);
+		void draw3dQuantizedMesh(QuantizedMesh * mesh, std::vector<int> * meshlets, Mat4x4f modelViewTransform, Mat4x4f normalMatrix, Vec4f cameraPosition, bool mirrored, LightSet * lights, std::vector<float> * bakedIntensities);
+		void draw3dModel(Model * model, Camera * camera, LightSet * lights);
+		void drawScene(Scene * scene, Camera * camera, LightSet * lights);
+		void drawInstanced(Mesh * mesh, std::vector<InstanceTransform> * instances, Camera * camera, LightSet * lights);
+		
+		//triangle pipeline (see notes on the triangle pipeline)
+		void clearBatch();
+		void addBatchTriangle(Triangle viewTriangle, int sourceTriangle);
+		void cullBatch();
+		void clipBatch();
+		void lightBatch(LightSet * lights, std::vector<float> * bakedIntensities);
+		void rasteriseBatch(LightSet * lights);
+		void drawBatch(LightSet * lights, std::vector<float> * bakedIntensities);
+		int getNextVisibleBatchTriangle(int index);
+		
+		//light assignment (see notes on light sets)
+		void assignLights(LightSet * lights, Vec4f centre, double radius);
+		void assignLights(LightSet * lights, Vec4f min, Vec4f max);
+		
+		//static lighting (see notes on static lighting)
+		void setStaticLights(std::vector<Light> * lights);
+		std::vector<float> * bakeLighting(Model * model);
+		
+		//culling
+		Frustum getViewFrustum();
+		bool isBoundsInFrustum(Bounds bounds, Frustum * frustum);
+		bool isMeshletBackFacing(Meshlet * meshlet, Vec4f cameraPosition);
+		bool isFacePlaneBackFacing(Plane * facePlane, Vec4f cameraPosition, bool mirrored);
+		
+		//levels of detail
+		double calculateScreenSize(Bounds bounds, Mat4x4f modelViewTransform);
+		int selectLod(int currentLod, double screenSize, int lodCount);
+		void cullMeshlets(std::vector<Submesh> * submeshes, std::vector<Meshlet> * meshlets, Frustum * frustum, Vec4f cameraPosition, bool backFaceCulling, Mat4x4f * occlusionTransform, std::vector<int> * visibleMeshlets);
+		
+		//occlusion culling (see notes on occlusion culling)
+		//drawScene fills the occlusion buffer before drawing, and the buffer is kept until the next drawScene so game code can query it
+		void drawOccluders(std::vector<Model *> * models, Mat4x4f viewTransform);
+		bool isBoxVisible(Vec4f min, Vec4f max);
+		bool isBoxVisible(Vec4f min, Vec4f max, Mat4x4f transform);
+		OcclusionBuffer * getOcclusionBuffer();
+		
+		//statistics (counts accumulate until they are reset, e.g. once per frame)
+		RenderStatistics getStatistics();
+		void resetStatistics();
 	
 		//getters
 		double getFov();
 		double getProjectionPlaneDistance();
+		int getBackFaceCullingMode();
+		int getLightingMode();
+		bool getOcclusionCulling();
+		JobSystem * getJobSystem();
+		double getFarDistance();
+		int getFogMode();
 		
 		//setters
 		void setFov(double fov);
+		void setBackFaceCullingMode(int mode);
+		void setLightingMode(int mode);
+		void setOcclusionCulling(bool occlusionCulling);
+		void setJobSystem(JobSystem * jobSystem); //nullptr to do everything on the calling thread
+		void setFarDistance(double farDistance); //0 for no far plane
+		void setFog(int mode, Pixel colour, double start, double end);
 	
 	private:
 		//data members
 		Window * window;
 		double fov;
 		double tanHalfFov;
+		int backFaceCullingMode;
+		int lightingMode;
+		JobSystem * jobSystem;
+		double farDistance;
+		int fogMode;
+		Pixel fogColour;
+		double fogStart;
+		double fogScale; //fog table entries per unit of depth
+		std::vector<float> fogTable; //fraction of a pixel's own colour left after fogging, from the start distance to the end
+		std::vector<Vec4f> transformedPositions;
+		RenderStatistics statistics;
+		std::vector<Model *> visibleModels;
+		std::vector<int> visibleMeshlets;
+		std::vector<int> visibleInstances;
+		std::vector<std::pair<int, int>> vertexRanges;
+		TriangleBatch batch;
+		VertexLightingBatch vertexLighting;
+		VertexLightingBatch pixelLighting;
+		std::vector<LitPixel> litPixels;
+		std::vector<Light> staticLights;
+		std::vector<int> staticShadowMapVersions; //version of each static light's shadow map when it was last compiled
+		LightSet staticLightSet; //static lights in world space
+		int staticLightingVersion; //incremented whenever the static lights change
+		OcclusionBuffer occlusionBuffer;
+		bool occlusionCulling;
+		bool occlusionBufferActive; //set while drawScene is drawing, after the occluders have been drawn
+		Mat4x4f occlusionViewTransform; //view transform of the camera the occlusion buffer was drawn from
+		std::unordered_set<Model *> drawnModels; //models drawn by drawScene this frame
+		std::unordered_set<Model *> previousDrawnModels; //models drawn by drawScene last frame
+		std::vector<std::pair<double, Model *>> occluders;
 };
 
 #endif
\ No newline at end of file
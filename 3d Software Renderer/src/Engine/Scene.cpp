@@ -0,0 +1,376 @@
+//Scene.cpp
+
+#include "Scene.hpp"
+
+//constructor
+Scene::Scene(){
+	this->rebuildNeeded = true;
+	this->builtCost = 0;
+};
+
+//add model
+void Scene::addModel(Model * model){
+	this->models.push_back(model);
+	this->rebuildNeeded = true;
+};
+
+//remove model
+void Scene::removeModel(Model * model){
+	for(int i = 0; i < this->models.size(); i++){
+		if(this->models[i] == model){
+			this->models.erase(this->models.begin() + i);
+			this->rebuildNeeded = true;
+			
+			//models after this one have moved down, so their bounds are recalculated by the next update
+			this->modelVersions.assign(this->models.size(), -1);
+			return;
+		};
+	};
+};
+
+//clear
+void Scene::clear(){
+	this->models.clear();
+	this->rebuildNeeded = true;
+	
+	//forget the bounds of the old models, so models added later are not matched against them
+	this->modelBounds.clear();
+	this->modelVersions.clear();
+	this->meshBounds.clear();
+	this->nodes.clear();
+};
+
+//update
+void Scene::update(){
+	//calculate world bounds of each model that has moved since the last update, or whose mesh has changed (e.g. a placeholder being
+	//replaced by the loaded mesh)
+	bool moved = false;
+	this->modelBounds.resize(this->models.size());
+	this->modelVersions.resize(this->models.size(), -1);
+	this->meshBounds.resize(this->models.size());
+	
+	for(int i = 0; i < this->models.size(); i++){
+		Model * model = this->models[i];
+		int version = model->getWorldVersion();
+		Bounds & bounds = model->mesh->bounds;
+		Bounds & previousBounds = this->meshBounds[i];
+		
+		if(version != this->modelVersions[i] || bounds.min.x != previousBounds.min.x || bounds.min.y != previousBounds.min.y || bounds.min.z != previousBounds.min.z || bounds.max.x != previousBounds.max.x || bounds.max.y != previousBounds.max.y || bounds.max.z != previousBounds.max.z || bounds.radius != previousBounds.radius){
+			this->modelBounds[i] = Mesh::transformBounds(bounds, model->getTransformationMatrix());
+			this->modelVersions[i] = version;
+			this->meshBounds[i] = bounds;
+			moved = true;
+		};
+	};
+	
+	//rebuild if models have been added or removed
+	if(this->rebuildNeeded){
+		this->rebuild();
+		return;
+	};
+	
+	//the tree does not change if nothing has moved
+	if(!moved){
+		return;
+	};
+	
+	//refit, then rebuild if the tree has got too much worse
+	this->refit();
+	
+	if(this->calculateCost() > this->builtCost * SCENE_BVH_REBUILD_THRESHOLD){
+		this->rebuild();
+	};
+};
+
+//rebuild tree
+void Scene::rebuild(){
+	this->rebuildNeeded = false;
+	this->nodes.clear();
+	this->modelOrder.resize(this->models.size());
+	
+	for(int i = 0; i < this->models.size(); i++){
+		this->modelOrder[i] = i;
+	};
+	
+	//bounds are only known after update (rebuild is called again from there)
+	if(this->models.size() == 0 || this->modelBounds.size() != this->models.size()){
+		this->rebuildNeeded = this->models.size() > 0;
+		return;
+	};
+	
+	//a binary tree with one model per leaf has 2n - 1 nodes, so this is always enough
+	this->nodes.reserve(this->models.size() * 2);
+	this->nodes.push_back(Node());
+	this->buildNode(0, 0, this->models.size());
+	
+	this->builtCost = this->calculateCost();
+};
+
+//query frustum
+void Scene::queryFrustum(Frustum * frustum, std::vector<Model *> * visibleModels){
+	if(this->nodes.size() == 0){
+		return;
+	};
+	
+	this->stack.clear();
+	this->stack.push_back(0);
+	
+	while(this->stack.size() > 0){
+		Node & node = this->nodes[this->stack.back()];
+		this->stack.pop_back();
+		
+		//skip subtree if it is outside the frustum
+		if(!frustum->intersectsBox(node.min, node.max)){
+			continue;
+		};
+		
+		//add every model in the subtree without further tests if it is entirely inside the frustum
+		if(frustum->containsBox(node.min, node.max)){
+			for(int i = node.firstModel; i < node.firstModel + node.modelCount; i++){
+				visibleModels->push_back(this->models[this->modelOrder[i]]);
+			};
+			continue;
+		};
+		
+		if(node.firstChild == -1){
+			//test each model in the leaf
+			for(int i = node.firstModel; i < node.firstModel + node.modelCount; i++){
+				Bounds & bounds = this->modelBounds[this->modelOrder[i]];
+				
+				if(frustum->intersectsBox(bounds.min, bounds.max)){
+					visibleModels->push_back(this->models[this->modelOrder[i]]);
+				};
+			};
+		} else {
+			this->stack.push_back(node.firstChild);
+			this->stack.push_back(node.firstChild + 1);
+		};
+	};
+};
+
+//query view
+void Scene::queryView(Vec4f cameraPosition, Frustum * frustum, std::vector<Model *> * visibleModels){
+	int firstModel = visibleModels->size();
+	this->outsideFrustums.clear();
+	
+	if(!this->cellGraph.queryFrustum(cameraPosition, frustum, visibleModels, &this->outsideFrustums)){
+		this->queryFrustum(frustum, visibleModels);
+		return;
+	};
+	
+	if(this->outsideFrustums.size() == 0){
+		return;
+	};
+	
+	//query the tree through each portal to the outside, skipping models that have already been found
+	this->queriedModels.clear();
+	this->queriedModels.insert(visibleModels->begin() + firstModel, visibleModels->end());
+	
+	for(int i = 0; i < this->outsideFrustums.size(); i++){
+		this->outsideModels.clear();
+		this->queryFrustum(&this->outsideFrustums[i], &this->outsideModels);
+		
+		for(int j = 0; j < this->outsideModels.size(); j++){
+			if(this->queriedModels.insert(this->outsideModels[j]).second){
+				visibleModels->push_back(this->outsideModels[j]);
+			};
+		};
+	};
+};
+
+//getters
+int Scene::getModelCount(){
+	return this->models.size();
+};
+
+std::vector<Model *> & Scene::getModels(){
+	return this->models;
+};
+
+CellGraph * Scene::getCellGraph(){
+	return &this->cellGraph;
+};
+
+//build node
+void Scene::buildNode(int nodeIndex, int start, int end){
+	//calculate bounds of the models and of their centres
+	Vec4f min = this->modelBounds[this->modelOrder[start]].min;
+	Vec4f max = this->modelBounds[this->modelOrder[start]].max;
+	Vec4f centreMin = this->modelBounds[this->modelOrder[start]].centre;
+	Vec4f centreMax = centreMin;
+	
+	for(int i = start; i < end; i++){
+		Bounds & bounds = this->modelBounds[this->modelOrder[i]];
+		min = Vec4f(fmin(min.x, bounds.min.x), fmin(min.y, bounds.min.y), fmin(min.z, bounds.min.z), 1.0f);
+		max = Vec4f(fmax(max.x, bounds.max.x), fmax(max.y, bounds.max.y), fmax(max.z, bounds.max.z), 1.0f);
+		centreMin = Vec4f(fmin(centreMin.x, bounds.centre.x), fmin(centreMin.y, bounds.centre.y), fmin(centreMin.z, bounds.centre.z), 1.0f);
+		centreMax = Vec4f(fmax(centreMax.x, bounds.centre.x), fmax(centreMax.y, bounds.centre.y), fmax(centreMax.z, bounds.centre.z), 1.0f);
+	};
+	
+	//set node as a leaf (until it is split)
+	Node & node = this->nodes[nodeIndex];
+	node.min = min;
+	node.max = max;
+	node.firstChild = -1;
+	node.firstModel = start;
+	node.modelCount = end - start;
+	
+	if(end - start <= SCENE_BVH_LEAF_SIZE){
+		return;
+	};
+	
+	//split along the axis where the centres are most spread out
+	int axis = 0;
+	for(int i = 1; i < 3; i++){
+		if(Scene::getComponent(centreMax, i) - Scene::getComponent(centreMin, i) > Scene::getComponent(centreMax, axis) - Scene::getComponent(centreMin, axis)){
+			axis = i;
+		};
+	};
+	
+	double axisMin = Scene::getComponent(centreMin, axis);
+	double axisExtent = Scene::getComponent(centreMax, axis) - axisMin;
+	
+	//all centres are in the same place, so the models cannot be separated
+	if(axisExtent <= 0){
+		return;
+	};
+	
+	//sort models into bins by centre
+	int binCounts[SCENE_BVH_BIN_COUNT] = {0};
+	Vec4f binMin[SCENE_BVH_BIN_COUNT];
+	Vec4f binMax[SCENE_BVH_BIN_COUNT];
+	
+	for(int i = start; i < end; i++){
+		Bounds & bounds = this->modelBounds[this->modelOrder[i]];
+		int bin = (int) ((Scene::getComponent(bounds.centre, axis) - axisMin) / axisExtent * SCENE_BVH_BIN_COUNT);
+		bin = bin < SCENE_BVH_BIN_COUNT ? bin : SCENE_BVH_BIN_COUNT - 1;
+		
+		if(binCounts[bin] == 0){
+			binMin[bin] = bounds.min;
+			binMax[bin] = bounds.max;
+		} else {
+			binMin[bin] = Vec4f(fmin(binMin[bin].x, bounds.min.x), fmin(binMin[bin].y, bounds.min.y), fmin(binMin[bin].z, bounds.min.z), 1.0f);
+			binMax[bin] = Vec4f(fmax(binMax[bin].x, bounds.max.x), fmax(binMax[bin].y, bounds.max.y), fmax(binMax[bin].z, bounds.max.z), 1.0f);
+		};
+		
+		binCounts[bin]++;
+	};
+	
+	//calculate area and count to the right of each split position (split i is between bin i and bin i + 1)
+	double rightArea[SCENE_BVH_BIN_COUNT];
+	int rightCount[SCENE_BVH_BIN_COUNT];
+	int count = 0;
+	Vec4f boxMin;
+	Vec4f boxMax;
+	
+	for(int i = SCENE_BVH_BIN_COUNT - 1; i > 0; i--){
+		if(binCounts[i] > 0){
+			boxMin = count == 0 ? binMin[i] : Vec4f(fmin(boxMin.x, binMin[i].x), fmin(boxMin.y, binMin[i].y), fmin(boxMin.z, binMin[i].z), 1.0f);
+			boxMax = count == 0 ? binMax[i] : Vec4f(fmax(boxMax.x, binMax[i].x), fmax(boxMax.y, binMax[i].y), fmax(boxMax.z, binMax[i].z), 1.0f);
+			count += binCounts[i];
+		};
+		
+		rightCount[i - 1] = count;
+		rightArea[i - 1] = count > 0 ? Scene::surfaceArea(boxMin, boxMax) : 0;
+	};
+	
+	//sweep from the left to find the split with the lowest cost
+	int bestSplit = -1;
+	double bestCost = 0;
+	count = 0;
+	
+	for(int i = 0; i < SCENE_BVH_BIN_COUNT - 1; i++){
+		if(binCounts[i] > 0){
+			boxMin = count == 0 ? binMin[i] : Vec4f(fmin(boxMin.x, binMin[i].x), fmin(boxMin.y, binMin[i].y), fmin(boxMin.z, binMin[i].z), 1.0f);
+			boxMax = count == 0 ? binMax[i] : Vec4f(fmax(boxMax.x, binMax[i].x), fmax(boxMax.y, binMax[i].y), fmax(boxMax.z, binMax[i].z), 1.0f);
+			count += binCounts[i];
+		};
+		
+		//both sides must have at least one model
+		if(count == 0 || rightCount[i] == 0){
+			continue;
+		};
+		
+		double cost = Scene::surfaceArea(boxMin, boxMax) * count + rightArea[i] * rightCount[i];
+		
+		if(bestSplit == -1 || cost < bestCost){
+			bestSplit = i;
+			bestCost = cost;
+		};
+	};
+	
+	if(bestSplit == -1){
+		return;
+	};
+	
+	//partition models
+	int * middle = std::partition(this->modelOrder.data() + start, this->modelOrder.data() + end, [this, axis, axisMin, axisExtent, bestSplit](int model){
+		int bin = (int) ((Scene::getComponent(this->modelBounds[model].centre, axis) - axisMin) / axisExtent * SCENE_BVH_BIN_COUNT);
+		return (bin < SCENE_BVH_BIN_COUNT ? bin : SCENE_BVH_BIN_COUNT - 1) <= bestSplit;
+	});
+	int split = middle - this->modelOrder.data();
+	
+	//create children (node may no longer be valid once nodes are added)
+	int firstChild = this->nodes.size();
+	this->nodes[nodeIndex].firstChild = firstChild;
+	this->nodes.push_back(Node());
+	this->nodes.push_back(Node());
+	
+	this->buildNode(firstChild, start, split);
+	this->buildNode(firstChild + 1, split, end);
+};
+
+//refit tree
+void Scene::refit(){
+	//children always come after their parent, so walking backwards refits children before parents
+	for(int i = this->nodes.size() - 1; i >= 0; i--){
+		Node & node = this->nodes[i];
+		
+		if(node.firstChild == -1){
+			node.min = this->modelBounds[this->modelOrder[node.firstModel]].min;
+			node.max = this->modelBounds[this->modelOrder[node.firstModel]].max;
+			
+			for(int j = node.firstModel + 1; j < node.firstModel + node.modelCount; j++){
+				Bounds & bounds = this->modelBounds[this->modelOrder[j]];
+				node.min = Vec4f(fmin(node.min.x, bounds.min.x), fmin(node.min.y, bounds.min.y), fmin(node.min.z, bounds.min.z), 1.0f);
+				node.max = Vec4f(fmax(node.max.x, bounds.max.x), fmax(node.max.y, bounds.max.y), fmax(node.max.z, bounds.max.z), 1.0f);
+			};
+		} else {
+			Node & left = this->nodes[node.firstChild];
+			Node & right = this->nodes[node.firstChild + 1];
+			node.min = Vec4f(fmin(left.min.x, right.min.x), fmin(left.min.y, right.min.y), fmin(left.min.z, right.min.z), 1.0f);
+			node.max = Vec4f(fmax(left.max.x, right.max.x), fmax(left.max.y, right.max.y), fmax(left.max.z, right.max.z), 1.0f);
+		};
+	};
+};
+
+//calculate SAH cost of tree
+//this is the expected number of nodes visited and models tested by a query, relative to the size of the root box
+double Scene::calculateCost(){
+	if(this->nodes.size() == 0){
+		return 0;
+	};
+	
+	double cost = 0;
+	
+	for(int i = 0; i < this->nodes.size(); i++){
+		Node & node = this->nodes[i];
+		cost += Scene::surfaceArea(node.min, node.max) * (node.firstChild == -1 ? node.modelCount : 1);
+	};
+	
+	double rootArea = Scene::surfaceArea(this->nodes[0].min, this->nodes[0].max);
+	return rootArea > 0 ? cost / rootArea : cost;
+};
+
+//calculate surface area of box
+double Scene::surfaceArea(Vec4f min, Vec4f max){
+	double x = max.x - min.x;
+	double y = max.y - min.y;
+	double z = max.z - min.z;
+	return 2 * (x * y + y * z + z * x);
+};
+
+//get component of vector along axis
+double Scene::getComponent(Vec4f v, int axis){
+	return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+};
@@ -0,0 +1,112 @@
+//Scene.hpp
+
+#ifndef SCENE_HPP
+#define SCENE_HPP
+
+#include <vector>
+#include <algorithm>
+#include <unordered_set>
+#include "Model.hpp"
+#include "Frustum.hpp"
+#include "CellGraph.hpp"
+
+/*
+	Notes about the scene bounding volume hierarchy (BVH):
+	Testing every model against the view frustum costs the same however few of them are visible. The scene keeps a binary tree of
+	world space boxes instead: each leaf holds a few models and each node's box encloses its children, so a frustum query can reject (or
+	accept) a whole subtree with one box test. The cost of a query then depends on how much of the scene is visible.
+	
+	The tree is built with the surface area heuristic (SAH): the chance of a query visiting a node is roughly proportional to the surface
+	area of its box, so a split is chosen to minimise (area of left * models on left) + (area of right * models on right). Rather than
+	trying every split position, the model centres are sorted into a fixed number of bins along the longest axis, and only the positions
+	between bins are tried (a "binned" build).
+	
+	When models move, the tree is refit rather than rebuilt: leaf boxes are recalculated and each parent is grown to fit its children,
+	keeping the same tree structure. This is cheap, but the tree gets worse as models move away from where they were when it was built,
+	so it is rebuilt when its SAH cost has grown too much (or when models are added or removed).
+*/
+
+//maximum number of models in a leaf
+#define SCENE_BVH_LEAF_SIZE 4
+
+//number of bins used to find the best split
+#define SCENE_BVH_BIN_COUNT 16
+
+//the tree is rebuilt when refitting has increased its cost by more than this factor
+#define SCENE_BVH_REBUILD_THRESHOLD 1.5
+
+//declare class
+class Scene {
+	public:
+		//constructor
+		Scene();
+		
+		//add / remove models (the tree is rebuilt on the next update)
+		void addModel(Model * model);
+		void removeModel(Model * model);
+		void clear();
+		
+		//update
+		//recalculates world bounds of the models that have moved and refits the tree, or rebuilds it if needed - call once per frame after moving models
+		void update();
+		
+		//rebuild tree
+		void rebuild();
+		
+		//query frustum (frustum must be in world space), adds models that may be visible to the list
+		void queryFrustum(Frustum * frustum, std::vector<Model *> * visibleModels);
+		
+		//query view
+		//if the camera is in a cell, only the models seen through the cell's portals are added (see notes on cells and portals),
+		//otherwise this is the same as queryFrustum
+		void queryView(Vec4f cameraPosition, Frustum * frustum, std::vector<Model *> * visibleModels);
+		
+		//getters
+		int getModelCount();
+		std::vector<Model *> & getModels();
+		CellGraph * getCellGraph();
+	
+	private:
+		//tree node
+		//the models in a node's subtree are modelOrder[firstModel] to modelOrder[firstModel + modelCount - 1]
+		//a node is a leaf if firstChild is -1, otherwise its children are nodes[firstChild] and nodes[firstChild + 1] (children always come after their parent)
+		struct Node {
+			Vec4f min;
+			Vec4f max;
+			int firstChild;
+			int firstModel;
+			int modelCount;
+		};
+		
+		//build node
+		void buildNode(int nodeIndex, int start, int end);
+		
+		//refit tree
+		void refit();
+		
+		//calculate SAH cost of tree
+		double calculateCost();
+		
+		//calculate surface area of box
+		static double surfaceArea(Vec4f min, Vec4f max);
+		
+		//get component of vector along axis (0 = x, 1 = y, 2 = z)
+		static double getComponent(Vec4f v, int axis);
+		
+		//data members
+		std::vector<Model *> models;
+		std::vector<Bounds> modelBounds; //world bounds of each model
+		std::vector<int> modelVersions; //world version of each model when its bounds were calculated
+		std::vector<Bounds> meshBounds; //mesh bounds of each model when its bounds were calculated
+		std::vector<int> modelOrder; //model indices, in leaf order
+		std::vector<Node> nodes;
+		bool rebuildNeeded;
+		double builtCost; //cost of tree when it was last built
+		std::vector<int> stack; //traversal stack (kept to avoid allocating every query)
+		CellGraph cellGraph;
+		std::vector<Frustum> outsideFrustums; //frustums through portals to the outside (kept to avoid allocating every query)
+		std::vector<Model *> outsideModels;
+		std::unordered_set<Model *> queriedModels;
+};
+
+#endif
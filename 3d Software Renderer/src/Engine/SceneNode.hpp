@@ -0,0 +1,197 @@
+//SceneNode.hpp
+
+#ifndef SCENE_NODE_HPP
+#define SCENE_NODE_HPP
+
+#include <vector>
+#include <algorithm>
+#include "Mathematics.hpp"
+
+/*
+	Notes about the transform hierarchy:
+	A node has a local transform (enlarge, then rotate, then translate) relative to its parent, and a world transform, which is its
+	parent's world transform multiplied by its local transform (or just the local transform, for a node with no parent). Parts
+	attached to a model, such as turrets, are children of it, and move with it.
+	
+	Both matrices are cached, as rebuilding them takes several matrix products and trig functions. Changing a node's transform marks
+	its local matrix dirty, and its world matrix and every world matrix below it dirty as well. Matrices are only recalculated when they
+	are next asked for, so a node that has not moved (and whose parents have not moved) costs nothing, and a node that moves several
+	times in a frame is only recalculated once.
+	
+	A node that is dirty always has dirty children (a child is only recalculated after its parent), so marking a subtree dirty can stop
+	at any node that already is.
+	
+	The world version counts how many times the world matrix has been recalculated, so anything derived from it (like world bounds)
+	only needs to be recalculated when the version has changed.
+*/
+
+//declare class
+class SceneNode {
+	public:
+		//constructor
+		SceneNode(){
+			this->initialise(Vec4f(1.0f, 1.0f, 1.0f, 0.0f), Vec4f(0.0f, 0.0f, 0.0f, 0.0f), Vec4f(0.0f, 0.0f, 0.0f, 1.0f));
+		};
+		
+		SceneNode(Vec4f enlargement, Vec4f rotation, Vec4f translation){
+			this->initialise(enlargement, rotation, translation);
+		};
+		
+		//copying a node copies its transform, but not its place in the hierarchy
+		SceneNode(const SceneNode & node){
+			this->initialise(node.enlargement, node.rotation, node.translation);
+		};
+		
+		SceneNode & operator=(const SceneNode & node){
+			this->setEnlargement(node.enlargement);
+			this->setRotation(node.rotation);
+			this->setTranslation(node.translation);
+			return *this;
+		};
+		
+		//destructor
+		//children are left without a parent
+		virtual ~SceneNode(){
+			this->setParent(nullptr);
+			
+			while(this->children.size() > 0){
+				this->children.back()->setParent(nullptr);
+			};
+		};
+		
+		//set parent (nullptr to detach), keeping the local transform (so the node moves to the same place relative to its new parent)
+		void setParent(SceneNode * parent){
+			if(this->parent != nullptr){
+				std::vector<SceneNode *> & siblings = this->parent->children;
+				siblings.erase(std::find(siblings.begin(), siblings.end(), this));
+			};
+			
+			this->parent = parent;
+			
+			if(parent != nullptr){
+				parent->children.push_back(this);
+			};
+			
+			this->markWorldDirty();
+		};
+		
+		//set local transform
+		void setEnlargement(Vec4f enlargement){
+			this->enlargement = enlargement;
+			this->localDirty = true;
+			this->markWorldDirty();
+		};
+		
+		void setRotation(Vec4f rotation){
+			this->rotation = rotation;
+			this->localDirty = true;
+			this->markWorldDirty();
+		};
+		
+		void setTranslation(Vec4f translation){
+			this->translation = translation;
+			this->localDirty = true;
+			this->markWorldDirty();
+		};
+		
+		//get local transform
+		Vec4f getEnlargement(){
+			return this->enlargement;
+		};
+		
+		Vec4f getRotation(){
+			return this->rotation;
+		};
+		
+		Vec4f getTranslation(){
+			return this->translation;
+		};
+		
+		//get hierarchy
+		SceneNode * getParent(){
+			return this->parent;
+		};
+		
+		std::vector<SceneNode *> & getChildren(){
+			return this->children;
+		};
+		
+		//get local matrix (node space to parent space)
+		Mat4x4f & getLocalMatrix(){
+			if(this->localDirty){
+				this->localMatrix = SceneNode::calculateTransformationMatrix(this->enlargement, this->rotation, this->translation);
+				this->localDirty = false;
+			};
+			
+			return this->localMatrix;
+		};
+		
+		//get world matrix (node space to world space)
+		Mat4x4f & getWorldMatrix(){
+			if(this->worldDirty){
+				if(this->parent != nullptr){
+					this->worldMatrix = Math::matrixProduct(this->parent->getWorldMatrix(), this->getLocalMatrix());
+				} else {
+					this->worldMatrix = this->getLocalMatrix();
+				};
+				
+				this->worldDirty = false;
+				this->worldVersion++;
+			};
+			
+			return this->worldMatrix;
+		};
+		
+		//get world version (changes whenever the world matrix is recalculated)
+		int getWorldVersion(){
+			this->getWorldMatrix();
+			return this->worldVersion;
+		};
+		
+		//calculate transformation matrix (enlarge, then rotate, then translate)
+		static Mat4x4f calculateTransformationMatrix(Vec4f enlargement, Vec4f rotation, Vec4f translation){
+			Mat4x4f transform = Math::enlargementMatrix(enlargement);
+			transform = Math::matrixProduct(Math::rotationMatrix(rotation), transform);
+			transform = Math::matrixProduct(Math::translationMatrix(translation), transform);
+			return transform;
+		};
+	
+	private:
+		//initialise
+		void initialise(Vec4f enlargement, Vec4f rotation, Vec4f translation){
+			this->enlargement = enlargement;
+			this->rotation = rotation;
+			this->translation = translation;
+			this->parent = nullptr;
+			this->localDirty = true;
+			this->worldDirty = true;
+			this->worldVersion = 0;
+		};
+		
+		//mark world matrix dirty, for this node and every node below it
+		void markWorldDirty(){
+			if(this->worldDirty){
+				return;
+			};
+			
+			this->worldDirty = true;
+			
+			for(int i = 0; i < this->children.size(); i++){
+				this->children[i]->markWorldDirty();
+			};
+		};
+		
+		//data members
+		Vec4f enlargement;
+		Vec4f rotation;
+		Vec4f translation;
+		SceneNode * parent;
+		std::vector<SceneNode *> children;
+		Mat4x4f localMatrix;
+		Mat4x4f worldMatrix;
+		bool localDirty;
+		bool worldDirty;
+		int worldVersion;
+};
+
+#endif
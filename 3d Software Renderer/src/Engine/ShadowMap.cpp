@@ -0,0 +1,364 @@
+//ShadowMap.cpp
+
+#include "ShadowMap.hpp"
+
+//constructor
+ShadowMap::ShadowMap(int size){
+	this->tileCount = std::max(1, (size + SHADOW_MAP_TILE_SIZE - 1) / SHADOW_MAP_TILE_SIZE);
+	this->size = this->tileCount * SHADOW_MAP_TILE_SIZE;
+	this->depth.resize(this->size * this->size, FLT_MAX);
+	this->dirtyTiles.resize(this->tileCount * this->tileCount, true);
+	this->perspective = false;
+	this->transform = Math::identityMatrix();
+	this->scale = 1;
+	this->nearDistance = 0;
+	this->depthRange = 1;
+	this->projectionChanged = true;
+	this->frame = 0;
+	this->version = 0;
+	this->tilesDrawn = 0;
+	this->trianglesDrawn = 0;
+};
+
+//set directional projection
+//the map looks at the sphere from radius behind its centre, so the sphere fills the map and its depth range
+void ShadowMap::setDirectional(Vec4f direction, Vec4f centre, double radius){
+	Vec4f forward = Math::normalise(Vec4f(direction.x, direction.y, direction.z, 0.0f));
+	Vec4f origin(centre.x - forward.x * radius, centre.y - forward.y * radius, centre.z - forward.z * radius, 1.0f);
+	
+	this->setProjection(origin, forward, false, radius, 0, 2 * radius);
+};
+
+//set spot projection
+void ShadowMap::setSpot(Vec4f position, Vec4f direction, double tanHalfAngle, double nearDistance){
+	this->setProjection(position, Vec4f(direction.x, direction.y, direction.z, 0.0f), true, tanHalfAngle, nearDistance, 0);
+};
+
+//set projection
+void ShadowMap::setProjection(Vec4f origin, Vec4f direction, bool perspective, double scale, double nearDistance, double depthRange){
+	//build a basis looking along the direction (with y as close to up as it can be)
+	Vec4f forward = Math::normalise(Vec4f(direction.x, direction.y, direction.z, 0.0f));
+	Vec4f up = fabs(forward.y) > 0.99 ? Vec4f(1.0f, 0.0f, 0.0f, 0.0f) : Vec4f(0.0f, 1.0f, 0.0f, 0.0f);
+	Vec4f right = Math::normalise(Math::crossProduct(up, forward));
+	up = Math::crossProduct(forward, right);
+	
+	//the rows of the rotation are the axes, and the translation moves the origin to (0, 0, 0)
+	Mat4x4f transform = Math::identityMatrix();
+	Vec4f axes[3] = {right, up, forward};
+	
+	for(int i = 0; i < 3; i++){
+		transform.data[i][0] = axes[i].x;
+		transform.data[i][1] = axes[i].y;
+		transform.data[i][2] = axes[i].z;
+		transform.data[i][3] = -(axes[i].x * origin.x + axes[i].y * origin.y + axes[i].z * origin.z);
+	};
+	
+	//only redraw the map if the projection has changed
+	bool changed = perspective != this->perspective || scale != this->scale || nearDistance != this->nearDistance || depthRange != this->depthRange;
+	
+	for(int i = 0; i < 4 && !changed; i++){
+		for(int j = 0; j < 4; j++){
+			if(transform.data[i][j] != this->transform.data[i][j]){
+				changed = true;
+				break;
+			};
+		};
+	};
+	
+	if(!changed){
+		return;
+	};
+	
+	this->transform = transform;
+	this->perspective = perspective;
+	this->scale = scale;
+	this->nearDistance = nearDistance;
+	this->depthRange = depthRange;
+	this->projectionChanged = true;
+};
+
+//update
+void ShadowMap::update(std::vector<Model *> * casters){
+	this->frame++;
+	this->tilesDrawn = 0;
+	this->trianglesDrawn = 0;
+	
+	//a new projection moves everything in the map
+	if(this->projectionChanged){
+		std::fill(this->dirtyTiles.begin(), this->dirtyTiles.end(), true);
+		this->casters.clear();
+		this->projectionChanged = false;
+	};
+	
+	//find casters that have been added, have moved or have had their mesh replaced, marking the tiles they covered and now cover
+	for(int i = 0; i < casters->size(); i++){
+		Model * model = (*casters)[i];
+		auto found = this->casters.find(model);
+		
+		if(found == this->casters.end()){
+			Caster caster;
+			this->findTiles(model, &caster);
+			this->recordCaster(model, &caster);
+			caster.frame = this->frame;
+			this->markTiles(caster.tileMinX, caster.tileMinY, caster.tileMaxX, caster.tileMaxY);
+			this->casters[model] = caster;
+			continue;
+		};
+		
+		Caster & caster = found->second;
+		
+		if(this->hasCasterChanged(model, &caster)){
+			this->markTiles(caster.tileMinX, caster.tileMinY, caster.tileMaxX, caster.tileMaxY);
+			this->findTiles(model, &caster);
+			this->recordCaster(model, &caster);
+			this->markTiles(caster.tileMinX, caster.tileMinY, caster.tileMaxX, caster.tileMaxY);
+		};
+		
+		caster.frame = this->frame;
+	};
+	
+	//remove casters that are no longer in the list, marking the tiles they covered
+	for(auto it = this->casters.begin(); it != this->casters.end();){
+		if(it->second.frame != this->frame){
+			this->markTiles(it->second.tileMinX, it->second.tileMinY, it->second.tileMaxX, it->second.tileMaxY);
+			it = this->casters.erase(it);
+		} else {
+			it++;
+		};
+	};
+	
+	//clear the dirty tiles
+	for(int ty = 0; ty < this->tileCount; ty++){
+		for(int tx = 0; tx < this->tileCount; tx++){
+			if(!this->dirtyTiles[ty * this->tileCount + tx]){
+				continue;
+			};
+			
+			this->tilesDrawn++;
+			
+			for(int y = ty * SHADOW_MAP_TILE_SIZE; y < (ty + 1) * SHADOW_MAP_TILE_SIZE; y++){
+				float * row = &this->depth[y * this->size + tx * SHADOW_MAP_TILE_SIZE];
+				std::fill(row, row + SHADOW_MAP_TILE_SIZE, FLT_MAX);
+			};
+		};
+	};
+	
+	if(this->tilesDrawn == 0){
+		return;
+	};
+	
+	//draw the casters that overlap a dirty tile (drawTriangle only writes to dirty tiles)
+	for(int i = 0; i < casters->size(); i++){
+		Model * model = (*casters)[i];
+		Caster & caster = this->casters[model];
+		bool overlapsDirtyTile = false;
+		
+		for(int ty = caster.tileMinY; ty <= caster.tileMaxY && !overlapsDirtyTile; ty++){
+			for(int tx = caster.tileMinX; tx <= caster.tileMaxX; tx++){
+				if(this->dirtyTiles[ty * this->tileCount + tx]){
+					overlapsDirtyTile = true;
+					break;
+				};
+			};
+		};
+		
+		if(!overlapsDirtyTile){
+			continue;
+		};
+		
+		Mat4x4f transform = model->getTransformationMatrix();
+		
+		for(int j = 0; j < model->mesh->triangles.size(); j++){
+			Triangle & t = model->mesh->triangles[j];
+			this->drawTriangle(Math::matrixProduct(transform, t.vertices[0].position), Math::matrixProduct(transform, t.vertices[1].position), Math::matrixProduct(transform, t.vertices[2].position));
+		};
+	};
+	
+	std::fill(this->dirtyTiles.begin(), this->dirtyTiles.end(), false);
+	this->version++;
+};
+
+//invalidate
+void ShadowMap::invalidate(){
+	this->projectionChanged = true;
+};
+
+//get visibility
+//2x2 percentage-closer filtering (see notes on shadow maps)
+float ShadowMap::getVisibility(Vec4f position){
+	float x;
+	float y;
+	float depth;
+	
+	//points outside a spot map are outside the light's cone, and points outside a directional map are not shadowed by anything in it
+	if(!this->projectPoint(position, &x, &y, &depth) || x < 0 || y < 0 || x >= this->size || y >= this->size){
+		return this->perspective ? 0.0f : 1.0f;
+	};
+	
+	//move the point towards the light (a perspective depth is -1 / z, so dividing it moves z nearer by the same fraction)
+	depth = this->perspective ? depth / (1 - SHADOW_MAP_DEPTH_BIAS) : depth - SHADOW_MAP_DEPTH_BIAS * this->depthRange;
+	
+	//find the four pixel centres around the point, and how far it is between them
+	float u = x - 0.5f;
+	float v = y - 0.5f;
+	int x0 = (int) floor(u);
+	int y0 = (int) floor(v);
+	float fx = u - x0;
+	float fy = v - y0;
+	
+	int x1 = std::min(x0 + 1, this->size - 1);
+	int y1 = std::min(y0 + 1, this->size - 1);
+	x0 = std::max(x0, 0);
+	y0 = std::max(y0, 0);
+	
+	float lit00 = depth <= this->depth[y0 * this->size + x0] ? 1.0f : 0.0f;
+	float lit10 = depth <= this->depth[y0 * this->size + x1] ? 1.0f : 0.0f;
+	float lit01 = depth <= this->depth[y1 * this->size + x0] ? 1.0f : 0.0f;
+	float lit11 = depth <= this->depth[y1 * this->size + x1] ? 1.0f : 0.0f;
+	
+	float top = lit00 + (lit10 - lit00) * fx;
+	float bottom = lit01 + (lit11 - lit01) * fx;
+	return top + (bottom - top) * fy;
+};
+
+//getters
+int ShadowMap::getSize(){
+	return this->size;
+};
+
+int ShadowMap::getVersion(){
+	return this->version;
+};
+
+int ShadowMap::getTilesDrawn(){
+	return this->tilesDrawn;
+};
+
+int ShadowMap::getTrianglesDrawn(){
+	return this->trianglesDrawn;
+};
+
+//project point
+bool ShadowMap::projectPoint(Vec4f position, float * x, float * y, float * depth){
+	Vec4f point = Math::matrixProduct(this->transform, position);
+	
+	if(!this->perspective){
+		*x = (point.x / this->scale + 1) * 0.5f * this->size;
+		*y = (1 - point.y / this->scale) * 0.5f * this->size;
+		*depth = point.z;
+		return true;
+	};
+	
+	if(point.z <= this->nearDistance){
+		return false;
+	};
+	
+	*x = (point.x / (point.z * this->scale) + 1) * 0.5f * this->size;
+	*y = (1 - point.y / (point.z * this->scale)) * 0.5f * this->size;
+	*depth = -1.0f / point.z;
+	return true;
+};
+
+//has caster changed
+bool ShadowMap::hasCasterChanged(Model * model, Caster * caster){
+	Bounds & bounds = model->mesh->bounds;
+	Bounds & previousBounds = caster->meshBounds;
+	
+	return caster->worldVersion != model->getWorldVersion() || caster->triangleCount != model->mesh->triangles.size() ||
+		bounds.min.x != previousBounds.min.x || bounds.min.y != previousBounds.min.y || bounds.min.z != previousBounds.min.z ||
+		bounds.max.x != previousBounds.max.x || bounds.max.y != previousBounds.max.y || bounds.max.z != previousBounds.max.z ||
+		bounds.radius != previousBounds.radius;
+};
+
+//record caster
+void ShadowMap::recordCaster(Model * model, Caster * caster){
+	caster->worldVersion = model->getWorldVersion();
+	caster->meshBounds = model->mesh->bounds;
+	caster->triangleCount = model->mesh->triangles.size();
+};
+
+//find tiles
+//the tiles covered by the corners of the model's bounding box (all of them if it crosses a spot map's near plane)
+void ShadowMap::findTiles(Model * model, Caster * caster){
+	Bounds & bounds = model->mesh->bounds;
+	Mat4x4f transform = model->getTransformationMatrix();
+	
+	float minX = FLT_MAX;
+	float minY = FLT_MAX;
+	float maxX = -FLT_MAX;
+	float maxY = -FLT_MAX;
+	
+	for(int i = 0; i < 8; i++){
+		Vec4f corner(i & 1 ? bounds.max.x : bounds.min.x, i & 2 ? bounds.max.y : bounds.min.y, i & 4 ? bounds.max.z : bounds.min.z, 1.0f);
+		
+		float x;
+		float y;
+		float depth;
+		
+		if(!this->projectPoint(Math::matrixProduct(transform, corner), &x, &y, &depth)){
+			minX = 0;
+			minY = 0;
+			maxX = this->size - 1;
+			maxY = this->size - 1;
+			break;
+		};
+		
+		minX = std::min(minX, x);
+		minY = std::min(minY, y);
+		maxX = std::max(maxX, x);
+		maxY = std::max(maxY, y);
+	};
+	
+	//a model entirely outside the map covers no tiles
+	if(maxX < 0 || maxY < 0 || minX >= this->size || minY >= this->size){
+		caster->tileMinX = 0;
+		caster->tileMinY = 0;
+		caster->tileMaxX = -1;
+		caster->tileMaxY = -1;
+		return;
+	};
+	
+	//clamp to the map (before converting to integers, as points close to a spot map's near plane can project very far out)
+	float edge = this->size - 1;
+	caster->tileMinX = (int) std::max(minX, 0.0f) / SHADOW_MAP_TILE_SIZE;
+	caster->tileMinY = (int) std::max(minY, 0.0f) / SHADOW_MAP_TILE_SIZE;
+	caster->tileMaxX = (int) std::min(maxX, edge) / SHADOW_MAP_TILE_SIZE;
+	caster->tileMaxY = (int) std::min(maxY, edge) / SHADOW_MAP_TILE_SIZE;
+};
+
+//mark tiles
+void ShadowMap::markTiles(int minX, int minY, int maxX, int maxY){
+	for(int ty = minY; ty <= maxY; ty++){
+		for(int tx = minX; tx <= maxX; tx++){
+			this->dirtyTiles[ty * this->tileCount + tx] = true;
+		};
+	};
+};
+
+//draw triangle
+//covers the pixels whose centres are inside the triangle, keeping the nearest depth (see notes on the depth rasteriser)
+void ShadowMap::drawTriangle(Vec4f v0, Vec4f v1, Vec4f v2){
+	//project vertices (triangles crossing a spot map's near plane are not drawn)
+	float x[3];
+	float y[3];
+	float d[3];
+	
+	if(!this->projectPoint(v0, &x[0], &y[0], &d[0]) || !this->projectPoint(v1, &x[1], &y[1], &d[1]) || !this->projectPoint(v2, &x[2], &y[2], &d[2])){
+		return;
+	};
+	
+	//shadow casters are drawn from both sides, and only into the dirty tiles
+	DepthTarget target;
+	target.depth = &this->depth[0];
+	target.width = this->size;
+	target.height = this->size;
+	target.coverage = PIXEL_CENTRE_COVERAGE;
+	target.depthTest = LESS_DEPTH_TEST;
+	target.tileMask = &this->dirtyTiles;
+	target.tileSize = SHADOW_MAP_TILE_SIZE;
+	target.tileCount = this->tileCount;
+	
+	if(DepthRasteriser::drawTriangle(&target, x, y, d)){
+		this->trianglesDrawn++;
+	};
+};
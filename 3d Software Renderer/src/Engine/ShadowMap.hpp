@@ -0,0 +1,125 @@
+//ShadowMap.hpp
+
+#ifndef SHADOW_MAP_HPP
+#define SHADOW_MAP_HPP
+
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <float.h>
+#include <math.h>
+#include "Mathematics.hpp"
+#include "Model.hpp"
+#include "DepthRasteriser.hpp"
+
+/*
+	Notes about shadow maps:
+	A shadow map is a depth buffer drawn from a light's point of view, holding the depth of the nearest shadow caster in each pixel. A
+	point is in shadow if something in the map is nearer to the light than it is. Only depths are drawn, with the depth rasteriser like
+	the occlusion buffer (but covering pixels whose centres are inside each triangle, rather than only the pixels a triangle covers
+	completely).
+	
+	There are two kinds of projection:
+		- directional lights use an orthographic projection, covering a sphere (e.g. around the level or the camera) from one side
+		- spot lights use a perspective projection from the light's position, along its direction. A point light with a spot shadow
+			map only lights what is inside the map's cone, as nothing outside it has a shadow to test against
+	Depth is stored so that it can be interpolated linearly across the map, and so that smaller values are nearer: z for orthographic
+	maps and -1 / z for perspective ones. Empty pixels are FLT_MAX.
+	
+	The map is divided into tiles of SHADOW_MAP_TILE_SIZE pixels, and only redrawn where it has changed. update is given the casters,
+	and keeps the world version and mesh bounds of each one and the tiles it covered when it was last drawn. The tiles covered by a
+	caster that has moved or had its mesh replaced (before and after the change), been added or been removed are cleared, and the casters that overlap them are drawn into those
+	tiles alone. Changing the projection redraws the whole map. So while nothing moves, a shadow map costs nothing to update, and
+	lighting only reads from it.
+	
+	Sampling uses percentage-closer filtering (PCF): the four pixels around the point are each tested, and the results are blended by
+	how close the point is to each one, so the edges of shadows are smooth rather than blocky. A small bias is subtracted from the
+	point's depth before it is tested, so a surface does not shadow itself because of rounding.
+*/
+
+//shadow map tile size in pixels (a multiple of 4)
+#define SHADOW_MAP_TILE_SIZE 32
+
+//fraction of the depth (or of the depth range for orthographic maps) that points are moved towards the light before being tested
+#define SHADOW_MAP_DEPTH_BIAS 0.005
+
+//declare class
+class ShadowMap {
+	public:
+		//constructor (size is rounded up to a whole number of tiles)
+		ShadowMap(int size);
+		
+		//set projection
+		//a directional map covers the sphere at centre with the radius, looking along direction (the way the light travels)
+		//a spot map looks from position along direction, covering tanHalfAngle either side, and from nearDistance outwards
+		void setDirectional(Vec4f direction, Vec4f centre, double radius);
+		void setSpot(Vec4f position, Vec4f direction, double tanHalfAngle, double nearDistance);
+		
+		//redraw the parts of the map that have changed (see notes on shadow maps)
+		void update(std::vector<Model *> * casters);
+		
+		//redraw the whole map on the next update
+		void invalidate();
+		
+		//get visibility of a world space point (0 in shadow to 1 lit)
+		float getVisibility(Vec4f position);
+		
+		//getters
+		int getSize();
+		int getVersion(); //changes whenever any part of the map is redrawn
+		int getTilesDrawn(); //tiles redrawn by the last update
+		int getTrianglesDrawn(); //triangles drawn by the last update
+	
+	private:
+		//caster (what was last drawn for a model)
+		struct Caster {
+			int worldVersion;
+			Bounds meshBounds; //bounds and triangle count of the mesh, to notice it being replaced (e.g. a placeholder by the loaded mesh)
+			int triangleCount;
+			int tileMinX;
+			int tileMinY;
+			int tileMaxX;
+			int tileMaxY;
+			int frame; //last update the model was a caster in
+		};
+		
+		//set the light transform and projection (marking the whole map to be redrawn if they have changed)
+		void setProjection(Vec4f origin, Vec4f direction, bool perspective, double scale, double nearDistance, double depthRange);
+		
+		//project world space point to map coordinates and depth, returns false if it is behind a spot map's near plane
+		bool projectPoint(Vec4f position, float * x, float * y, float * depth);
+		
+		//find the tiles a model's bounds cover
+		void findTiles(Model * model, Caster * caster);
+		
+		//check whether a caster has moved or its mesh has changed since it was last drawn
+		bool hasCasterChanged(Model * model, Caster * caster);
+		
+		//keep the world version and mesh of a caster being drawn
+		void recordCaster(Model * model, Caster * caster);
+		
+		//mark tiles dirty
+		void markTiles(int minX, int minY, int maxX, int maxY);
+		
+		//draw triangle into the dirty tiles
+		void drawTriangle(Vec4f v0, Vec4f v1, Vec4f v2);
+		
+		//data members
+		int size;
+		int tileCount; //tiles across the map
+		std::vector<float> depth;
+		std::vector<bool> dirtyTiles;
+		std::unordered_map<Model *, Caster> casters;
+		bool perspective;
+		Mat4x4f transform; //world space to light space (looking along +z)
+		double scale; //light space x and y at the edge of the map (the radius, or tanHalfAngle for perspective maps)
+		double nearDistance;
+		double depthRange; //depth of an orthographic map (twice the radius)
+		bool projectionChanged;
+		int frame;
+		int version;
+		int tilesDrawn;
+		int trianglesDrawn;
+};
+
+#endif
@@ -146,7 +146,7 @@ void Window::clearScreen(){
 
 	//clear depth buffer
 	for(int i = 0; i < this->width * this->height; i++){
-		this->depthBuffer[i] = 9999999;
+		this->depthBuffer[i] = this->clearDepth;
 	};
 };
 
@@ -160,7 +160,7 @@ void Window::clearScreen(uint8_t red, uint8_t green, uint8_t blue){
 	
 	//clear depth buffer
 	for(int i = 0; i < this->width * this->height; i++){
-		this->depthBuffer[i] = 9999999;
+		this->depthBuffer[i] = this->clearDepth;
 	};
 };
 
@@ -195,6 +195,11 @@ void Window::drawPixel(int x, int y, double depth, uint8_t red, uint8_t green, u
 	};
 };
 	
+//depth test
+bool Window::isPixelVisible(int x, int y, double depth){
+	return x >= 0 && x < this->width && y >= 0 && y < this->height && depth < this->depthBuffer[y * this->width + x];
+};
+
 //swap buffers
 void Window::swapBuffers(){
 	//send pixel buffer to device context with StretchDIBits
@@ -322,6 +327,12 @@ void Window::updateDeltaTime(){
 	this->startTime = this->endTime;
 };
 
+//set clear depth
+//takes effect from the next time the screen is cleared
+void Window::setClearDepth(double depth){
+	this->clearDepth = depth;
+};
+
 //getters
 unsigned int Window::getWidth(){
 	return this->width;
@@ -5,6 +5,7 @@
 
 #include <windows.h>
 #include <iostream>
+#include <float.h>
 
 #include "Pixel.hpp"
 
@@ -29,6 +30,9 @@ class Window {
 		void drawPixel(int x, int y, uint8_t red, uint8_t green, uint8_t blue);
 		void drawPixel(int x, int y, double depth, uint8_t red, uint8_t green, uint8_t blue);
 		
+		//depth test (whether a pixel drawn at this depth would be visible, so work on hidden pixels can be skipped)
+		bool isPixelVisible(int x, int y, double depth);
+		
 		//swap buffers
 		void swapBuffers();
 	
@@ -44,6 +48,9 @@ class Window {
 		//updatate delta time
 		void updateDeltaTime();
 		
+		//set the depth the depth buffer is cleared to (pixels at or beyond it are never drawn, e.g. the renderer's far distance)
+		void setClearDepth(double depth);
+		
 		//getters
 		unsigned int getWidth();
 		unsigned int getHeight();
@@ -64,6 +71,7 @@ class Window {
 		BITMAPINFO bitmapInfo;
 		Pixel * renderBuffer = nullptr;
 		double * depthBuffer = nullptr;
+		double clearDepth = DBL_MAX;
 		bool running;
 		bool fullscreen;
 		DWORD windowStyle;
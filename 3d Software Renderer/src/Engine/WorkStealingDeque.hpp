@@ -0,0 +1,118 @@
+//WorkStealingDeque.hpp
+
+#ifndef WORK_STEALING_DEQUE_HPP
+#define WORK_STEALING_DEQUE_HPP
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+	Notes about the work-stealing deque:
+	This is a bounded Chase-Lev deque (with the memory ordering from Le, Pop, Cohen and Zappa Nardelli's "Correct and Efficient
+	Work-Stealing for Weak Memory Models"). It is owned by one thread, which pushes and pops at the bottom like a stack, while any
+	number of other threads steal from the top:
+		- the owner only needs a compare-and-swap when it takes the last item, which a thief may be trying to take at the same time
+		- thieves claim the top item with a compare-and-swap on the top index, so they only contend with each other and with the
+		  owner taking the last item
+	The owner works on what it pushed most recently (which is most likely to still be in its cache), and thieves take the oldest items,
+	which in a job system are usually the largest pieces of work left.
+	
+	Items are stored in a ring buffer indexed by top and bottom, which only ever increase. The capacity must be a power of two, and T
+	must be small and trivially copyable (e.g. a pointer), as items are read with atomic loads.
+*/
+
+//declare class
+template <typename T>
+class WorkStealingDeque {
+	public:
+		//constructor
+		WorkStealingDeque(size_t capacity){
+			this->items = new std::atomic<T>[capacity];
+			this->mask = capacity - 1;
+			
+			this->top.store(0, std::memory_order_relaxed);
+			this->bottom.store(0, std::memory_order_relaxed);
+		};
+		
+		//destructor
+		~WorkStealingDeque(){
+			delete[] this->items;
+		};
+		
+		//prevent copying
+		WorkStealingDeque(const WorkStealingDeque &) = delete;
+		WorkStealingDeque & operator=(const WorkStealingDeque &) = delete;
+		
+		//push onto the bottom (owner only, returns false if the deque is full)
+		bool push(T value){
+			int64_t b = this->bottom.load(std::memory_order_relaxed);
+			int64_t t = this->top.load(std::memory_order_acquire);
+			
+			if(b - t > (int64_t) this->mask){
+				return false;
+			};
+			
+			this->items[b & this->mask].store(value, std::memory_order_relaxed);
+			
+			//the item must be visible before the new bottom is
+			this->bottom.store(b + 1, std::memory_order_release);
+			return true;
+		};
+		
+		//pop from the bottom (owner only, returns false if the deque is empty)
+		bool pop(T * value){
+			//reserve the bottom item before looking at the top, so a thief cannot take it without seeing the reservation
+			int64_t b = this->bottom.load(std::memory_order_relaxed) - 1;
+			this->bottom.store(b, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			int64_t t = this->top.load(std::memory_order_relaxed);
+			
+			if(t > b){
+				//empty - restore the bottom
+				this->bottom.store(b + 1, std::memory_order_relaxed);
+				return false;
+			};
+			
+			*value = this->items[b & this->mask].load(std::memory_order_relaxed);
+			
+			if(t == b){
+				//last item - race any thieves for it by taking it from the top
+				bool taken = this->top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+				this->bottom.store(b + 1, std::memory_order_relaxed);
+				return taken;
+			};
+			
+			return true;
+		};
+		
+		//steal from the top (any thread, returns false if the deque is empty or another thread took the item first)
+		bool steal(T * value){
+			int64_t t = this->top.load(std::memory_order_acquire);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			int64_t b = this->bottom.load(std::memory_order_acquire);
+			
+			if(t >= b){
+				return false;
+			};
+			
+			*value = this->items[t & this->mask].load(std::memory_order_relaxed);
+			return this->top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+		};
+		
+		//get approximate number of items (exact only on the owner thread while nothing is being stolen)
+		size_t getSize(){
+			int64_t b = this->bottom.load(std::memory_order_relaxed);
+			int64_t t = this->top.load(std::memory_order_relaxed);
+			return b > t ? (size_t) (b - t) : 0;
+		};
+	
+	private:
+		//data members
+		std::atomic<T> * items;
+		size_t mask;
+		alignas(64) std::atomic<int64_t> top; //indices are on separate cache lines so thieves do not contend with the owner
+		alignas(64) std::atomic<int64_t> bottom;
+};
+
+#endif
@@ -0,0 +1,320 @@
+/*
+	Job System Tests
+	
+	Stress tests for the work-stealing deque and the job system, and a parallelFor benchmark.
+	Each test prints what it checked, and the program returns 1 as soon as one fails.
+	
+	The number of threads created besides the main thread can be given as the first argument (the default is one less than the
+	number of logical processors), and "pin" as the second argument pins the workers to logical processors.
+	The benchmark only shows a speed-up on a machine with more than one core.
+	
+	Compile with Visual Studio command prompt, using the following:
+	cl /EHsc ./../src/Tests/JobSystemTests.cpp ./../src/Engine/JobSystem.cpp /O2 /link /out:./jobSystemTests.exe
+*/
+
+#include "./../Engine/JobSystem.hpp"
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <stdlib.h>
+#include <math.h>
+
+//deque stress test sizes
+#define DEQUE_TEST_ITEMS 2000000
+#define DEQUE_TEST_CAPACITY 1024
+#define DEQUE_TEST_THIEVES 3
+
+//get time in milliseconds
+double getTime(){
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+};
+
+//print result of a check, returns the check
+bool check(bool passed, std::string description){
+	std::cout << (passed ? "passed: " : "FAILED: ") << description << std::endl;
+	return passed;
+};
+
+//deque stress test
+//the owner pushes every item (popping some of them back) while thieves steal, and every item must be taken exactly once
+bool testDeque(){
+	WorkStealingDeque<int *> deque(DEQUE_TEST_CAPACITY);
+	std::vector<int> items(DEQUE_TEST_ITEMS);
+	std::vector<std::atomic<int>> taken(DEQUE_TEST_ITEMS);
+	
+	for(int i = 0; i < DEQUE_TEST_ITEMS; i++){
+		items[i] = i;
+		taken[i] = 0;
+	};
+	
+	std::atomic<bool> pushing(true);
+	std::vector<std::thread> thieves;
+	
+	for(int i = 0; i < DEQUE_TEST_THIEVES; i++){
+		thieves.push_back(std::thread([&deque, &taken, &pushing](){
+			int * item;
+			
+			while(pushing.load()){
+				if(deque.steal(&item)){
+					taken[*item]++;
+				};
+			};
+			
+			while(deque.steal(&item)){
+				taken[*item]++;
+			};
+		}));
+	};
+	
+	int pushed = 0;
+	int * item;
+	
+	while(pushed < DEQUE_TEST_ITEMS){
+		if(deque.push(&items[pushed])){
+			pushed++;
+		} else if(deque.pop(&item)){
+			taken[*item]++;
+		};
+		
+		//pop every third item back, so the owner and thieves race for the last item
+		if(pushed % 3 == 0 && deque.pop(&item)){
+			taken[*item]++;
+		};
+	};
+	
+	while(deque.pop(&item)){
+		taken[*item]++;
+	};
+	
+	pushing = false;
+	for(int i = 0; i < thieves.size(); i++){
+		thieves[i].join();
+	};
+	
+	int wrong = 0;
+	for(int i = 0; i < DEQUE_TEST_ITEMS; i++){
+		if(taken[i] != 1){
+			wrong++;
+		};
+	};
+	
+	return check(wrong == 0, "deque, " + std::to_string(DEQUE_TEST_ITEMS) + " items with " + std::to_string(DEQUE_TEST_THIEVES) + " thieves, " + std::to_string(wrong) + " not taken exactly once");
+};
+
+//parallel for test
+//every index must be visited exactly once in every round
+bool testParallelFor(JobSystem * jobSystem){
+	const int count = 1000003;
+	const int rounds = 200;
+	std::vector<int> visits(count, 0);
+	
+	for(int i = 0; i < rounds; i++){
+		jobSystem->parallelFor(0, count, 1000, [&visits](int first, int last){
+			for(int j = first; j < last; j++){
+				visits[j]++;
+			};
+		});
+	};
+	
+	int wrong = 0;
+	for(int i = 0; i < count; i++){
+		if(visits[i] != rounds){
+			wrong++;
+		};
+	};
+	
+	return check(wrong == 0, "parallelFor, " + std::to_string(rounds) + " rounds, " + std::to_string(wrong) + " indices visited the wrong number of times");
+};
+
+//nested parallel for test
+//a parallelFor inside a job waits by running other jobs, so this must finish without every thread waiting
+bool testNestedParallelFor(JobSystem * jobSystem){
+	std::atomic<long long> sum(0);
+	
+	jobSystem->parallelFor(0, 64, 1, [jobSystem, &sum](int first, int last){
+		for(int i = first; i < last; i++){
+			jobSystem->parallelFor(0, 1000, 10, [&sum](int innerFirst, int innerLast){
+				long long rangeSum = 0;
+				for(int j = innerFirst; j < innerLast; j++){
+					rangeSum += j;
+				};
+				
+				sum += rangeSum;
+			});
+		};
+	});
+	
+	long long expected = 64LL * 999 * 1000 / 2;
+	return check(sum.load() == expected, "nested parallelFor, sum " + std::to_string(sum.load()) + " (expected " + std::to_string(expected) + ")");
+};
+
+//dependency test
+//three stages, each depending on the counter of the one before, must run in order
+bool testDependencies(JobSystem * jobSystem){
+	const int rounds = 2000;
+	const int stageJobs = 8;
+	int wrongRounds = 0;
+	
+	for(int i = 0; i < rounds; i++){
+		JobCounter firstCounter;
+		JobCounter secondCounter;
+		JobCounter thirdCounter;
+		std::atomic<int> firstStage(0);
+		std::atomic<int> secondStage(0);
+		std::atomic<int> outOfOrder(0);
+		
+		for(int j = 0; j < stageJobs; j++){
+			jobSystem->run([&firstStage](){
+				firstStage++;
+			}, &firstCounter);
+		};
+		
+		for(int j = 0; j < stageJobs; j++){
+			jobSystem->run([&firstStage, &secondStage, &outOfOrder, stageJobs](){
+				if(firstStage.load() != stageJobs){
+					outOfOrder++;
+				};
+				
+				secondStage++;
+			}, &secondCounter, &firstCounter);
+		};
+		
+		jobSystem->run([&secondStage, &outOfOrder, stageJobs](){
+			if(secondStage.load() != stageJobs){
+				outOfOrder++;
+			};
+		}, &thirdCounter, &secondCounter);
+		
+		jobSystem->wait(&thirdCounter);
+		jobSystem->wait(&secondCounter);
+		jobSystem->wait(&firstCounter);
+		
+		if(outOfOrder.load() > 0){
+			wrongRounds++;
+		};
+	};
+	
+	return check(wrongRounds == 0, "dependencies, " + std::to_string(rounds) + " rounds, " + std::to_string(wrongRounds) + " run out of order");
+};
+
+//outside thread test
+//threads that are not workers start jobs through the shared queue
+bool testOutsideThreads(JobSystem * jobSystem){
+	const int threadCount = 4;
+	const int jobsPerThread = 20000;
+	JobCounter counter;
+	std::atomic<int> jobsRun(0);
+	std::vector<std::thread> threads;
+	
+	for(int i = 0; i < threadCount; i++){
+		threads.push_back(std::thread([jobSystem, &counter, &jobsRun, jobsPerThread](){
+			for(int j = 0; j < jobsPerThread; j++){
+				jobSystem->run([&jobsRun](){
+					jobsRun++;
+				}, &counter);
+			};
+		}));
+	};
+	
+	for(int i = 0; i < threads.size(); i++){
+		threads[i].join();
+	};
+	
+	jobSystem->wait(&counter);
+	
+	return check(jobsRun.load() == threadCount * jobsPerThread, "jobs from outside threads, " + std::to_string(jobsRun.load()) + " of " + std::to_string(threadCount * jobsPerThread) + " run");
+};
+
+//wake test
+//the workers are left idle long enough to sleep before each batch of jobs is started
+bool testWake(JobSystem * jobSystem){
+	const int rounds = 50;
+	const int jobCount = 100;
+	int wrongRounds = 0;
+	
+	for(int i = 0; i < rounds; i++){
+		std::this_thread::sleep_for(std::chrono::milliseconds(2));
+		
+		JobCounter counter;
+		std::atomic<int> jobsRun(0);
+		
+		for(int j = 0; j < jobCount; j++){
+			jobSystem->run([&jobsRun](){
+				jobsRun++;
+			}, &counter);
+		};
+		
+		jobSystem->wait(&counter);
+		
+		if(jobsRun.load() != jobCount){
+			wrongRounds++;
+		};
+	};
+	
+	return check(wrongRounds == 0, "waking sleeping workers, " + std::to_string(rounds) + " rounds, " + std::to_string(wrongRounds) + " wrong");
+};
+
+//parallel for benchmark
+void benchmarkParallelFor(JobSystem * jobSystem){
+	const int count = 1 << 22;
+	const int rounds = 10;
+	std::vector<float> input(count);
+	std::vector<float> output(count);
+	
+	for(int i = 0; i < count; i++){
+		input[i] = i * 0.001f;
+	};
+	
+	JobRangeFunction work = [&input, &output](int first, int last){
+		for(int i = first; i < last; i++){
+			output[i] = sqrtf(input[i]) * sinf(input[i]);
+		};
+	};
+	
+	double start = getTime();
+	for(int i = 0; i < rounds; i++){
+		work(0, count);
+	};
+	double serialTime = (getTime() - start) / rounds;
+	
+	start = getTime();
+	for(int i = 0; i < rounds; i++){
+		jobSystem->parallelFor(0, count, 4096, work);
+	};
+	double parallelTime = (getTime() - start) / rounds;
+	
+	std::cout << "parallelFor benchmark: serial " << serialTime << "ms, parallel " << parallelTime << "ms (" << serialTime / parallelTime << "x on " << jobSystem->getThreadCount() << " threads)" << std::endl;
+	
+	//cost of starting and running a job that does nothing
+	const int jobCount = 100000;
+	JobCounter counter;
+	
+	start = getTime();
+	for(int i = 0; i < jobCount; i++){
+		jobSystem->run([](){}, &counter);
+	};
+	jobSystem->wait(&counter);
+	
+	std::cout << "empty job: " << (getTime() - start) * 1000000 / jobCount << "ns" << std::endl;
+};
+
+//entry point
+int main(int argc, char ** argv){
+	int threadCount = argc > 1 ? atoi(argv[1]) : -1;
+	int affinity = argc > 2 && std::string(argv[2]) == "pin" ? PIN_THREADS_TO_PROCESSORS : NO_THREAD_AFFINITY;
+	
+	if(!testDeque()){
+		return 1;
+	};
+	
+	JobSystem jobSystem(threadCount, affinity);
+	std::cout << "job system threads: " << jobSystem.getThreadCount() << std::endl;
+	
+	if(!testParallelFor(&jobSystem) || !testNestedParallelFor(&jobSystem) || !testDependencies(&jobSystem) || !testOutsideThreads(&jobSystem) || !testWake(&jobSystem)){
+		return 1;
+	};
+	
+	benchmarkParallelFor(&jobSystem);
+	
+	return 0;
+};
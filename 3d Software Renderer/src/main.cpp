@@ -11,13 +11,16 @@
 	It will be very difficult, and a bullet-hell game in nature.
 	
 	Compile with Visual Studio command prompt, using the following:
-	cl /EHsc ./../src/main.cpp ./../src/Engine/Window.cpp ./../src/Engine/Renderer.cpp ./../src/Engine/Pixel.cpp ./../src/Engine/Camera.cpp /O2 /link gdi32.lib user32.lib /out:./game.exe
+	cl /EHsc ./../src/main.cpp ./../src/Engine/Window.cpp ./../src/Engine/Renderer.cpp ./../src/Engine/Pixel.cpp ./../src/Engine/Camera.cpp ./../src/Engine/AssetLoader.cpp ./../src/Engine/Scene.cpp ./../src/Engine/OcclusionBuffer.cpp ./../src/Engine/CellGraph.cpp ./../src/Engine/LightSet.cpp ./../src/Engine/ShadowMap.cpp ./../src/Engine/DepthRasteriser.cpp ./../src/Engine/JobSystem.cpp /O2 /link gdi32.lib user32.lib /out:./game.exe
 */
 
 #include "./Engine/Renderer.hpp"
 #include "./Engine/Mathematics.hpp"
 #include "./Engine/Model.hpp"
 #include "./Engine/Camera.hpp"
+#include "./Engine/MeshOptimiser.hpp"
+#include "./Engine/MeshSimplifier.hpp"
+#include "./Engine/AssetLoader.hpp"
 
 //PROBLEM: the mountains 3d model runs much better in the C based engine, 3d model 1, on my hard drive - find out why
 
@@ -36,10 +39,32 @@ int main(){
 	double deltaTimeAverage[1000];
 	int deltaTimeIndex = 0;
 	
-	//load mesh
+	//create job system (one thread per logical processor, including this one) and draw with it
+	JobSystem jobSystem(-1, NO_THREAD_AFFINITY);
+	renderer.setJobSystem(&jobSystem);
+	
+	//declare assets before the asset loader, so its threads have stopped before they are destroyed
 	Mesh m;
 	Bitmap bitmap;
-	Mesh::loadMeshFromObjFile("./res/Castle.obj", &m, "./res/Low.bmp", &bitmap);
+	QuantizedMesh quantizedMesh;
+	MeshOptimisationStatistics optimisationStatistics;
+	
+	//create asset loader
+	AssetLoader assetLoader(2);
+	
+	//request mesh (a placeholder box the size of the castle is drawn until it has loaded)
+	//levels of detail are generated, and the mesh is optimised and quantized on the loading thread
+	std::future<bool> meshLoaded = assetLoader.requestMesh("./res/Castle.obj", &m, "./res/Low.bmp", &bitmap, Vec4f(-226.0f, -22.0f, -178.0f, 1.0f), Vec4f(191.0f, 59.0f, 229.0f, 1.0f), [&quantizedMesh, &optimisationStatistics](Mesh * mesh, Bitmap * texture){
+		//generate levels of detail (simpler meshes drawn when the castle is small on screen)
+		MeshSimplifier::generateLods(mesh);
+		
+		//optimise triangle order for vertex cache reuse and overdraw
+		optimisationStatistics = MeshOptimiser::optimiseMesh(mesh);
+	
+		//quantize mesh (the model is drawn from the compact vertex format once loaded)
+		QuantizedMesh::quantizeMesh(mesh, &quantizedMesh);
+		MeshOptimiser::optimiseVertexFetch(&quantizedMesh);
+	});
 	
 	//calculate aspect ratio
 	double aspectRatio = (double) window->getWidth() / window->getHeight();
@@ -49,6 +74,11 @@ int main(){
 	Model model(&m, Vec4f(1.0f, 1.0f, 1.0f, 0.0f), Vec4f(angle, 0, 0, 0.0f), Vec4f(-0.50f, 0.0f, 15.0f, 1.0f));
 	Model model2(&m, Vec4f(1.0f, 1.0f, 1.0f, 0.0f), Vec4f(angle, 0, 0, 0.0f), Vec4f(4.0f, 0.0f, 15.0f, 1.0f));
 	
+	//create scene
+	Scene scene;
+	scene.addModel(&model);
+	//scene.addModel(&model2);
+	
 	//create camera
 	Camera camera = Camera();
 	camera.move(Vec4f(0.0f, 0.0f, 0.0f, 1.0f));
@@ -57,6 +87,7 @@ int main(){
 	std::vector <Light> lights;
 	lights.push_back(Light(AMBIENT_LIGHT, Vec4f(), Vec4f(), 0.4));
 	lights.push_back(Light(POINT_LIGHT, Vec4f(0.0f, 0.0f, 0.0f, 1.0f), Vec4f(0.0f, 1.0f, 0.0f, 0.0f), 0.6));
+	LightSet lightSet;
 	
 	double x = 300;
 	double y = 240;
@@ -84,6 +115,19 @@ int main(){
 		//handle events
 		window->handleEvents();
 		
+		//publish loaded assets
+		assetLoader.publishLoadedAssets();
+		
+		//draw from the quantized mesh once the castle has loaded
+		if(meshLoaded.valid() && meshLoaded.wait_for(std::chrono::seconds(0)) == std::future_status::ready){
+			if(meshLoaded.get()){
+				model.quantizedMesh = &quantizedMesh;
+				model2.quantizedMesh = &quantizedMesh;
+				
+				std::cout << "Mesh optimised: " << optimisationStatistics.triangleCount << " triangles, ACMR " << optimisationStatistics.acmrBefore << " -> " << optimisationStatistics.acmrAfter << std::endl;
+			};
+		};
+		
 		//clear screen
 		window->clearScreen(166, 200, 255);
 		
@@ -124,9 +168,17 @@ int main(){
 			camera.moveRight(-10.0f * window->getDeltaTime());
 		};
 		
-		//draw 3d model
-		renderer.draw3dModel(&model, &camera, lights);
-		//=renderer.draw3dModel(&model2, &camera, lights);
+		//reset render statistics
+		renderer.resetStatistics();
+		
+		//update scene (refits the bounding volume hierarchy to the models' current positions)
+		scene.update();
+		
+		//compile lights into view space (after the camera has moved)
+		lightSet.compile(&lights, camera.getCameraTransformationMatrix());
+		
+		//draw 3d models
+		renderer.drawScene(&scene, &camera, &lightSet);
 		//renderer.drawBitmap(&bitmap, 0, 0);
 		
 		//void drawShadedTriangle(int x1, int y1, int x2, int y2, int x3, int y3, double i1, double i2, double i3, double d1, double d2, double d3, double tx1, double ty1, double tx2, double ty2, double tx3, double ty3, Bitmap * bmp, Pixel c1, Pixel c2, Pixel c3){